@@ -0,0 +1,52 @@
+#!/usr/bin/env bash
+# Copyright 2018 Tin Rabzelj. All Rights Reserved.
+#
+# Runs a dedicated server against headless bot clients for each bot count and
+# collects server load and net bandwidth CSVs per run into Saved/Profiling/Perplex/.
+#
+# Usage: UE4_EDITOR=/path/to/UE4Editor Scripts/LoadTest.sh [duration seconds] [bot counts...]
+
+set -euo pipefail
+
+PROJECT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+PROJECT="$PROJECT_DIR/Perplex.uproject"
+MAP="/Game/Perplex/Maps/Playground_P"
+UE4_EDITOR="${UE4_EDITOR:?Set UE4_EDITOR to the UE4Editor binary}"
+DURATION="${1:-120}"
+shift || true
+if [ $# -gt 0 ]; then
+	BOT_COUNTS=("$@")
+else
+	BOT_COUNTS=(16 32 64 128)
+fi
+PORT=7777
+
+mkdir -p "$PROJECT_DIR/Saved/Logs" "$PROJECT_DIR/Saved/Profiling/Perplex"
+
+for COUNT in "${BOT_COUNTS[@]}"; do
+	CSV="$PROJECT_DIR/Saved/Profiling/Perplex/ServerLoad-${COUNT}bots.csv"
+	NET_CSV="$PROJECT_DIR/Saved/Profiling/Perplex/NetBandwidth-${COUNT}bots.csv"
+	echo "Running $COUNT bots for $DURATION seconds"
+
+	"$UE4_EDITOR" "$PROJECT" "$MAP" -server -log -unattended -port=$PORT \
+		-PerplexLoadReport -PerplexLoadReportCsv="$CSV" \
+		-PerplexNetProfile -PerplexNetProfileCsv="$NET_CSV" > "$PROJECT_DIR/Saved/Logs/LoadTest-server-${COUNT}.log" 2>&1 &
+	SERVER_PID=$!
+	sleep 20
+
+	BOT_PIDS=()
+	for ((i = 0; i < COUNT; i++)); do
+		"$UE4_EDITOR" "$PROJECT" 127.0.0.1:$PORT -game -nullrhi -nosound -unattended \
+			-PerplexBot -PerplexBotSeed=$i > /dev/null 2>&1 &
+		BOT_PIDS+=($!)
+	done
+
+	sleep "$DURATION"
+
+	kill "${BOT_PIDS[@]}" 2> /dev/null || true
+	# Server writes the report when the game mode ends play
+	kill -INT "$SERVER_PID" 2> /dev/null || true
+	wait "$SERVER_PID" 2> /dev/null || true
+
+	echo "Reports: $CSV $NET_CSV"
+done
@@ -1,6 +1,7 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 
 #include "FP_FirstPersonHUD.h"
+#include "Perplex.h"
 #include "Engine/Canvas.h"
 #include "TextureResource.h"
 #include "CanvasItem.h"
@@ -9,9 +10,13 @@
 
 AFP_FirstPersonHUD::AFP_FirstPersonHUD()
 {
+	CrosshairTex = nullptr;
+
+#if WITH_COSMETICS
 	// Set the crosshair texture
 	static ConstructorHelpers::FObjectFinder<UTexture2D> CrosshairTexObj(TEXT("/Game/FirstPerson/Textures/FirstPersonCrosshair"));
 	CrosshairTex = CrosshairTexObj.Object;
+#endif
 }
 
 /** This method draws a very simple crosshair */
@@ -19,6 +24,7 @@ void AFP_FirstPersonHUD::DrawHUD()
 {
 	Super::DrawHUD();
 
+#if WITH_COSMETICS
 	// Find center of the Canvas
 	const FVector2D Center(Canvas->ClipX * 0.5f, Canvas->ClipY * 0.5f);
 
@@ -30,4 +36,10 @@ void AFP_FirstPersonHUD::DrawHUD()
 	FCanvasTileItem TileItem( CrosshairDrawPosition, CrosshairTex->Resource, FLinearColor::White);
 	TileItem.BlendMode = SE_BLEND_Translucent;
 	Canvas->DrawItem( TileItem );
+#endif
+}
+
+bool AFP_FirstPersonHUD::NeedsLoadForServer() const
+{
+	return false;
 }
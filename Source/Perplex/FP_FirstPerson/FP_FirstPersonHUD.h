@@ -17,6 +17,9 @@ public:
 	/** Primary draw call for the HUD */
 	virtual void DrawHUD() override;
 
+	/** Servers never draw a HUD */
+	virtual bool NeedsLoadForServer() const override;
+
 private:
 	/** Crosshair asset pointer */
 	class UTexture2D* CrosshairTex;
@@ -24,6 +24,9 @@ public class Perplex : ModuleRules
             "InputCore",
             "Json"
         });
+
+		// Dedicated servers don't need effects, montage playback or HUD drawing
+		Definitions.Add("WITH_COSMETICS=" + (Target.Type == TargetType.Server ? "0" : "1"));
 		
 		// Uncomment if you are using online features
 		// PrivateDependencyModuleNames.Add("OnlineSubsystem");
@@ -6,3 +6,7 @@
 IMPLEMENT_PRIMARY_GAME_MODULE(FDefaultGameModuleImpl, Perplex, "Perplex");
 
 DEFINE_LOG_CATEGORY(LogWeapon);
+DEFINE_LOG_CATEGORY(LogPerplexNet);
+DEFINE_LOG_CATEGORY(LogPerplexAI);
+DEFINE_LOG_CATEGORY(LogPerplexStreaming);
+DEFINE_LOG_CATEGORY(LogPerplexMovement);
@@ -4,7 +4,16 @@
 
 #include "CoreMinimal.h"
 
+/** Compiles effects, montage playback and HUD drawing, set to 0 by Perplex.Build.cs for server targets */
+#ifndef WITH_COSMETICS
+#define WITH_COSMETICS 1
+#endif
+
 DECLARE_LOG_CATEGORY_EXTERN(LogWeapon, Log, All);
+DECLARE_LOG_CATEGORY_EXTERN(LogPerplexNet, Log, All);
+DECLARE_LOG_CATEGORY_EXTERN(LogPerplexAI, Log, All);
+DECLARE_LOG_CATEGORY_EXTERN(LogPerplexStreaming, Log, All);
+DECLARE_LOG_CATEGORY_EXTERN(LogPerplexMovement, Log, All);
 
 /** when you modify this, please note that this information can be saved with instances
 * also DefaultEngine.ini [/Script/Engine.CollisionProfile] should match with this list **/
@@ -0,0 +1,105 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MAIController.h"
+#include "Engine/World.h"
+#include "Characters/MCharacter.h"
+#include "GameModes/MJointGameMode.h"
+
+AMAIController::AMAIController(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	ReactionTime = 0.3f;
+	bTargetVisible = false;
+	TargetVisibleTime = 0.0f;
+}
+
+void AMAIController::BeginPlay()
+{
+	Super::BeginPlay();
+
+	AMJointGameMode* GameMode = GetWorld()->GetAuthGameMode<AMJointGameMode>();
+	if (GameMode)
+	{
+		GameMode->AssignTeam(this);
+	}
+}
+
+void AMAIController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	AMJointGameMode* GameMode = GetWorld()->GetAuthGameMode<AMJointGameMode>();
+	if (GameMode)
+	{
+		GameMode->ReleaseTeam(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AMAIController::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	AMCharacter* MyCharacter = Cast<AMCharacter>(GetPawn());
+	if (!MyCharacter)
+	{
+		return;
+	}
+
+	const AMCharacter* CurrentTarget = Target.Get();
+	const bool bShouldFire = CurrentTarget && bTargetVisible && CurrentTarget->GetHealth() > 0.0f && GetWorld()->GetTimeSeconds() - TargetVisibleTime >= ReactionTime;
+	if (bShouldFire && !MyCharacter->IsFiring() && MyCharacter->CanFire())
+	{
+		MyCharacter->StartWeaponFire();
+	}
+	else if (!bShouldFire && MyCharacter->IsFiring())
+	{
+		MyCharacter->StopWeaponFire();
+	}
+}
+
+void AMAIController::UnPossess()
+{
+	AMCharacter* MyCharacter = Cast<AMCharacter>(GetPawn());
+	if (MyCharacter)
+	{
+		MyCharacter->StopWeaponFire();
+	}
+
+	SetTarget(nullptr, false);
+
+	Super::UnPossess();
+}
+
+void AMAIController::SetTarget(AMCharacter* NewTarget, bool bNewTargetVisible)
+{
+	if (NewTarget != Target.Get() || (bNewTargetVisible && !bTargetVisible))
+	{
+		TargetVisibleTime = GetWorld()->GetTimeSeconds();
+	}
+
+	if (NewTarget != Target.Get())
+	{
+		if (NewTarget)
+		{
+			SetFocus(NewTarget);
+		}
+		else
+		{
+			ClearFocus(EAIFocusPriority::Gameplay);
+		}
+	}
+
+	Target = NewTarget;
+	bTargetVisible = NewTarget && bNewTargetVisible;
+}
+
+FVector AMAIController::GetAimDirection(const FVector& Origin) const
+{
+	const AMCharacter* CurrentTarget = Target.Get();
+	if (CurrentTarget && bTargetVisible)
+	{
+		return (CurrentTarget->GetActorLocation() - Origin).GetSafeNormal();
+	}
+
+	return GetControlRotation().Vector();
+}
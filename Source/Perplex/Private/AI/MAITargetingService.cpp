@@ -0,0 +1,219 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MAITargetingService.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "AI/MAIController.h"
+#include "Characters/MCharacter.h"
+#include "GameModes/MCharacterHash.h"
+#include "GameModes/MGameState.h"
+#include "Weapons/MWeapon.h"
+
+DECLARE_CYCLE_STAT(TEXT("AI Targeting"), STAT_AITargeting, STATGROUP_Game);
+
+namespace
+{
+	/** A visible candidate replaces the current visible target only if closer than this fraction of its distance */
+	const float TargetSwitchDistanceFraction = 0.5f;
+}
+
+FMAITargetingSettings::FMAITargetingSettings()
+	: bEnabled(true)
+	, SearchRadius(5000.0f)
+	, MaxCandidates(4)
+	, VisibilityRefreshInterval(0.25f)
+	, TraceBudgetMicroseconds(500.0f)
+{
+}
+
+FMAITargetingService::FMAITargetingService()
+	: NumTraces(0)
+	, NumDeferredTraces(0)
+{
+}
+
+void FMAITargetingService::Tick(UWorld* World, const FMCharacterHash& CharacterHash, const FMAITargetingSettings& Settings)
+{
+	NumTraces = 0;
+	NumDeferredTraces = 0;
+	if (!World || !Settings.bEnabled)
+	{
+		return;
+	}
+
+	const AMGameState* GameState = World->GetGameState<AMGameState>();
+	if (!GameState)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_AITargeting);
+
+	// Forget bots whose controllers are gone
+	for (auto It = Bots.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	for (TActorIterator<AMAIController> It(World); It; ++It)
+	{
+		AMAIController* Controller = *It;
+		AMCharacter* Character = Cast<AMCharacter>(Controller->GetPawn());
+		FBot& Bot = Bots.FindOrAdd(Controller);
+		if (!Character || Character->GetHealth() <= 0.0f)
+		{
+			Bot.Candidates.Reset();
+			Controller->SetTarget(nullptr, false);
+			continue;
+		}
+
+		UpdateCandidates(Character, Bot, CharacterHash, GameState->GetTeamRegistry(), Settings);
+	}
+
+	TraceVisibility(World, World->GetTimeSeconds(), Settings);
+
+	for (auto& Pair : Bots)
+	{
+		AMAIController* Controller = Pair.Key.Get();
+		if (Controller && Controller->GetPawn())
+		{
+			SelectTarget(Controller, Pair.Value);
+		}
+	}
+}
+
+void FMAITargetingService::UpdateCandidates(AMCharacter* Character, FBot& Bot, const FMCharacterHash& CharacterHash, const FMTeamRegistry& TeamRegistry, const FMAITargetingSettings& Settings)
+{
+	const FVector Location = Character->GetActorLocation();
+	TeamRegistry.GetEnemiesInRadius(CharacterHash, Character->GetGenericTeamId(), Location, Settings.SearchRadius, Enemies);
+
+	TArray<FCandidate, TInlineAllocator<16>> Candidates;
+	for (AMCharacter* Enemy : Enemies)
+	{
+		// Free for all is a team hostile to itself
+		if (Enemy == Character)
+		{
+			continue;
+		}
+
+		FCandidate& Candidate = Candidates[Candidates.AddUninitialized()];
+		Candidate.Character = Enemy;
+		Candidate.DistanceSq = FVector::DistSquared(Enemy->GetActorLocation(), Location);
+		Candidate.bVisible = false;
+		Candidate.LastTraceTime = -BIG_NUMBER;
+	}
+
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B)
+	{
+		return A.DistanceSq < B.DistanceSq;
+	});
+	if (Candidates.Num() > Settings.MaxCandidates)
+	{
+		Candidates.SetNum(Settings.MaxCandidates, false);
+	}
+
+	// Line of sight of previous candidates is still valid until it gets stale
+	for (FCandidate& Candidate : Candidates)
+	{
+		const FCandidate* Previous = Bot.Candidates.FindByPredicate([&Candidate](const FCandidate& Other)
+		{
+			return Other.Character == Candidate.Character;
+		});
+		if (Previous)
+		{
+			Candidate.bVisible = Previous->bVisible;
+			Candidate.LastTraceTime = Previous->LastTraceTime;
+		}
+	}
+
+	Bot.Candidates.Reset();
+	Bot.Candidates.Append(Candidates);
+}
+
+void FMAITargetingService::TraceVisibility(UWorld* World, float Time, const FMAITargetingSettings& Settings)
+{
+	PendingTraces.Reset();
+	for (auto& Pair : Bots)
+	{
+		AMAIController* Controller = Pair.Key.Get();
+		if (!Controller)
+		{
+			continue;
+		}
+
+		for (FCandidate& Candidate : Pair.Value.Candidates)
+		{
+			if (Time - Candidate.LastTraceTime >= Settings.VisibilityRefreshInterval)
+			{
+				PendingTraces.Add(FPendingTrace{ Controller, &Candidate });
+			}
+		}
+	}
+
+	PendingTraces.Sort([](const FPendingTrace& A, const FPendingTrace& B)
+	{
+		return A.Candidate->LastTraceTime < B.Candidate->LastTraceTime;
+	});
+
+	const double EndTime = FPlatformTime::Seconds() + Settings.TraceBudgetMicroseconds * 1.0e-6;
+	for (const FPendingTrace& Trace : PendingTraces)
+	{
+		if (NumTraces > 0 && FPlatformTime::Seconds() >= EndTime)
+		{
+			break;
+		}
+
+		AMCharacter* Character = Cast<AMCharacter>(Trace.Controller->GetPawn());
+		AMCharacter* Target = Trace.Candidate->Character.Get();
+		if (!Character || !Target)
+		{
+			continue;
+		}
+
+		FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(AITargeting), false, Character);
+		TraceParams.AddIgnoredActor(Character->GetWeapon());
+		TraceParams.AddIgnoredActor(Target);
+		TraceParams.AddIgnoredActor(Target->GetWeapon());
+
+		Trace.Candidate->bVisible = !World->LineTraceTestByChannel(Character->GetPawnViewLocation(), Target->GetActorLocation(), ECC_Visibility, TraceParams);
+		Trace.Candidate->LastTraceTime = Time;
+		NumTraces++;
+	}
+
+	NumDeferredTraces = PendingTraces.Num() - NumTraces;
+}
+
+void FMAITargetingService::SelectTarget(AMAIController* Controller, const FBot& Bot) const
+{
+	AMCharacter* CurrentTarget = Controller->GetTarget();
+	const FCandidate* Current = nullptr;
+	const FCandidate* Closest = nullptr;
+	for (const FCandidate& Candidate : Bot.Candidates)
+	{
+		if (Candidate.Character.Get() == CurrentTarget)
+		{
+			Current = &Candidate;
+		}
+		if (Candidate.bVisible && !Closest)
+		{
+			Closest = &Candidate;
+		}
+	}
+
+	// Stick to a visible target unless another one is much closer, so bots don't flick between similar targets
+	if (Current && Current->bVisible && Closest && Closest->DistanceSq > Current->DistanceSq * FMath::Square(TargetSwitchDistanceFraction))
+	{
+		Controller->SetTarget(CurrentTarget, true);
+	}
+	else if (Closest)
+	{
+		Controller->SetTarget(Closest->Character.Get(), true);
+	}
+	else
+	{
+		Controller->SetTarget(Current ? CurrentTarget : nullptr, false);
+	}
+}
@@ -0,0 +1,280 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MCrowdAvoidance.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Async/ParallelFor.h"
+#include "Components/CapsuleComponent.h"
+#include "Characters/MCharacter.h"
+#include "Characters/MCharacterMovementComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Crowd Avoidance"), STAT_CrowdAvoidance, STATGROUP_Game);
+
+namespace
+{
+	/** Neighbors further along the up axis than this fraction of NeighborRadius are on another floor */
+	const float MaxNeighborHeightFraction = 0.5f;
+
+	struct FAvoidanceNeighbor
+	{
+		/** Location relative to the agent, projected into its tangent plane */
+		FVector Location;
+
+		/** Velocity projected into the agent's tangent plane */
+		FVector Velocity;
+
+		float Radius;
+
+		float DistanceSq;
+	};
+
+	/**
+	* Cost of an imminent collision with a neighbor, in [0, 1] or above 1 if already overlapping and closing in.
+	* Each side is expected to take half of the avoidance, so the candidate counts twice.
+	*/
+	float GetCollisionCost(const FVector& Candidate, const FVector& Velocity, const FAvoidanceNeighbor& Neighbor, float TimeHorizon)
+	{
+		const FVector RelativeVelocity = Candidate * 2.0f - Velocity - Neighbor.Velocity;
+		const float Closing = RelativeVelocity | Neighbor.Location;
+		if (Closing <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		const float A = RelativeVelocity.SizeSquared();
+		const float C = Neighbor.DistanceSq - FMath::Square(Neighbor.Radius);
+		if (C <= 0.0f)
+		{
+			return 1.0f + Closing / FMath::Max(FMath::Sqrt(A * Neighbor.DistanceSq), KINDA_SMALL_NUMBER);
+		}
+
+		const float Discriminant = Closing * Closing - A * C;
+		if (A < KINDA_SMALL_NUMBER || Discriminant <= 0.0f)
+		{
+			return 0.0f;
+		}
+
+		const float Time = (Closing - FMath::Sqrt(Discriminant)) / A;
+		return Time < TimeHorizon ? 1.0f - Time / TimeHorizon : 0.0f;
+	}
+}
+
+FMCrowdAvoidanceSettings::FMCrowdAvoidanceSettings()
+	: bEnabled(true)
+	, NeighborRadius(600.0f)
+	, MaxNeighbors(8)
+	, TimeHorizon(1.5f)
+	, NumSampleDirections(12)
+	, NumSampleSpeeds(3)
+	, PreferredVelocityWeight(0.5f)
+	, MinAgentsForParallel(16)
+{
+}
+
+FMCrowdAvoidance::FMCrowdAvoidance()
+	: NumSolvedAgents(0)
+{
+}
+
+FIntVector FMCrowdAvoidance::GetCell(const FVector& Location, float CellSize) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void FMCrowdAvoidance::Tick(UWorld* World, const FMCrowdAvoidanceSettings& Settings)
+{
+	NumSolvedAgents = 0;
+	if (!World || !Settings.bEnabled)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CrowdAvoidance);
+
+	Locations.Reset();
+	Velocities.Reset();
+	Ups.Reset();
+	Radii.Reset();
+	PreferredVelocities.Reset();
+	MaxSpeeds.Reset();
+	AgentCells.Reset();
+	Movements.Reset();
+	SolvedAgents.Reset();
+
+	// Every living character is an obstacle, only those following paths are solved
+	for (TActorIterator<AMCharacter> It(World); It; ++It)
+	{
+		AMCharacter* Character = *It;
+		UMCharacterMovementComponent* Movement = Character->GetCustomCharacterMovementComponent();
+		if (Character->IsPendingKill() || Character->bTearOff || Character->GetHealth() <= 0.0f || !Movement)
+		{
+			continue;
+		}
+
+		const int32 Agent = Locations.Add(Character->GetActorLocation());
+		Velocities.Add(Character->GetVelocity());
+		Ups.Add(Character->GetActorUpVector());
+		Radii.Add(Character->GetCapsuleComponent()->GetScaledCapsuleRadius());
+		MaxSpeeds.Add(Movement->GetMaxSpeed());
+		AgentCells.Add(GetCell(Locations[Agent], Settings.NeighborRadius));
+		Movements.Add(Movement);
+
+		if (Movement->HasAvoidanceRequest())
+		{
+			PreferredVelocities.Add(Movement->GetAvoidancePreferredVelocity());
+			SolvedAgents.Add(Agent);
+		}
+		else
+		{
+			PreferredVelocities.Add(FVector::ZeroVector);
+		}
+	}
+
+	if (SolvedAgents.Num() == 0)
+	{
+		return;
+	}
+
+	// Spatial hash as agent indices sorted by cell, counted first and then filled in
+	Cells.Reset();
+	for (const FIntVector& Cell : AgentCells)
+	{
+		FCellRange* Range = Cells.Find(Cell);
+		if (!Range)
+		{
+			Range = &Cells.Add(Cell, FCellRange{ 0, 0 });
+		}
+		Range->Num++;
+	}
+
+	int32 Offset = 0;
+	for (auto& Pair : Cells)
+	{
+		Pair.Value.Start = Offset;
+		Offset += Pair.Value.Num;
+		Pair.Value.Num = 0;
+	}
+
+	SortedAgents.SetNumUninitialized(AgentCells.Num());
+	for (int32 Agent = 0; Agent < AgentCells.Num(); Agent++)
+	{
+		FCellRange& Range = Cells.FindChecked(AgentCells[Agent]);
+		SortedAgents[Range.Start + Range.Num++] = Agent;
+	}
+
+	Results.SetNumUninitialized(Locations.Num());
+	ParallelFor(SolvedAgents.Num(), [this, &Settings](int32 Index)
+	{
+		SolveAgent(SolvedAgents[Index], Settings);
+	}, SolvedAgents.Num() < Settings.MinAgentsForParallel);
+
+	for (int32 Agent : SolvedAgents)
+	{
+		Movements[Agent]->SetAvoidanceVelocity(Results[Agent]);
+	}
+
+	NumSolvedAgents = SolvedAgents.Num();
+}
+
+void FMCrowdAvoidance::SolveAgent(int32 Agent, const FMCrowdAvoidanceSettings& Settings)
+{
+	const FVector Location = Locations[Agent];
+	const FVector Up = Ups[Agent];
+	const FVector Velocity = FVector::VectorPlaneProject(Velocities[Agent], Up);
+	const FVector PreferredVelocity = FVector::VectorPlaneProject(PreferredVelocities[Agent], Up);
+	const float MaxSpeed = FMath::Max(MaxSpeeds[Agent], KINDA_SMALL_NUMBER);
+	const float NeighborRadiusSq = FMath::Square(Settings.NeighborRadius);
+	const float MaxNeighborHeight = Settings.NeighborRadius * MaxNeighborHeightFraction;
+
+	// Gather neighbors in surrounding cells, in the agent's tangent plane
+	TArray<FAvoidanceNeighbor, TInlineAllocator<32>> Neighbors;
+	const FIntVector& Cell = AgentCells[Agent];
+	for (int32 X = -1; X <= 1; X++)
+	for (int32 Y = -1; Y <= 1; Y++)
+	for (int32 Z = -1; Z <= 1; Z++)
+	{
+		const FCellRange* Range = Cells.Find(Cell + FIntVector(X, Y, Z));
+		if (!Range)
+		{
+			continue;
+		}
+
+		for (int32 i = Range->Start; i < Range->Start + Range->Num; i++)
+		{
+			const int32 Other = SortedAgents[i];
+			const FVector Delta = Locations[Other] - Location;
+			if (Other == Agent || Delta.SizeSquared() > NeighborRadiusSq || FMath::Abs(Delta | Up) > MaxNeighborHeight)
+			{
+				continue;
+			}
+
+			FAvoidanceNeighbor& Neighbor = Neighbors[Neighbors.AddUninitialized()];
+			Neighbor.Location = FVector::VectorPlaneProject(Delta, Up);
+			Neighbor.Velocity = FVector::VectorPlaneProject(Velocities[Other], Up);
+			Neighbor.Radius = Radii[Agent] + Radii[Other];
+			Neighbor.DistanceSq = Neighbor.Location.SizeSquared();
+		}
+	}
+
+	if (Neighbors.Num() == 0)
+	{
+		Results[Agent] = PreferredVelocity;
+		return;
+	}
+
+	if (Neighbors.Num() > Settings.MaxNeighbors)
+	{
+		Neighbors.Sort([](const FAvoidanceNeighbor& A, const FAvoidanceNeighbor& B)
+		{
+			return A.DistanceSq < B.DistanceSq;
+		});
+		Neighbors.SetNum(Settings.MaxNeighbors, false);
+	}
+
+	const auto GetCost = [&](const FVector& Candidate)
+	{
+		float Cost = Settings.PreferredVelocityWeight * (Candidate - PreferredVelocity).Size() / MaxSpeed;
+		for (const FAvoidanceNeighbor& Neighbor : Neighbors)
+		{
+			Cost += GetCollisionCost(Candidate, Velocity, Neighbor, Settings.TimeHorizon);
+		}
+		return Cost;
+	};
+
+	// Sample candidates on rings in the tangent plane, starting from the preferred direction
+	FVector AxisX = PreferredVelocity.GetSafeNormal();
+	if (AxisX.IsZero())
+	{
+		AxisX = Velocity.GetSafeNormal();
+	}
+	FVector AxisY;
+	if (AxisX.IsZero())
+	{
+		Up.FindBestAxisVectors(AxisX, AxisY);
+	}
+	else
+	{
+		AxisY = Up ^ AxisX;
+	}
+
+	FVector BestVelocity = PreferredVelocity;
+	float BestCost = GetCost(PreferredVelocity);
+	for (int32 SpeedIndex = 1; SpeedIndex <= Settings.NumSampleSpeeds && BestCost > 0.0f; SpeedIndex++)
+	{
+		const float Speed = MaxSpeed * SpeedIndex / Settings.NumSampleSpeeds;
+		for (int32 DirectionIndex = 0; DirectionIndex < Settings.NumSampleDirections; DirectionIndex++)
+		{
+			float Sin, Cos;
+			FMath::SinCos(&Sin, &Cos, 2.0f * PI * DirectionIndex / Settings.NumSampleDirections);
+			const FVector Candidate = (AxisX * Cos + AxisY * Sin) * Speed;
+			const float Cost = GetCost(Candidate);
+			if (Cost < BestCost)
+			{
+				BestVelocity = Candidate;
+				BestCost = Cost;
+			}
+		}
+	}
+
+	Results[Agent] = BestVelocity;
+}
@@ -0,0 +1,514 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MSurfaceNavGraph.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Algo/Reverse.h"
+#include "World/MGravityWell.h"
+
+DECLARE_CYCLE_STAT(TEXT("Surface Nav Find Path"), STAT_SurfaceNavFindPath, STATGROUP_Game);
+DECLARE_CYCLE_STAT(TEXT("Surface Nav Build"), STAT_SurfaceNavBuild, STATGROUP_Game);
+
+namespace
+{
+	/** Cells per side of blocks tested for collision before sampling individual cells */
+	const int32 SampleBlockSize = 8;
+
+	/** Hits closer than this fraction of cell size with similar normals are merged */
+	const float MergeDistanceFraction = 0.5f;
+	const float MergeNormalDot = 0.9f;
+
+	/** Edges may connect nodes up to this many cell sizes apart, enough for diagonal neighbors */
+	const float MaxEdgeLengthFraction = 1.75f;
+
+	const FName SurfaceNavTraceName = FName(TEXT("SurfaceNav"));
+
+	const FVector SampleAxes[] = {
+		FVector(0.0f, 0.0f, -1.0f),
+		FVector(0.0f, 0.0f, 1.0f),
+		FVector(1.0f, 0.0f, 0.0f),
+		FVector(-1.0f, 0.0f, 0.0f),
+		FVector(0.0f, 1.0f, 0.0f),
+		FVector(0.0f, -1.0f, 0.0f)
+	};
+
+	/** Gravity direction the graph assumes at a location, towards the closest well or world down */
+	FVector GetSampleGravityDirection(const FVector& Location, const TArray<AMGravityWell*>& Wells)
+	{
+		const AMGravityWell* ClosestWell = nullptr;
+		float ClosestDistanceSq = MAX_flt;
+		for (const AMGravityWell* Well : Wells)
+		{
+			const float DistanceSq = FVector::DistSquared(Location, Well->GetActorLocation());
+			if (DistanceSq < ClosestDistanceSq && Well->Contains(Location))
+			{
+				ClosestWell = Well;
+				ClosestDistanceSq = DistanceSq;
+			}
+		}
+
+		return ClosestWell ? (ClosestWell->GetActorLocation() - Location).GetSafeNormal() : FVector(0.0f, 0.0f, -1.0f);
+	}
+
+	FORCEINLINE bool IsCellInRange(const FIntVector& Cell, const FIntVector& Min, const FIntVector& Max)
+	{
+		return Cell.X >= Min.X && Cell.Y >= Min.Y && Cell.Z >= Min.Z && Cell.X <= Max.X && Cell.Y <= Max.Y && Cell.Z <= Max.Z;
+	}
+}
+
+FMSurfaceNavSettings::FMSurfaceNavSettings()
+	: CellSize(200.0f)
+	, NodeHeight(90.0f)
+	, AgentRadius(40.0f)
+	, MaxSlopeAngle(45.0f)
+	, MaxEdgeAngle(50.0f)
+	, bSampleWalls(false)
+	, TurnCost(1.0f)
+	, TraceChannel(ECC_Visibility)
+{
+}
+
+FMSurfaceNavGraph::FMSurfaceNavGraph()
+	: Bounds(ForceInit)
+	, CellSize(0.0f)
+	, Version(0)
+	, SearchId(0)
+{
+}
+
+void FMSurfaceNavGraph::Reset()
+{
+	Nodes.Reset();
+	NeighborOffsets.Reset();
+	Neighbors.Reset();
+	EdgeCosts.Reset();
+	CellNodes.Reset();
+	SearchNodes.Reset();
+	Bounds = FBox(ForceInit);
+}
+
+void FMSurfaceNavGraph::ApplyWorldOffset(const FVector& InOffset)
+{
+	for (FMSurfaceNavNode& Node : Nodes)
+	{
+		Node.Location += InOffset;
+	}
+	if (Bounds.IsValid)
+	{
+		Bounds = Bounds.ShiftBy(InOffset);
+	}
+
+	// Cells are aligned to the world origin, so nodes may have changed cells
+	RebuildCellLookup();
+}
+
+FIntVector FMSurfaceNavGraph::GetCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void FMSurfaceNavGraph::Build(UWorld* World, const FBox& InBounds, const FMSurfaceNavSettings& Settings)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SurfaceNavBuild);
+
+	Reset();
+	if (!World || !InBounds.IsValid)
+	{
+		return;
+	}
+
+	Bounds = InBounds;
+	CellSize = Settings.CellSize;
+
+	SampleCells(World, GetCell(Bounds.Min), GetCell(Bounds.Max), Settings, Nodes);
+	RebuildCellLookup();
+
+	TArray<bool> bReconnect;
+	bReconnect.Init(true, Nodes.Num());
+	TArray<TArray<FEdge>> Adjacency;
+	Adjacency.SetNum(Nodes.Num());
+	for (int32 i = 0; i < Nodes.Num(); i++)
+	{
+		ConnectNode(World, i, bReconnect, Settings, Adjacency);
+	}
+
+	Pack(Adjacency);
+	Version++;
+
+	UE_LOG(LogPerplexAI, Log, TEXT("Built surface navigation graph with %d nodes and %d edges"), Nodes.Num(), Neighbors.Num());
+}
+
+void FMSurfaceNavGraph::RebuildRegion(UWorld* World, const FBox& Region, const FMSurfaceNavSettings& Settings)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SurfaceNavBuild);
+
+	if (!World || !Bounds.IsValid || !Region.Intersect(Bounds))
+	{
+		return;
+	}
+
+	if (CellSize != Settings.CellSize)
+	{
+		Build(World, Bounds, Settings);
+		return;
+	}
+
+	// Dirty cells are resampled, edges are retraced for them and a margin of one cell around them
+	const FBox ClippedRegion = Region.Overlap(Bounds);
+	const FIntVector DirtyMin = GetCell(ClippedRegion.Min);
+	const FIntVector DirtyMax = GetCell(ClippedRegion.Max);
+	const FIntVector MarginMin = DirtyMin - FIntVector(1, 1, 1);
+	const FIntVector MarginMax = DirtyMax + FIntVector(1, 1, 1);
+
+	TArray<int32> Remap;
+	Remap.Init(INDEX_NONE, Nodes.Num());
+	TArray<FMSurfaceNavNode> NewNodes;
+	NewNodes.Reserve(Nodes.Num());
+	for (int32 i = 0; i < Nodes.Num(); i++)
+	{
+		if (!IsCellInRange(GetCell(Nodes[i].Location), DirtyMin, DirtyMax))
+		{
+			Remap[i] = NewNodes.Add(Nodes[i]);
+		}
+	}
+	const int32 NumKept = NewNodes.Num();
+
+	SampleCells(World, DirtyMin, DirtyMax, Settings, NewNodes);
+
+	// Keep edges that don't touch the margin
+	TArray<TArray<FEdge>> Adjacency;
+	Adjacency.SetNum(NewNodes.Num());
+	for (int32 i = 0; i < Nodes.Num(); i++)
+	{
+		if (Remap[i] == INDEX_NONE || IsCellInRange(GetCell(Nodes[i].Location), MarginMin, MarginMax))
+		{
+			continue;
+		}
+
+		for (int32 Edge = NeighborOffsets[i]; Edge < NeighborOffsets[i + 1]; Edge++)
+		{
+			const int32 Neighbor = Neighbors[Edge];
+			if (Remap[Neighbor] != INDEX_NONE && !IsCellInRange(GetCell(Nodes[Neighbor].Location), MarginMin, MarginMax))
+			{
+				Adjacency[Remap[i]].Add({ Remap[Neighbor], EdgeCosts[Edge] });
+			}
+		}
+	}
+
+	Nodes = MoveTemp(NewNodes);
+	RebuildCellLookup();
+
+	TArray<bool> bReconnect;
+	bReconnect.Init(false, Nodes.Num());
+	for (int32 i = 0; i < Nodes.Num(); i++)
+	{
+		bReconnect[i] = i >= NumKept || IsCellInRange(GetCell(Nodes[i].Location), MarginMin, MarginMax);
+	}
+
+	for (int32 i = 0; i < Nodes.Num(); i++)
+	{
+		if (bReconnect[i])
+		{
+			ConnectNode(World, i, bReconnect, Settings, Adjacency);
+		}
+	}
+
+	Pack(Adjacency);
+	SearchNodes.Reset();
+	Version++;
+}
+
+void FMSurfaceNavGraph::RebuildCellLookup()
+{
+	CellNodes.Reset();
+	if (CellSize <= 0.0f)
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < Nodes.Num(); i++)
+	{
+		CellNodes.Add(GetCell(Nodes[i].Location), i);
+	}
+}
+
+void FMSurfaceNavGraph::SampleCells(UWorld* World, const FIntVector& Min, const FIntVector& Max, const FMSurfaceNavSettings& Settings, TArray<FMSurfaceNavNode>& OutNodes) const
+{
+	TArray<AMGravityWell*> Wells;
+	for (TActorIterator<AMGravityWell> It(World); It; ++It)
+	{
+		Wells.Add(*It);
+	}
+
+	FCollisionQueryParams QueryParams(SurfaceNavTraceName, true);
+	QueryParams.bReturnPhysicalMaterial = false;
+
+	const float MinSurfaceDot = FMath::Cos(FMath::DegreesToRadians(Settings.MaxSlopeAngle));
+	const float MergeDistanceSq = FMath::Square(CellSize * MergeDistanceFraction);
+	const FCollisionShape ClearanceShape = FCollisionShape::MakeSphere(Settings.AgentRadius);
+
+	TArray<FVector> Directions;
+	TArray<int32> CellNodeIndices;
+
+	// Most of the volume is empty space, skip blocks without collision
+	for (int32 BlockX = Min.X; BlockX <= Max.X; BlockX += SampleBlockSize)
+	for (int32 BlockY = Min.Y; BlockY <= Max.Y; BlockY += SampleBlockSize)
+	for (int32 BlockZ = Min.Z; BlockZ <= Max.Z; BlockZ += SampleBlockSize)
+	{
+		const FIntVector BlockMin(BlockX, BlockY, BlockZ);
+		const FIntVector BlockMax(FMath::Min(BlockX + SampleBlockSize - 1, Max.X), FMath::Min(BlockY + SampleBlockSize - 1, Max.Y), FMath::Min(BlockZ + SampleBlockSize - 1, Max.Z));
+		const FVector BlockExtent = FVector(BlockMax - BlockMin + FIntVector(1, 1, 1)) * (CellSize * 0.5f);
+		const FVector BlockCenter = FVector(BlockMin) * CellSize + BlockExtent;
+		if (!World->OverlapBlockingTestByChannel(BlockCenter, FQuat::Identity, Settings.TraceChannel, FCollisionShape::MakeBox(BlockExtent + FVector(CellSize)), QueryParams))
+		{
+			continue;
+		}
+
+		for (int32 X = BlockMin.X; X <= BlockMax.X; X++)
+		for (int32 Y = BlockMin.Y; Y <= BlockMax.Y; Y++)
+		for (int32 Z = BlockMin.Z; Z <= BlockMax.Z; Z++)
+		{
+			const FIntVector Cell(X, Y, Z);
+			const FVector CellCenter = (FVector(Cell) + FVector(0.5f)) * CellSize;
+			const FVector GravityDir = GetSampleGravityDirection(CellCenter, Wells);
+
+			Directions.Reset();
+			Directions.Add(GravityDir);
+			if (Settings.bSampleWalls)
+			{
+				Directions.Append(SampleAxes, ARRAY_COUNT(SampleAxes));
+			}
+
+			CellNodeIndices.Reset();
+			for (const FVector& Direction : Directions)
+			{
+				// Start a cell outside so surfaces near the cell boundary are found, only hits inside the cell are kept
+				FHitResult Hit;
+				if (!World->LineTraceSingleByChannel(Hit, CellCenter - Direction * CellSize, CellCenter + Direction * CellSize, Settings.TraceChannel, QueryParams) ||
+					Hit.bStartPenetrating || GetCell(Hit.ImpactPoint) != Cell)
+				{
+					continue;
+				}
+
+				const FVector Up = Hit.ImpactNormal;
+				if (!Settings.bSampleWalls && (Up | -GravityDir) < MinSurfaceDot)
+				{
+					continue;
+				}
+
+				const FVector Location = Hit.ImpactPoint + Up * Settings.NodeHeight;
+
+				bool bMerged = false;
+				for (int32 NodeIndex : CellNodeIndices)
+				{
+					if ((OutNodes[NodeIndex].Up | Up) > MergeNormalDot && FVector::DistSquared(OutNodes[NodeIndex].Location, Location) < MergeDistanceSq)
+					{
+						bMerged = true;
+						break;
+					}
+				}
+
+				if (bMerged || World->OverlapBlockingTestByChannel(Hit.ImpactPoint + Up * (Settings.AgentRadius + 1.0f), FQuat::Identity, Settings.TraceChannel, ClearanceShape, QueryParams))
+				{
+					continue;
+				}
+
+				FMSurfaceNavNode& Node = OutNodes[OutNodes.AddUninitialized()];
+				Node.Location = Location;
+				Node.Up = Up;
+				CellNodeIndices.Add(OutNodes.Num() - 1);
+			}
+		}
+	}
+}
+
+void FMSurfaceNavGraph::ConnectNode(UWorld* World, int32 Index, const TArray<bool>& bReconnect, const FMSurfaceNavSettings& Settings, TArray<TArray<FEdge>>& Adjacency) const
+{
+	FCollisionQueryParams QueryParams(SurfaceNavTraceName, true);
+
+	const float MinUpDot = FMath::Cos(FMath::DegreesToRadians(Settings.MaxEdgeAngle));
+	const float MaxSlopeSin = FMath::Sin(FMath::DegreesToRadians(Settings.MaxSlopeAngle));
+	const float MaxEdgeLengthSq = FMath::Square(CellSize * MaxEdgeLengthFraction);
+
+	const FMSurfaceNavNode& Node = Nodes[Index];
+	const FIntVector Cell = GetCell(Node.Location);
+
+	TArray<int32> CandidateNodes;
+	for (int32 X = -1; X <= 1; X++)
+	for (int32 Y = -1; Y <= 1; Y++)
+	for (int32 Z = -1; Z <= 1; Z++)
+	{
+		CellNodes.MultiFind(Cell + FIntVector(X, Y, Z), CandidateNodes);
+	}
+
+	for (int32 Other : CandidateNodes)
+	{
+		// Edges between two reconnected nodes are added once, by the lower index
+		if (Other == Index || (bReconnect[Other] && Other < Index))
+		{
+			continue;
+		}
+
+		const FMSurfaceNavNode& OtherNode = Nodes[Other];
+		const FVector Delta = OtherNode.Location - Node.Location;
+		const float DistanceSq = Delta.SizeSquared();
+		const float UpDot = Node.Up | OtherNode.Up;
+		if (DistanceSq > MaxEdgeLengthSq || UpDot < MinUpDot)
+		{
+			continue;
+		}
+
+		// Reject steps up or down ledges
+		const float Distance = FMath::Sqrt(DistanceSq);
+		const FVector AverageUp = (Node.Up + OtherNode.Up).GetSafeNormal();
+		if (FMath::Abs(Delta | AverageUp) > Distance * MaxSlopeSin)
+		{
+			continue;
+		}
+
+		if (World->LineTraceTestByChannel(Node.Location, OtherNode.Location, Settings.TraceChannel, QueryParams))
+		{
+			continue;
+		}
+
+		const float Cost = Distance * (1.0f + Settings.TurnCost * (1.0f - UpDot));
+		Adjacency[Index].Add({ Other, Cost });
+		Adjacency[Other].Add({ Index, Cost });
+	}
+}
+
+void FMSurfaceNavGraph::Pack(const TArray<TArray<FEdge>>& Adjacency)
+{
+	NeighborOffsets.SetNumUninitialized(Adjacency.Num() + 1);
+	Neighbors.Reset();
+	EdgeCosts.Reset();
+
+	for (int32 i = 0; i < Adjacency.Num(); i++)
+	{
+		NeighborOffsets[i] = Neighbors.Num();
+		for (const FEdge& Edge : Adjacency[i])
+		{
+			Neighbors.Add(Edge.Node);
+			EdgeCosts.Add(Edge.Cost);
+		}
+	}
+	NeighborOffsets[Adjacency.Num()] = Neighbors.Num();
+
+	Neighbors.Shrink();
+	EdgeCosts.Shrink();
+}
+
+int32 FMSurfaceNavGraph::FindNearestNode(const FVector& Location) const
+{
+	if (CellNodes.Num() == 0)
+	{
+		return INDEX_NONE;
+	}
+
+	const FIntVector Cell = GetCell(Location);
+	int32 NearestNode = INDEX_NONE;
+	float NearestDistanceSq = MAX_flt;
+	for (int32 X = -1; X <= 1; X++)
+	for (int32 Y = -1; Y <= 1; Y++)
+	for (int32 Z = -1; Z <= 1; Z++)
+	{
+		for (auto It = CellNodes.CreateConstKeyIterator(Cell + FIntVector(X, Y, Z)); It; ++It)
+		{
+			const float DistanceSq = FVector::DistSquared(Nodes[It.Value()].Location, Location);
+			if (DistanceSq < NearestDistanceSq)
+			{
+				NearestNode = It.Value();
+				NearestDistanceSq = DistanceSq;
+			}
+		}
+	}
+
+	return NearestNode;
+}
+
+bool FMSurfaceNavGraph::FindPath(int32 StartNode, int32 GoalNode, TArray<int32>& OutPath, int32 MaxExpandedNodes) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_SurfaceNavFindPath);
+
+	OutPath.Reset();
+	if (!Nodes.IsValidIndex(StartNode) || !Nodes.IsValidIndex(GoalNode))
+	{
+		return false;
+	}
+
+	// Search states are invalidated by bumping the search id instead of clearing them
+	if (SearchNodes.Num() != Nodes.Num() || ++SearchId == 0)
+	{
+		SearchNodes.SetNumUninitialized(Nodes.Num());
+		FMemory::Memzero(SearchNodes.GetData(), SearchNodes.Num() * sizeof(FSearchNode));
+		SearchId = 1;
+	}
+
+	const FVector GoalLocation = Nodes[GoalNode].Location;
+	const auto OpenPredicate = [](const FOpenNode& A, const FOpenNode& B)
+	{
+		return A.EstimatedCost < B.EstimatedCost;
+	};
+
+	FSearchNode& Start = SearchNodes[StartNode];
+	Start.Cost = 0.0f;
+	Start.Parent = INDEX_NONE;
+	Start.SearchId = SearchId;
+	Start.bClosed = false;
+
+	OpenNodes.Reset();
+	OpenNodes.HeapPush({ FVector::Dist(Nodes[StartNode].Location, GoalLocation), StartNode }, OpenPredicate);
+
+	int32 NumExpanded = 0;
+	while (OpenNodes.Num() > 0)
+	{
+		FOpenNode Open;
+		OpenNodes.HeapPop(Open, OpenPredicate, false);
+
+		// Nodes are pushed again when a cheaper path is found instead of updating the heap, skip stale entries
+		FSearchNode& Current = SearchNodes[Open.Node];
+		if (Current.bClosed)
+		{
+			continue;
+		}
+		Current.bClosed = true;
+
+		if (Open.Node == GoalNode)
+		{
+			for (int32 Node = GoalNode; Node != INDEX_NONE; Node = SearchNodes[Node].Parent)
+			{
+				OutPath.Add(Node);
+			}
+			Algo::Reverse(OutPath);
+			return true;
+		}
+
+		if (MaxExpandedNodes > 0 && ++NumExpanded > MaxExpandedNodes)
+		{
+			return false;
+		}
+
+		for (int32 Edge = NeighborOffsets[Open.Node]; Edge < NeighborOffsets[Open.Node + 1]; Edge++)
+		{
+			const int32 Neighbor = Neighbors[Edge];
+			FSearchNode& Next = SearchNodes[Neighbor];
+			if (Next.SearchId != SearchId)
+			{
+				Next.Cost = MAX_flt;
+				Next.Parent = INDEX_NONE;
+				Next.SearchId = SearchId;
+				Next.bClosed = false;
+			}
+
+			const float Cost = Current.Cost + EdgeCosts[Edge];
+			if (!Next.bClosed && Cost < Next.Cost)
+			{
+				Next.Cost = Cost;
+				Next.Parent = Open.Node;
+				OpenNodes.HeapPush({ Cost + FVector::Dist(Nodes[Neighbor].Location, GoalLocation), Neighbor }, OpenPredicate);
+			}
+		}
+	}
+
+	return false;
+}
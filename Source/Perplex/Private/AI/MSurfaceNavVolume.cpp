@@ -0,0 +1,173 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MSurfaceNavVolume.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "Components/BrushComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Server/MFrameBudgetScheduler.h"
+
+AMSurfaceNavVolume::AMSurfaceNavVolume(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = true;
+
+	// The volume only marks a region, it shouldn't block sampling traces
+	GetBrushComponent()->SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+
+	ObstacleCheckInterval = 0.5f;
+	ObstacleMoveTolerance = 10.0f;
+	TimeSinceObstacleCheck = 0.0f;
+	bRebuildPending = false;
+}
+
+void AMSurfaceNavVolume::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Graph.RebuildCellLookup();
+
+	// Only the server moves AI
+	if (!HasAuthority())
+	{
+		SetActorTickEnabled(false);
+		return;
+	}
+
+	// Watch movable level geometry, characters and attached actors are too small and move too often to matter
+	const FBox VolumeBounds = GetComponentsBoundingBox(true);
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		AActor* Actor = *It;
+		USceneComponent* Root = Actor->GetRootComponent();
+		if (Actor == this || !Root || Root->Mobility != EComponentMobility::Movable || !Root->CanEverAffectNavigation() ||
+			!Actor->GetActorEnableCollision() || Actor->IsA<APawn>() || Actor->GetAttachParentActor())
+		{
+			continue;
+		}
+
+		const FBox Bounds = Actor->GetComponentsBoundingBox();
+		if (Bounds.IsValid && Bounds.Intersect(VolumeBounds))
+		{
+			Obstacles.Add({ Actor, Bounds });
+		}
+	}
+
+	if (Obstacles.Num() == 0)
+	{
+		SetActorTickEnabled(false);
+	}
+}
+
+void AMSurfaceNavVolume::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	TimeSinceObstacleCheck += DeltaSeconds;
+	if (TimeSinceObstacleCheck < ObstacleCheckInterval)
+	{
+		return;
+	}
+	TimeSinceObstacleCheck = 0.0f;
+
+	for (int32 i = Obstacles.Num() - 1; i >= 0; i--)
+	{
+		FObstacle& Obstacle = Obstacles[i];
+		AActor* Actor = Obstacle.Actor.Get();
+		if (!Actor || Actor->IsPendingKill())
+		{
+			MarkDirty(Obstacle.Bounds);
+			Obstacles.RemoveAtSwap(i);
+			continue;
+		}
+
+		const FBox Bounds = Actor->GetComponentsBoundingBox();
+		if (!Bounds.Min.Equals(Obstacle.Bounds.Min, ObstacleMoveTolerance) || !Bounds.Max.Equals(Obstacle.Bounds.Max, ObstacleMoveTolerance))
+		{
+			MarkDirty(Obstacle.Bounds);
+			MarkDirty(Bounds);
+			Obstacle.Bounds = Bounds;
+		}
+	}
+}
+
+void AMSurfaceNavVolume::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	Graph.ApplyWorldOffset(InOffset);
+	for (FObstacle& Obstacle : Obstacles)
+	{
+		Obstacle.Bounds = Obstacle.Bounds.ShiftBy(InOffset);
+	}
+	for (FBox& Region : DirtyRegions)
+	{
+		Region = Region.ShiftBy(InOffset);
+	}
+}
+
+void AMSurfaceNavVolume::BuildGraph()
+{
+	Modify();
+	Graph.Build(GetWorld(), GetComponentsBoundingBox(true), Settings);
+}
+
+void AMSurfaceNavVolume::MarkDirty(const FBox& Region)
+{
+	if (!Region.IsValid)
+	{
+		return;
+	}
+
+	// Merge overlapping regions so shared cells aren't sampled twice
+	FBox MergedRegion = Region;
+	for (int32 i = DirtyRegions.Num() - 1; i >= 0; i--)
+	{
+		if (DirtyRegions[i].Intersect(MergedRegion))
+		{
+			MergedRegion += DirtyRegions[i];
+			DirtyRegions.RemoveAtSwap(i);
+		}
+	}
+	DirtyRegions.Add(MergedRegion);
+
+	if (!bRebuildPending)
+	{
+		bRebuildPending = true;
+		FMFrameBudgetScheduler::Schedule(GetWorld(), EMDeferredWorkCategory::Navigation, EMDeferredWorkPriority::Low, this, [this]()
+		{
+			RebuildDirtyRegions();
+		});
+	}
+}
+
+void AMSurfaceNavVolume::RebuildDirtyRegions()
+{
+	bRebuildPending = false;
+
+	for (const FBox& Region : DirtyRegions)
+	{
+		Graph.RebuildRegion(GetWorld(), Region, Settings);
+	}
+	DirtyRegions.Reset();
+}
+
+AMSurfaceNavVolume* AMSurfaceNavVolume::FindVolume(UWorld* World, const FVector& Location)
+{
+	if (!World)
+	{
+		return nullptr;
+	}
+
+	for (TActorIterator<AMSurfaceNavVolume> It(World); It; ++It)
+	{
+		if (It->GetGraph().NumNodes() > 0 && It->GetComponentsBoundingBox(true).IsInsideOrOn(Location))
+		{
+			return *It;
+		}
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,156 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MSurfacePathFollowingComponent.h"
+#include "GameFramework/Pawn.h"
+#include "GameFramework/Controller.h"
+#include "AI/MSurfaceNavVolume.h"
+#include "Characters/MCharacterMovementComponent.h"
+
+UMSurfacePathFollowingComponent::UMSurfacePathFollowingComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	AcceptanceRadius = 50.0f;
+	MaxSearchNodes = 20000;
+	PathIndex = 0;
+	GoalLocation = FVector::ZeroVector;
+	GraphVersion = 0;
+}
+
+APawn* UMSurfacePathFollowingComponent::GetPawn() const
+{
+	AActor* Owner = GetOwner();
+	AController* Controller = Cast<AController>(Owner);
+	return Controller ? Controller->GetPawn() : Cast<APawn>(Owner);
+}
+
+UMCharacterMovementComponent* UMSurfacePathFollowingComponent::GetMovement() const
+{
+	APawn* Pawn = GetPawn();
+	return Pawn ? Cast<UMCharacterMovementComponent>(Pawn->GetMovementComponent()) : nullptr;
+}
+
+void UMSurfacePathFollowingComponent::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	GoalLocation += InOffset;
+}
+
+bool UMSurfacePathFollowingComponent::MoveToLocation(const FVector& Goal)
+{
+	GoalLocation = Goal;
+	if (!FindPath())
+	{
+		StopMovement();
+		return false;
+	}
+
+	SetComponentTickEnabled(true);
+	return true;
+}
+
+void UMSurfacePathFollowingComponent::StopMovement()
+{
+	Path.Reset();
+	PathIndex = 0;
+	SetComponentTickEnabled(false);
+
+	if (UMCharacterMovementComponent* Movement = GetMovement())
+	{
+		Movement->StopActiveMovement();
+	}
+}
+
+bool UMSurfacePathFollowingComponent::IsFollowingPath() const
+{
+	return Path.Num() > 0;
+}
+
+bool UMSurfacePathFollowingComponent::FindPath()
+{
+	Path.Reset();
+	PathIndex = 0;
+
+	APawn* Pawn = GetPawn();
+	if (!Pawn)
+	{
+		return false;
+	}
+
+	const FVector Start = Pawn->GetActorLocation();
+	AMSurfaceNavVolume* NavVolume = AMSurfaceNavVolume::FindVolume(GetWorld(), Start);
+	if (!NavVolume)
+	{
+		return false;
+	}
+
+	const FMSurfaceNavGraph& Graph = NavVolume->GetGraph();
+	const int32 StartNode = Graph.FindNearestNode(Start);
+	const int32 GoalNode = Graph.FindNearestNode(GoalLocation);
+	if (!Graph.FindPath(StartNode, GoalNode, Path, MaxSearchNodes))
+	{
+		return false;
+	}
+
+	Volume = NavVolume;
+	GraphVersion = Graph.GetVersion();
+	return true;
+}
+
+void UMSurfacePathFollowingComponent::TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	APawn* Pawn = GetPawn();
+	UMCharacterMovementComponent* Movement = GetMovement();
+	if (!Pawn || !Movement || !Volume.IsValid() || Path.Num() == 0)
+	{
+		StopMovement();
+		return;
+	}
+
+	// Part of the graph was rebuilt, node indices are stale
+	if (Volume->GetGraph().GetVersion() != GraphVersion && !FindPath())
+	{
+		StopMovement();
+		return;
+	}
+
+	const FMSurfaceNavGraph& Graph = Volume->GetGraph();
+	const FVector Location = Pawn->GetActorLocation();
+
+	// Advance over reached points, distance is measured along the surface so node height doesn't matter
+	FVector Target;
+	FVector Up;
+	for (;;)
+	{
+		const bool bGoal = PathIndex >= Path.Num();
+		const FMSurfaceNavNode& Node = Graph.GetNode(Path[FMath::Min(PathIndex, Path.Num() - 1)]);
+		const FMSurfaceNavNode& PreviousNode = Graph.GetNode(Path[FMath::Max(PathIndex - 1, 0)]);
+		Target = bGoal ? GoalLocation : Node.Location;
+
+		// Blend surfaces while crossing an edge, so gravity turns halfway instead of at either end
+		Up = (PreviousNode.Up + Node.Up).GetSafeNormal();
+		if (Up.IsZero())
+		{
+			Up = Node.Up;
+		}
+
+		if (FVector::VectorPlaneProject(Target - Location, Up).SizeSquared() > FMath::Square(AcceptanceRadius))
+		{
+			break;
+		}
+
+		if (bGoal)
+		{
+			StopMovement();
+			return;
+		}
+		PathIndex++;
+	}
+
+	const FVector Direction = FVector::VectorPlaneProject(Target - Location, Up).GetSafeNormal();
+	Movement->RequestSurfaceMove(Direction * Movement->GetMaxSpeed(), Up, false);
+}
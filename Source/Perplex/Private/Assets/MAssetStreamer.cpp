@@ -0,0 +1,55 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MAssetStreamer.h"
+#include "Engine/AssetManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Late Streamed Assets"), STAT_LateStreamedAssets, STATGROUP_Game);
+
+namespace
+{
+	TAsyncLoadPriority GetAsyncLoadPriority(EMAssetStreamPriority Priority)
+	{
+		switch (Priority)
+		{
+		case EMAssetStreamPriority::Gameplay:
+			return FStreamableManager::AsyncLoadHighPriority;
+		case EMAssetStreamPriority::Cosmetic:
+			return FStreamableManager::AsyncLoadHighPriority / 2;
+		default:
+			return FStreamableManager::DefaultAsyncLoadPriority;
+		}
+	}
+}
+
+FStreamableManager& FMAssetStreamer::GetStreamableManager()
+{
+	// Shares the asset manager's lifetime, so handles are released with it instead of outliving PIE sessions
+	return UAssetManager::GetStreamableManager();
+}
+
+TSharedPtr<FStreamableHandle> FMAssetStreamer::RequestLoad(const TArray<FSoftObjectPath>& Paths, EMAssetStreamPriority Priority, FStreamableDelegate Callback)
+{
+	TArray<FSoftObjectPath> ValidPaths;
+	ValidPaths.Reserve(Paths.Num());
+	for (const FSoftObjectPath& Path : Paths)
+	{
+		if (Path.IsValid())
+		{
+			ValidPaths.AddUnique(Path);
+		}
+	}
+
+	if (ValidPaths.Num() == 0)
+	{
+		Callback.ExecuteIfBound();
+		return nullptr;
+	}
+
+	return GetStreamableManager().RequestAsyncLoad(ValidPaths, MoveTemp(Callback), GetAsyncLoadPriority(Priority));
+}
+
+void FMAssetStreamer::NoteLateAsset(const FSoftObjectPath& Path)
+{
+	INC_DWORD_STAT(STAT_LateStreamedAssets);
+	UE_LOG(LogPerplexStreaming, Verbose, TEXT("Skipped %s, still streaming"), *Path.ToString());
+}
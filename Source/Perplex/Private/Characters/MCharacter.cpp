@@ -3,14 +3,33 @@
 #include "MCharacter.h"
 #include "Components/SkeletalMeshComponent.h"
 #include "Components/CapsuleComponent.h"
+#include "Engine/ActorChannel.h"
 #include "Kismet/GameplayStatics.h"
+#include "Net/DataBunch.h"
 #include "TimerManager.h"
 #include "UnrealNetwork.h"
+#include "AI/MAIController.h"
+#include "Assets/MAssetStreamer.h"
 #include "Characters/MCharacterMovementComponent.h"
 #include "Characters/MPlayerController.h"
+#include "GameModes/MGameState.h"
+#include "GameModes/MJointGameMode.h"
+#include "Net/MNetBandwidthProfiler.h"
+#include "Server/MFrameBudgetScheduler.h"
 #include "Weapons/MWeapon.h"
 #include "Weapons/MDamageType.h"
 
+namespace
+{
+	/** Animation doesn't advance further than this per on-demand server pose update, in seconds */
+	const float MaxServerPoseDeltaTime = 0.25f;
+
+	/** Hitboxes may reach this far outside the capsule bounds */
+	const float HitboxBoundsMargin = 50.0f;
+}
+
+const float AMCharacter::HitboxCapsuleMargin = 100.0f;
+
 FMTakeHitInfo::FMTakeHitInfo()
 	: ActualDamage(0.0f)
 	, DamageTypeClass(nullptr)
@@ -107,24 +126,51 @@ AMCharacter::AMCharacter(const FObjectInitializer& ObjectInitializer)
 	bUseControllerRotationPitch = false;
 	bUseControllerRotationRoll = false;
 	bUseControllerRotationYaw = false;
+
+	AIControllerClass = AMAIController::StaticClass();
+
+	MovementPrecision = EMRepMovementPrecision::Default;
+	ServerPoseRefreshInterval = 0.1f;
+	bUseMeshUpdateRateOptimizations = true;
+	LastServerPoseRefreshTime = 0.0f;
+	TeamId = FGenericTeamId::NoTeam;
+	HitboxUpdateFrame = 0;
 }
 
 void AMCharacter::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
 
+	// Precision isn't sent, server and proxies take it from the class
+	MRepMovement.Precision = MovementPrecision;
+
+	// Weapon traces test hitboxes, physics asset bodies would block them otherwise
+	if (UsesHitboxes())
+	{
+		GetMesh()->SetCollisionResponseToChannel(COLLISION_WEAPON, ECR_Ignore);
+	}
+
 	if (Role == ROLE_Authority)
 	{
 		Health = 10.0f;
 
-		// Spawn starting weapon
-		FActorSpawnParameters SpawnInfo;
-		SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-		AMWeapon* NewWeapon = GetWorld()->SpawnActor<AMWeapon>(StartWeaponClass, SpawnInfo);
+		for (const FMHexModule& Module : DefaultHexModules)
+		{
+			Hex.EquipModule(Module);
+		}
+		HexStats.Write(Hex.GetStats());
 
-		EquipWeapon(NewWeapon);
+		// Usually preloaded with the loadout, otherwise spawned once streamed instead of blocking the server
+		TArray<FSoftObjectPath> Paths;
+		FMAssetStreamer::AddPath(Paths, StartWeaponClass);
+		StartWeaponHandle = FMAssetStreamer::RequestLoad(Paths, EMAssetStreamPriority::Gameplay, FStreamableDelegate::CreateUObject(this, &AMCharacter::SpawnStartWeapon));
 	}
 
+	// Termination duration times ragdolls, so servers stream it too
+	TArray<FSoftObjectPath> Paths;
+	FMAssetStreamer::AddPath(Paths, TerminationAnimation);
+	StreamedAssetsHandle = FMAssetStreamer::RequestLoad(Paths, EMAssetStreamPriority::Gameplay);
+
 	// set initial mesh visibility (3rd person view)
 	UpdateCharacterMeshes();
 }
@@ -161,10 +207,30 @@ void AMCharacter::PawnClientRestart()
 	SetCurrentWeapon(CurrentWeapon);
 }
 
+void AMCharacter::PossessedBy(AController* NewController)
+{
+	Super::PossessedBy(NewController);
+
+	UpdateTeam();
+}
+
+void AMCharacter::UnPossessed()
+{
+	Super::UnPossessed();
+
+	TeamId = FGenericTeamId::NoTeam;
+}
+
 void AMCharacter::PostNetReceiveLocationAndRotation()
 {
+	// Use exact quaternion, ReplicatedMovement.Rotation is only a rotator copy of it
+	const FQuat NewRotation = MRepMovement.Rotation;
+
+	// Replicated location is relative to the zero origin, move it onto the local one
+	FVector NewLocation = FRepMovement::RebaseOntoLocalOrigin(ReplicatedMovement.Location, this);
+
 	// Always consider Location as changed if we were spawned this tick as in that case our replicated Location was set as part of spawning, before PreNetReceive().
-	if (ReplicatedMovement.Location == GetActorLocation() && ReplicatedMovement.Rotation == GetActorRotation() && CreationTime != GetWorld()->TimeSeconds)
+	if (NewLocation == GetActorLocation() && NewRotation == GetActorQuat() && CreationTime != GetWorld()->TimeSeconds)
 	{
 		return;
 	}
@@ -173,17 +239,28 @@ void AMCharacter::PostNetReceiveLocationAndRotation()
 	{
 		const FVector OldLocation = GetActorLocation();
 		const FQuat OldRotation = GetActorQuat();
-		const FQuat NewRotation = ReplicatedMovement.Rotation.Quaternion();
 
-		// Correction to make sure pawn doesn't penetrate floor after replication rounding.
-		ReplicatedMovement.Location += NewRotation.GetAxisZ() * 0.01f;
+		// Correction to make sure pawn doesn't penetrate floor after location quantization.
+		NewLocation += NewRotation.GetAxisZ() * MRepMovement.GetLocationQuantum() * 0.5f;
 
-		SetActorLocationAndRotation(ReplicatedMovement.Location, ReplicatedMovement.Rotation, /*bSweep=*/ false);
+		if (CharacterMovement && MRepMovement.bRelativeToBase)
+		{
+			// Delayed snapshots would lag behind a moving base, which is followed locally instead
+			CharacterMovement->ResetMovementSnapshots();
+		}
+		else if (CharacterMovement && CharacterMovement->IsUsingSnapshotInterpolation())
+		{
+			// Movement component renders buffered snapshots with a delay instead of snapping
+			CharacterMovement->AddMovementSnapshot(MRepMovement.ServerTimeStamp, NewLocation, NewRotation, MRepMovement.LinearVelocity);
+			return;
+		}
+
+		SetActorLocationAndRotation(NewLocation, NewRotation, /*bSweep=*/ false);
 
 		INetworkPredictionInterface* PredictionInterface = Cast<INetworkPredictionInterface>(GetMovementComponent());
 		if (PredictionInterface)
 		{
-			PredictionInterface->SmoothCorrection(OldLocation, OldRotation, ReplicatedMovement.Location, NewRotation);
+			PredictionInterface->SmoothCorrection(OldLocation, OldRotation, NewLocation, NewRotation);
 		}
 	}
 }
@@ -192,10 +269,100 @@ void AMCharacter::PreReplication(IRepChangedPropertyTracker & ChangedPropertyTra
 {
 	Super::PreReplication(ChangedPropertyTracker);
 
+	// Physics driven movement (ragdolls) still goes through engine replicated movement
+	const bool bUseMRepMovement = bReplicateMovement && !ReplicatedMovement.bRepPhysics;
+	if (bUseMRepMovement)
+	{
+		MRepMovement.Location = FRepMovement::RebaseOntoZeroOrigin(GetActorLocation(), this);
+		MRepMovement.Rotation = GetActorQuat();
+		MRepMovement.LinearVelocity = ReplicatedMovement.LinearVelocity;
+		MRepMovement.bRelativeToBase = false;
+
+		// On a moving base the relative pose stays the same while standing still, so it doesn't need to be sent again
+		FVector RelativeLocation;
+		FQuat RelativeRotation;
+		if (CharacterMovement && CharacterMovement->bUseRelativeBasePose && CharacterMovement->GetRelativeBasePose(RelativeLocation, RelativeRotation) &&
+			RelativeLocation.GetAbsMax() < FMRepMovement::MaxRelativeLocation)
+		{
+			const FQuat BaseRotation = MRepMovement.Rotation * RelativeRotation.Inverse();
+			MRepMovement.Location = RelativeLocation;
+			MRepMovement.Rotation = RelativeRotation;
+			MRepMovement.LinearVelocity = BaseRotation.UnrotateVector(MRepMovement.LinearVelocity);
+			MRepMovement.bRelativeToBase = true;
+		}
+		MRepMovement.ServerTimeStamp = FMRepMovement::MakeTimeStamp(GetWorld()->GetTimeSeconds());
+	}
+	DOREPLIFETIME_ACTIVE_OVERRIDE(AMCharacter, MRepMovement, bUseMRepMovement);
+	DOREPLIFETIME_ACTIVE_OVERRIDE(AActor, ReplicatedMovement, bReplicateMovement && !bUseMRepMovement);
+
+	// MRepMovement carries its own timestamp, the engine one is only needed for linear smoothing
+	static UProperty* ServerTimeStampProperty = FindFieldChecked<UProperty>(ACharacter::StaticClass(), TEXT("ReplicatedServerLastTransformUpdateTimeStamp"));
+	const bool bLinearSmoothing = CharacterMovement && CharacterMovement->NetworkSmoothingMode == ENetworkSmoothingMode::Linear;
+	ChangedPropertyTracker.SetCustomIsActiveOverride(ServerTimeStampProperty->RepIndex, !bUseMRepMovement || bLinearSmoothing);
+
+	if (Role == ROLE_Authority)
+	{
+		PackedMovementFlags = (bWantsToRun ? EMMovementFlags::WantsToRun : EMMovementFlags::None)
+			| (bIsAiming ? EMMovementFlags::IsAiming : EMMovementFlags::None);
+	}
+
 	// Only replicate this property for a short duration after it changes so join in progress players don't get spammed with fx when joining late
 	DOREPLIFETIME_ACTIVE_OVERRIDE(AMCharacter, LastTakeHitInfo, GetWorld() && GetWorld()->GetTimeSeconds() < LastTakeHitTimeTimeout);
 }
 
+bool AMCharacter::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	if (bAlwaysRelevant || IsOwnedBy(ViewTarget) || IsOwnedBy(RealViewer) || this == ViewTarget || ViewTarget == Instigator)
+	{
+		return true;
+	}
+
+	// Gravity well aware grid with planet occlusion replaces plain distance culling
+	const AMJointGameMode* GameMode = GetWorld()->GetAuthGameMode<AMJointGameMode>();
+	if (GameMode && GameMode->GetRelevancyGrid().IsEnabled())
+	{
+		return GameMode->GetRelevancyGrid().IsRelevant(RealViewer, this, SrcLocation, GetActorLocation());
+	}
+
+	return Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
+bool AMCharacter::CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack)
+{
+	FMNetBandwidthProfiler::FScopedSentRPC ScopedSentRPC(this, Function);
+	return Super::CallRemoteFunction(Function, Parameters, OutParms, Stack);
+}
+
+void AMCharacter::ProcessEvent(UFunction* Function, void* Parameters)
+{
+	// RPCs from clients are executed through here on the server
+	if (Function->FunctionFlags & FUNC_NetServer)
+	{
+		FMNetBandwidthProfiler* Profiler = FMNetBandwidthProfiler::Find(GetWorld());
+		if (Profiler)
+		{
+			Profiler->RecordReceivedRPC(this, Function, Parameters, GetNetConnection());
+		}
+	}
+
+	Super::ProcessEvent(Function, Parameters);
+}
+
+bool AMCharacter::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
+{
+	// Actor properties were just written, components follow
+	const int64 ActorBits = Bunch->GetNumBits();
+	const bool bWroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
+
+	FMNetBandwidthProfiler* Profiler = FMNetBandwidthProfiler::Find(GetWorld());
+	if (Profiler)
+	{
+		Profiler->RecordReplicatedProperties(this, Channel->Connection, *RepFlags, ActorBits, Bunch->GetNumBits() - ActorBits);
+	}
+
+	return bWroteSomething;
+}
+
 void AMCharacter::GetLifetimeReplicatedProps(TArray< FLifetimeProperty > & OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
@@ -204,14 +371,18 @@ void AMCharacter::GetLifetimeReplicatedProps(TArray< FLifetimeProperty > & OutLi
 	//DOREPLIFETIME_CONDITION(AMCharacter, Inventory, COND_OwnerOnly);
 
 	// everyone except local owner: flag change is locally instigated
-	DOREPLIFETIME_CONDITION(AMCharacter, bIsAiming, COND_SkipOwner);
-	DOREPLIFETIME_CONDITION(AMCharacter, bWantsToRun, COND_SkipOwner);
+	DOREPLIFETIME_CONDITION(AMCharacter, PackedMovementFlags, COND_SkipOwner);
 
 	DOREPLIFETIME_CONDITION(AMCharacter, LastTakeHitInfo, COND_Custom);
 
+	// same audience as AActor::ReplicatedMovement, which it replaces
+	DOREPLIFETIME_CONDITION(AMCharacter, MRepMovement, COND_SimulatedOrPhysics);
+
 	// everyone
 	DOREPLIFETIME(AMCharacter, CurrentWeapon);
 	DOREPLIFETIME(AMCharacter, Health);
+	DOREPLIFETIME(AMCharacter, TeamId);
+	DOREPLIFETIME(AMCharacter, HexStats);
 }
 
 void AMCharacter::StartWeaponFire()
@@ -249,12 +420,12 @@ bool AMCharacter::CanFire() const
 
 void AMCharacter::StartAim()
 {
-	bIsAiming = true;
+	SetAiming(true);
 }
 
 void AMCharacter::StopAim()
 {
-	bIsAiming = false;
+	SetAiming(false);
 }
 
 void AMCharacter::LaunchCharacterRotated(FVector LaunchVelocity, bool bHorizontalOverride, bool bVerticalOverride)
@@ -396,6 +567,7 @@ void AMCharacter::StopRun()
 
 float AMCharacter::PlayAnimMontage(class UAnimMontage* AnimMontage, float InPlayRate, FName StartSectionName)
 {
+#if WITH_COSMETICS
 	USkeletalMeshComponent* UseMesh = GetCharacterMesh();
 	if (AnimMontage && UseMesh && UseMesh->AnimScriptInstance)
 	{
@@ -403,25 +575,50 @@ float AMCharacter::PlayAnimMontage(class UAnimMontage* AnimMontage, float InPlay
 	}
 
 	return 0.0f;
+#else
+	// Not played on servers, but durations still drive equip and ragdoll timing
+	return (AnimMontage && InPlayRate > 0.0f) ? AnimMontage->GetPlayLength() / InPlayRate : 0.0f;
+#endif
 }
 
 void AMCharacter::StopAnimMontage(class UAnimMontage* AnimMontage)
 {
+#if WITH_COSMETICS
 	USkeletalMeshComponent* UseMesh = GetCharacterMesh();
 	if (AnimMontage && UseMesh && UseMesh->AnimScriptInstance &&
 		UseMesh->AnimScriptInstance->Montage_IsPlaying(AnimMontage))
 	{
 		UseMesh->AnimScriptInstance->Montage_Stop(AnimMontage->BlendOut.GetBlendTime(), AnimMontage);
 	}
+#endif
 }
 
 void AMCharacter::StopAllAnimMontages()
 {
+#if WITH_COSMETICS
 	USkeletalMeshComponent* UseMesh = GetCharacterMesh();
 	if (UseMesh && UseMesh->AnimScriptInstance)
 	{
 		UseMesh->AnimScriptInstance->Montage_Stop(0.0f);
 	}
+#endif
+}
+
+void AMCharacter::SpawnStartWeapon()
+{
+	StartWeaponHandle.Reset();
+
+	UClass* WeaponClass = StartWeaponClass.Get();
+	if (!WeaponClass || CurrentWeapon || bIsDying || Health <= 0.0f)
+	{
+		return;
+	}
+
+	FActorSpawnParameters SpawnInfo;
+	SpawnInfo.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	AMWeapon* NewWeapon = GetWorld()->SpawnActor<AMWeapon>(WeaponClass, SpawnInfo);
+
+	EquipWeapon(NewWeapon);
 }
 
 void AMCharacter::EquipWeapon(AMWeapon* Weapon)
@@ -491,6 +688,14 @@ void AMCharacter::DestroyInventory()
 		return;
 	}
 	
+	if (CurrentWeapon)
+	{
+		AMWeapon* Weapon = CurrentWeapon;
+		CurrentWeapon = nullptr;
+		Weapon->OnLeaveInventory();
+		Weapon->Destroy();
+	}
+
 	/*
 	for (int32 i = Inventory.Num() - 1; i >= 0; i--)
 	{
@@ -512,6 +717,17 @@ float AMCharacter::TakeDamage(float Damage, struct FDamageEvent const& DamageEve
 		return 0.f;
 	}
 
+	// Scale point damage by the zone that was hit, Item holds the hitbox index resolved on the server
+	if (DamageEvent.IsOfType(FPointDamageEvent::ClassID) && DamageEvent.DamageTypeClass)
+	{
+		const UMDamageType* MDamageType = Cast<UMDamageType>(DamageEvent.DamageTypeClass->GetDefaultObject());
+		if (MDamageType)
+		{
+			const FPointDamageEvent& PointDamageEvent = *((FPointDamageEvent const*)(&DamageEvent));
+			Damage *= MDamageType->GetDamageMultiplier(GetHitZone(PointDamageEvent.HitInfo.Item));
+		}
+	}
+
 	const float ActualDamage = Super::TakeDamage(Damage, DamageEvent, EventInstigator, DamageCauser);
 	if (ActualDamage > 0.f)
 	{
@@ -582,6 +798,12 @@ bool AMCharacter::Die(float KillingDamage, FDamageEvent const& DamageEvent, ACon
 	// TODO
 	//GetWorld()->GetAuthGameMode<AShooterGameMode>()->Killed(Killer, KilledPlayer, this, DamageType);
 
+	// Adaptive rate no longer applies, replicate death at the default rate
+	AMJointGameMode* GameMode = GetWorld()->GetAuthGameMode<AMJointGameMode>();
+	if (GameMode)
+	{
+		GameMode->GetNetUpdateRateController().RemoveCharacter(this);
+	}
 	NetUpdateFrequency = GetDefault<AMCharacter>()->NetUpdateFrequency;
 	GetCharacterMovement()->ForceReplicationUpdate();
 
@@ -623,8 +845,11 @@ void AMCharacter::OnDeath(float KillingDamage, struct FDamageEvent const& Damage
 		}
 	}
 
-	// remove all weapons
-	DestroyInventory();
+	// remove all weapons, deferred so mass deaths don't spike a single server frame
+	FMFrameBudgetScheduler::Schedule(GetWorld(), EMDeferredWorkCategory::Inventory, EMDeferredWorkPriority::Low, this, [this]()
+	{
+		DestroyInventory();
+	});
 
 	// switch back to 3rd person view
 	UpdateCharacterMeshes();
@@ -640,7 +865,7 @@ void AMCharacter::OnDeath(float KillingDamage, struct FDamageEvent const& Damage
 	SetActorEnableCollision(true);
 
 	// Death anim
-	float TerminationAnimDuration = PlayAnimMontage(TerminationAnimation);
+	float TerminationAnimDuration = PlayAnimMontage(FMAssetStreamer::GetLoaded(TerminationAnimation));
 
 	// Ragdoll
 	if (TerminationAnimDuration > 0.f)
@@ -656,6 +881,13 @@ void AMCharacter::OnDeath(float KillingDamage, struct FDamageEvent const& Damage
 		FTimerHandle TimerHandle;
 		GetWorldTimerManager().SetTimer(TimerHandle, this, &AMCharacter::SetRagdollPhysics, FMath::Max(0.1f, TriggerRagdollTime), false);
 	}
+	else if (Role == ROLE_Authority)
+	{
+		FMFrameBudgetScheduler::Schedule(GetWorld(), EMDeferredWorkCategory::Ragdoll, EMDeferredWorkPriority::Normal, this, [this]()
+		{
+			SetRagdollPhysics();
+		});
+	}
 	else
 	{
 		SetRagdollPhysics();
@@ -668,6 +900,17 @@ void AMCharacter::OnDeath(float KillingDamage, struct FDamageEvent const& Damage
 
 void AMCharacter::UpdateCharacterMeshes()
 {
+	// Nothing is rendered on a dedicated server, poses are only evaluated on demand by RefreshServerPose
+#if WITH_COSMETICS
+	if (GetNetMode() == NM_DedicatedServer)
+#endif
+	{
+		MeshFP->MeshComponentUpdateFlag = EMeshComponentUpdateFlag::OnlyTickPoseWhenRendered;
+		GetMesh()->MeshComponentUpdateFlag = EMeshComponentUpdateFlag::OnlyTickPoseWhenRendered;
+		return;
+	}
+
+#if WITH_COSMETICS
 	bool const bFirstPerson = IsFirstPerson();
 
 	MeshFP->MeshComponentUpdateFlag = !bFirstPerson ? EMeshComponentUpdateFlag::OnlyTickPoseWhenRendered : EMeshComponentUpdateFlag::AlwaysTickPoseAndRefreshBones;
@@ -675,6 +918,82 @@ void AMCharacter::UpdateCharacterMeshes()
 
 	GetMesh()->MeshComponentUpdateFlag = bFirstPerson ? EMeshComponentUpdateFlag::OnlyTickPoseWhenRendered : EMeshComponentUpdateFlag::AlwaysTickPoseAndRefreshBones;
 	GetMesh()->SetOwnerNoSee(bFirstPerson);
+	GetMesh()->bEnableUpdateRateOptimizations = bUseMeshUpdateRateOptimizations && !IsLocallyControlled();
+#endif
+}
+
+void AMCharacter::RefreshServerPose()
+{
+	if (GetNetMode() != NM_DedicatedServer || !GetMesh())
+	{
+		return;
+	}
+
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+	const float DeltaTime = TimeSeconds - LastServerPoseRefreshTime;
+	if (DeltaTime < ServerPoseRefreshInterval)
+	{
+		return;
+	}
+	LastServerPoseRefreshTime = TimeSeconds;
+
+	// Attached weapons follow the refreshed sockets
+	GetMesh()->TickAnimation(FMath::Min(DeltaTime, MaxServerPoseDeltaTime), false);
+	GetMesh()->RefreshBoneTransforms();
+}
+
+bool AMCharacter::RaycastHitboxes(const FVector& Start, const FVector& End, FMHitboxHit& OutHit)
+{
+	if (!UsesHitboxes())
+	{
+		return false;
+	}
+
+	// Cheap test against the capsule first, so characters far from the ray are never posed
+	const FBoxSphereBounds& CapsuleBounds = GetCapsuleComponent()->Bounds;
+	FVector Direction;
+	float Length;
+	(End - Start).ToDirectionAndLength(Direction, Length);
+	if (!FMath::LineSphereIntersection(Start, Direction, Length, CapsuleBounds.Origin, CapsuleBounds.SphereRadius + HitboxBoundsMargin))
+	{
+		return false;
+	}
+
+	UpdateHitboxes();
+	return HitboxSet.Raycast(Start, End, OutHit);
+}
+
+float AMCharacter::GetHitboxDistance(int32 HitboxIndex, const FVector& Start, const FVector& End)
+{
+	if (!Hitboxes.IsValidIndex(HitboxIndex))
+	{
+		return BIG_NUMBER;
+	}
+
+	UpdateHitboxes();
+	return HitboxSet.GetDistanceToSegment(HitboxIndex, Start, End);
+}
+
+void AMCharacter::UpdateHitboxes()
+{
+	USkeletalMeshComponent* CharacterMesh = GetMesh();
+	if (!HitboxSet.IsInitializedFor(CharacterMesh))
+	{
+		HitboxSet.Init(CharacterMesh, Hitboxes);
+		HitboxUpdateFrame = 0;
+	}
+
+	if (HitboxUpdateFrame != GFrameCounter)
+	{
+		RefreshServerPose();
+		HitboxSet.Update(CharacterMesh);
+		HitboxUpdateFrame = GFrameCounter;
+	}
+}
+
+EMHitZone AMCharacter::GetHitZone(int32 HitboxIndex) const
+{
+	return Hitboxes.IsValidIndex(HitboxIndex) ? Hitboxes[HitboxIndex].Zone : EMHitZone::Body;
 }
 
 void AMCharacter::TornOff()
@@ -786,6 +1105,11 @@ bool AMCharacter::IsAiming() const
 	return bIsAiming;
 }
 
+bool AMCharacter::WantsToRun() const
+{
+	return bWantsToRun;
+}
+
 AMWeapon* AMCharacter::GetWeapon() const
 {
 	return CurrentWeapon;
@@ -807,28 +1131,29 @@ FVector AMCharacter::GetPawnViewLocation() const
 
 bool AMCharacter::IsEnemyFor(AController* TestController) const
 {
-	return true;
-	/*
-	if (TestPC == Controller || TestPC == nullptr)
+	if (!TestController || TestController == Controller)
 	{
-	return false;
+		return false;
 	}
 
-	AShooterPlayerState* TestPlayerState = Cast<AShooterPlayerState>(TestPC->PlayerState);
-	AShooterPlayerState* MyPlayerState = Cast<AShooterPlayerState>(PlayerState);
+	const AMGameState* GameState = GetWorld()->GetGameState<AMGameState>();
+	return GameState && GameState->GetTeamRegistry().AreEnemies(TeamId, FGenericTeamId::GetTeamIdentifier(TestController));
+}
 
-	bool bIsEnemy = true;
-	if (GetWorld()->GetGameState())
-	{
-	const AShooterGameMode* DefGame = GetWorld()->GetGameState()->GetDefaultGameMode<AShooterGameMode>();
-	if (DefGame && MyPlayerState && TestPlayerState)
+bool AMCharacter::IsEnemyOf(const AMCharacter* Other) const
+{
+	if (!Other || Other == this)
 	{
-	bIsEnemy = DefGame->CanDealDamage(TestPlayerState, MyPlayerState);
-	}
+		return false;
 	}
 
-	return bIsEnemy;
-	*/
+	const AMGameState* GameState = GetWorld()->GetGameState<AMGameState>();
+	return GameState && GameState->GetTeamRegistry().AreEnemies(TeamId, Other->TeamId);
+}
+
+void AMCharacter::UpdateTeam()
+{
+	TeamId = FGenericTeamId::GetTeamIdentifier(Controller);
 }
 
 bool AMCharacter::IsFirstPerson() const
@@ -842,6 +1167,30 @@ float AMCharacter::GetHealth() const
 	return Health;
 }
 
+void AMCharacter::EquipHexModule(const FMHexModule& Module)
+{
+	if (Role == ROLE_Authority)
+	{
+		Hex.EquipModule(Module);
+		HexStats.Write(Hex.GetStats());
+	}
+}
+
+bool AMCharacter::UnequipHexModule(FName Name)
+{
+	if (Role == ROLE_Authority && Hex.UnequipModule(Name))
+	{
+		HexStats.Write(Hex.GetStats());
+		return true;
+	}
+	return false;
+}
+
+void AMCharacter::OnRep_HexStats()
+{
+	Hex.SetReplicatedStats(HexStats);
+}
+
 USkeletalMeshComponent* AMCharacter::GetCharacterMesh() const
 {
 	return IsFirstPerson() ? GetFirstPersonMesh() : GetThirdPersonMesh();
@@ -860,40 +1209,39 @@ USkeletalMeshComponent* AMCharacter::GetThirdPersonMesh() const
 void AMCharacter::SetAiming(bool bNewAiming)
 {
 	bIsAiming = bNewAiming;
-
-	if (Role < ROLE_Authority)
-	{
-		ServerSetAiming(bNewAiming);
-	}
 }
 
-bool AMCharacter::ServerSetAiming_Validate(bool bNewAiming)
+void AMCharacter::SetRunning(bool bNewRunning, bool bToggle)
 {
-	return true;
+	bWantsToRun = bNewRunning;
+	bWantsToRunToggled = bNewRunning && bToggle;
 }
 
-void AMCharacter::ServerSetAiming_Implementation(bool bNewAiming)
+void AMCharacter::ApplyMovementFlags(bool bNewWantsToRun, bool bNewIsAiming)
 {
-	SetAiming(bNewAiming);
+	bWantsToRun = bNewWantsToRun;
+	bIsAiming = bNewIsAiming;
 }
 
-void AMCharacter::SetRunning(bool bNewRunning, bool bToggle)
+void AMCharacter::OnRep_MRepMovement()
 {
-	bWantsToRun = bNewRunning;
-	bWantsToRunToggled = bNewRunning && bToggle;
-
-	if (Role < ROLE_Authority)
+	if (MRepMovement.bRelativeToBase)
 	{
-		ServerSetRunning(bNewRunning, bToggle);
+		// Relative pose is resolved against the replicated movement base, skip it until the base is known
+		FVector BaseLocation;
+		FQuat BaseRotation;
+		if (!MovementBaseUtility::GetMovementBaseTransform(ReplicatedBasedMovement.MovementBase, ReplicatedBasedMovement.BoneName, BaseLocation, BaseRotation))
+		{
+			return;
+		}
+		MRepMovement.MakeWorldSpace(FRepMovement::RebaseOntoZeroOrigin(BaseLocation, this), BaseRotation);
 	}
-}
 
-bool AMCharacter::ServerSetRunning_Validate(bool bNewRunning, bool bToggle)
-{
-	return true;
+	MRepMovement.CopyTo(ReplicatedMovement);
+	OnRep_ReplicatedMovement();
 }
 
-void AMCharacter::ServerSetRunning_Implementation(bool bNewRunning, bool bToggle)
+void AMCharacter::OnRep_MovementFlags()
 {
-	SetRunning(bNewRunning, bToggle);
+	ApplyMovementFlags((PackedMovementFlags & EMMovementFlags::WantsToRun) != 0, (PackedMovementFlags & EMMovementFlags::IsAiming) != 0);
 }
@@ -13,6 +13,10 @@
 #include "Engine/Canvas.h"
 #include "PerfCountersHelpers.h"
 #include "DrawDebugHelpers.h"
+#include "Net/MNetBandwidthProfiler.h"
+#include "Server/MFrameBudgetScheduler.h"
+#include "Math/MVectorMath.h"
+#include "World/MWaterVolume.h"
 
 DEFINE_LOG_CATEGORY_STATIC(LogCharacterMovement, Log, All);
 
@@ -27,6 +31,8 @@ DECLARE_CYCLE_STAT(TEXT("Char PhysFalling"), STAT_CharPhysFalling, STATGROUP_Cha
 const float MAX_STEP_SIDE_Z = 0.08f; // Maximum Z value for the normal on the vertical side of steps.
 const float SWIMBOBSPEED = -80.0f;
 const float VERTICAL_SLOPE_NORMAL_Z = 0.001f; // Slope is vertical if Abs(Normal.Z) <= this threshold. Accounts for precision problems that sometimes angle normals slightly off horizontal for vertical surface.
+const float BALLISTIC_TRAJECTORY_TOLERANCE = 1.0f; // Distance and speed the character may deviate from a checked ballistic trajectory before it's checked again.
+const float NAVIGATION_GRAVITY_ALIGN_DOT = 0.996f; // Gravity is realigned to a followed surface once they differ by more than ~5 degrees.
 
 											  // Statics.
 namespace CharacterMovementComponentStatics
@@ -37,6 +43,7 @@ namespace CharacterMovementComponentStatics
 	static const FName ComputeFloorDistName = FName(TEXT("ComputeFloorDistSweep"));
 	static const FName FloorLineTraceName = FName(TEXT("ComputeFloorDistLineTrace"));
 	static const FName ImmersionDepthName = FName(TEXT("MovementComp_Character_ImmersionDepth"));
+	static const FName BallisticClearanceName = FName(TEXT("BallisticClearance"));
 }
 
 // CVars.
@@ -66,16 +73,69 @@ UMCharacterMovementComponent::UMCharacterMovementComponent()
 	bAlignComponentToFloor = false;
 	bAlignComponentToGravity = true;
 	bAlignCustomGravityToFloor = false;
+	bAlignGravityToNavigation = true;
+	bUseSurfaceAvoidance = true;
+	AvoidancePreferredVelocity = FVector::ZeroVector;
+	AvoidanceVelocity = FVector::ZeroVector;
+	AvoidanceRequestFrame = 0;
+	AvoidanceResultFrame = 0;
 	bDirtyCustomGravityDirection = false;
 	bDisableGravityReplication = false;
+	bGravityReplicationPending = false;
 	bIgnoreBaseRollMove = false;
+	bUseRelativeBasePose = true;
+	RelativeBaseLocation = FVector::ZeroVector;
+	RelativeBaseRotation = FQuat::Identity;
+	RelativeBaseWorldLocation = FVector::ZeroVector;
+	RelativeBaseWorldRotation = FQuat::Identity;
+	RelativeBaseScale = FVector::OneVector;
+	ImmersionDepthCache = 0.0f;
+	ImmersionDepthCacheFrame = 0;
+	ImmersionDepthCacheStart = FVector::ZeroVector;
+	ImmersionDepthCacheEnd = FVector::ZeroVector;
 	CustomGravityDirection = FVector::ZeroVector;
 	GravityPoint = FVector::ZeroVector;
+	GravityMode = EMGravityMode::Generic;
 	OldGravityPoint = GravityPoint;
 	OldGravityScale = GravityScale;
+	bUseSnapshotInterpolation = true;
+	MinInterpolationDelay = 0.05f;
+	MaxInterpolationDelay = 0.25f;
+	MaxExtrapolationTime = 0.25f;
+	bUseBallisticFastPath = true;
+	BallisticLookaheadTime = 0.25f;
+	BallisticClearanceMargin = 20.0f;
+	BallisticStartLocation = FVector::ZeroVector;
+	BallisticStartVelocity = FVector::ZeroVector;
+	BallisticGravity = FVector::ZeroVector;
+	BallisticElapsedTime = 0.0f;
+	BallisticClearTime = 0.0f;
+	NumServerMoves = 0;
+	NumServerMoveCorrections = 0;
 }
 
 
+bool UMCharacterMovementComponent::CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack)
+{
+	FMNetBandwidthProfiler::FScopedSentRPC ScopedSentRPC(this, Function);
+	return Super::CallRemoteFunction(Function, Parameters, OutParms, Stack);
+}
+
+void UMCharacterMovementComponent::ProcessEvent(UFunction* Function, void* Parameters)
+{
+	// RPCs from clients are executed through here on the server
+	if (Function->FunctionFlags & FUNC_NetServer)
+	{
+		FMNetBandwidthProfiler* Profiler = FMNetBandwidthProfiler::Find(GetWorld());
+		if (Profiler)
+		{
+			Profiler->RecordReceivedRPC(this, Function, Parameters, GetOwner() ? GetOwner()->GetNetConnection() : nullptr);
+		}
+	}
+
+	Super::ProcessEvent(Function, Parameters);
+}
+
 bool UMCharacterMovementComponent::DoJump(bool bReplayingMoves)
 {
 	if (CharacterOwner && CharacterOwner->CanJump())
@@ -365,6 +425,12 @@ void UMCharacterMovementComponent::SimulateMovement(float DeltaSeconds)
 		return;
 	}
 
+	if (bIsSimulatedProxy && IsUsingSnapshotInterpolation() && SnapshotBuffer.Num() > 0)
+	{
+		SimulateMovementFromSnapshots(DeltaSeconds);
+		return;
+	}
+
 	FVector OldVelocity;
 	FVector OldLocation;
 
@@ -485,6 +551,77 @@ void UMCharacterMovementComponent::SimulateMovement(float DeltaSeconds)
 	LastUpdateVelocity = Velocity;
 }
 
+bool UMCharacterMovementComponent::IsUsingSnapshotInterpolation() const
+{
+	return bUseSnapshotInterpolation && CharacterOwner && CharacterOwner->Role == ROLE_SimulatedProxy;
+}
+
+void UMCharacterMovementComponent::ResetMovementSnapshots()
+{
+	SnapshotBuffer.Reset();
+}
+
+void UMCharacterMovementComponent::AddMovementSnapshot(uint16 ServerTimeStamp, const FVector& NewLocation, const FQuat& NewRotation, const FVector& NewVelocity)
+{
+	SnapshotBuffer.MinInterpolationDelay = MinInterpolationDelay;
+	SnapshotBuffer.MaxInterpolationDelay = FMath::Max(MinInterpolationDelay, MaxInterpolationDelay);
+	SnapshotBuffer.MaxExtrapolationTime = MaxExtrapolationTime;
+
+	SnapshotBuffer.AddSnapshot(ServerTimeStamp, GetWorld()->GetTimeSeconds(), NewLocation, NewRotation, NewVelocity);
+}
+
+void UMCharacterMovementComponent::SimulateMovementFromSnapshots(float DeltaSeconds)
+{
+	FVector OldVelocity = Velocity;
+	FVector OldLocation = UpdatedComponent->GetComponentLocation();
+
+	{
+		FScopedMovementUpdate ScopedMovementUpdate(UpdatedComponent, bEnableScopedMovementUpdates ? EScopedUpdate::DeferredUpdates : EScopedUpdate::ImmediateUpdates);
+
+		if (bNetworkUpdateReceived)
+		{
+			bNetworkUpdateReceived = false;
+			if (bNetworkMovementModeChanged)
+			{
+				bNetworkMovementModeChanged = false;
+				ApplyNetworkMovementMode(CharacterOwner->GetReplicatedMovementMode());
+			}
+		}
+
+		if (MovementMode == MOVE_None)
+		{
+			return;
+		}
+
+		// Only extrapolate with gravity while airborne, supported characters keep their velocity.
+		const FVector ExtrapolationGravity = (MovementMode == MOVE_Falling && !CharacterOwner->bSimGravityDisabled) ? GetGravity() : FVector::ZeroVector;
+
+		FVector NewLocation;
+		FQuat NewRotation;
+		FVector NewVelocity;
+		if (SnapshotBuffer.Sample(GetWorld()->GetTimeSeconds(), ExtrapolationGravity, NewLocation, NewRotation, NewVelocity))
+		{
+			UpdatedComponent->SetWorldLocationAndRotation(NewLocation, NewRotation, /*bSweep=*/ false);
+			Velocity = NewVelocity;
+		}
+
+		Acceleration = Velocity.GetSafeNormal();
+		AnalogInputModifier = 1.0f;
+		bHasRequestedVelocity = false;
+
+		OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
+	}
+
+	CallMovementUpdateDelegate(DeltaSeconds, OldLocation, OldVelocity);
+
+	UpdateComponentVelocity();
+	bJustTeleported = false;
+
+	LastUpdateLocation = UpdatedComponent->GetComponentLocation();
+	LastUpdateRotation = UpdatedComponent->GetComponentQuat();
+	LastUpdateVelocity = Velocity;
+}
+
 void UMCharacterMovementComponent::MaybeUpdateBasedMovement(float DeltaSeconds)
 {
 	UpdateGravity(DeltaSeconds);
@@ -534,6 +671,11 @@ void UMCharacterMovementComponent::UpdateBasedMovement(float DeltaSeconds)
 	// Only if base moved.
 	if (bRotationChanged || (OldBaseLocation != NewBaseLocation))
 	{
+		if (FollowBaseRigidly(MovementBase, NewBaseLocation, NewBaseQuat))
+		{
+			return;
+		}
+
 		// Calculate new transform matrix of base actor (ignoring scale).
 		const FQuatRotationTranslationMatrix OldLocalToWorld(OldBaseQuat, OldBaseLocation);
 		const FQuatRotationTranslationMatrix NewLocalToWorld(NewBaseQuat, NewBaseLocation);
@@ -622,6 +764,110 @@ void UMCharacterMovementComponent::UpdateBasedMovement(float DeltaSeconds)
 	}
 }
 
+bool UMCharacterMovementComponent::FollowBaseRigidly(const UPrimitiveComponent* MovementBase, const FVector& NewBaseLocation, const FQuat& NewBaseQuat)
+{
+	if (!bUseRelativeBasePose || bIgnoreBaseRotation || bConstrainToPlane || CharacterOwner->IsMatineeControlled() ||
+		RelativeBaseComponent.Get() != MovementBase || RelativeBaseBoneName != CharacterOwner->GetBasedMovement().BoneName)
+	{
+		return false;
+	}
+
+	// Physics bases may be pushed apart from the character, scaled bases stretch the relative location.
+	if (MovementBase->IsSimulatingPhysics() || !MovementBase->GetComponentScale().Equals(RelativeBaseScale))
+	{
+		return false;
+	}
+
+	// Something else moved the character since the pose was captured.
+	const FQuat OldQuat = UpdatedComponent->GetComponentQuat();
+	if (UpdatedComponent->GetComponentLocation() != RelativeBaseWorldLocation || !OldQuat.Equals(RelativeBaseWorldRotation, 1e-8f))
+	{
+		return false;
+	}
+
+	// Geometry on the base moves along with the character, so there's nothing new to sweep against.
+	const FQuat NewQuat = NewBaseQuat * RelativeBaseRotation;
+	UpdatedComponent->SetWorldLocationAndRotation(NewBaseLocation + NewBaseQuat.RotateVector(RelativeBaseLocation), NewQuat, false);
+
+	// Pipe through ControlRotation, to affect camera.
+	if (CharacterOwner->Controller)
+	{
+		FRotator FinalRotation = NewQuat.Rotator();
+		UpdateBasedRotation(FinalRotation, (NewQuat * OldQuat.Inverse()).Rotator());
+	}
+
+	RelativeBaseWorldLocation = UpdatedComponent->GetComponentLocation();
+	RelativeBaseWorldRotation = UpdatedComponent->GetComponentQuat();
+	return true;
+}
+
+void UMCharacterMovementComponent::ApplyWorldOffset(const FVector& InOffset, bool bWorldShift)
+{
+	// Base location, last update location and all but the newest saved move are shifted by the engine.
+	Super::ApplyWorldOffset(InOffset, bWorldShift);
+
+	if (CharacterOwner && CharacterOwner->Role == ROLE_AutonomousProxy)
+	{
+		FNetworkPredictionData_Client_Character* ClientData = GetPredictionData_Client_Character();
+		if (ClientData && ClientData->SavedMoves.Num() > 0)
+		{
+			FSavedMove_Character* const NewestMove = ClientData->SavedMoves.Last().Get();
+			NewestMove->StartLocation += InOffset;
+			NewestMove->SavedLocation += InOffset;
+		}
+	}
+
+	// Zero disables the gravity point, only a point in use moves with the world.
+	if (!GravityPoint.IsZero())
+	{
+		GravityPoint += InOffset;
+	}
+	if (!OldGravityPoint.IsZero())
+	{
+		OldGravityPoint += InOffset;
+	}
+
+	BallisticStartLocation += InOffset;
+	RelativeBaseWorldLocation += InOffset;
+	SnapshotBuffer.ApplyWorldOffset(InOffset);
+}
+
+bool UMCharacterMovementComponent::GetRelativeBasePose(FVector& OutLocation, FQuat& OutRotation) const
+{
+	if (!CharacterOwner || !UpdatedComponent)
+	{
+		return false;
+	}
+
+	const UPrimitiveComponent* MovementBase = CharacterOwner->GetMovementBase();
+	FVector BaseLocation;
+	FQuat BaseQuat;
+	if (!MovementBaseUtility::UseRelativeLocation(MovementBase) ||
+		!MovementBaseUtility::GetMovementBaseTransform(MovementBase, CharacterOwner->GetBasedMovement().BoneName, BaseLocation, BaseQuat))
+	{
+		return false;
+	}
+
+	OutLocation = BaseQuat.UnrotateVector(UpdatedComponent->GetComponentLocation() - BaseLocation);
+	OutRotation = BaseQuat.Inverse() * UpdatedComponent->GetComponentQuat();
+	return true;
+}
+
+void UMCharacterMovementComponent::SaveBaseLocation()
+{
+	Super::SaveBaseLocation();
+
+	RelativeBaseComponent = nullptr;
+	if (bUseRelativeBasePose && HasValidData() && GetRelativeBasePose(RelativeBaseLocation, RelativeBaseRotation))
+	{
+		RelativeBaseComponent = CharacterOwner->GetMovementBase();
+		RelativeBaseBoneName = CharacterOwner->GetBasedMovement().BoneName;
+		RelativeBaseScale = RelativeBaseComponent->GetComponentScale();
+		RelativeBaseWorldLocation = UpdatedComponent->GetComponentLocation();
+		RelativeBaseWorldRotation = UpdatedComponent->GetComponentQuat();
+	}
+}
+
 void UMCharacterMovementComponent::UpdateBasedRotation(FRotator& FinalRotation, const FRotator& ReducedRotation)
 {
 	AController* Controller = CharacterOwner ? CharacterOwner->Controller : NULL;
@@ -1026,19 +1272,39 @@ float UMCharacterMovementComponent::ImmersionDepth() const
 		}
 		else
 		{
-			UBrushComponent* VolumeBrushComp = GetPhysicsVolume()->GetBrushComponent();
-			FHitResult Hit(1.0f);
-			if (VolumeBrushComp)
-			{
-				const FVector CapsuleHalfHeight = GetComponentAxisZ() * CollisionHalfHeight;
-				const FVector TraceStart = UpdatedComponent->GetComponentLocation() + CapsuleHalfHeight;
-				const FVector TraceEnd = UpdatedComponent->GetComponentLocation() - CapsuleHalfHeight;
+			const FVector CapsuleHalfHeight = GetComponentAxisZ() * CollisionHalfHeight;
+			const FVector TraceStart = UpdatedComponent->GetComponentLocation() + CapsuleHalfHeight;
+			const FVector TraceEnd = UpdatedComponent->GetComponentLocation() - CapsuleHalfHeight;
 
-				FCollisionQueryParams NewTraceParams(CharacterMovementComponentStatics::ImmersionDepthName, true);
-				VolumeBrushComp->LineTraceComponent(Hit, TraceStart, TraceEnd, NewTraceParams);
+			const APhysicsVolume* Volume = GetPhysicsVolume();
+			const AMWaterVolume* WaterVolume = Cast<AMWaterVolume>(Volume);
+			if (WaterVolume && WaterVolume->HasAnalyticSurface())
+			{
+				Depth = WaterVolume->GetImmersion(TraceStart, TraceEnd);
 			}
+			else if (ImmersionDepthCacheFrame == GFrameCounter && ImmersionDepthCacheVolume.Get() == Volume && ImmersionDepthCacheStart == TraceStart && ImmersionDepthCacheEnd == TraceEnd)
+			{
+				// Called several times per substep without moving, the brush is traced once.
+				Depth = ImmersionDepthCache;
+			}
+			else
+			{
+				UBrushComponent* VolumeBrushComp = Volume->GetBrushComponent();
+				FHitResult Hit(1.0f);
+				if (VolumeBrushComp)
+				{
+					FCollisionQueryParams NewTraceParams(CharacterMovementComponentStatics::ImmersionDepthName, true);
+					VolumeBrushComp->LineTraceComponent(Hit, TraceStart, TraceEnd, NewTraceParams);
+				}
 
-			Depth = (Hit.Time == 1.0f) ? 1.0f : (1.0f - Hit.Time);
+				Depth = (Hit.Time == 1.0f) ? 1.0f : (1.0f - Hit.Time);
+
+				ImmersionDepthCache = Depth;
+				ImmersionDepthCacheFrame = GFrameCounter;
+				ImmersionDepthCacheVolume = Volume;
+				ImmersionDepthCacheStart = TraceStart;
+				ImmersionDepthCacheEnd = TraceEnd;
+			}
 		}
 	}
 
@@ -1068,12 +1334,52 @@ void UMCharacterMovementComponent::RequestDirectMove(const FVector& MoveVelocity
 	bHasRequestedVelocity = true;
 	bRequestedMoveWithMaxSpeed = bForceMaxSpeed;
 
+	if (bUseSurfaceAvoidance)
+	{
+		// Avoidance solves for the previous request, its result is used while fresh.
+		AvoidancePreferredVelocity = MoveVelocity;
+		AvoidanceRequestFrame = GFrameCounter;
+		if (GFrameCounter - AvoidanceResultFrame <= 1)
+		{
+			RequestedVelocity = AvoidanceVelocity;
+		}
+	}
+
 	if (IsMovingOnGround())
 	{
 		RequestedVelocity = FVector::VectorPlaneProject(RequestedVelocity, GetComponentAxisZ());
 	}
 }
 
+bool UMCharacterMovementComponent::HasAvoidanceRequest() const
+{
+	return bUseSurfaceAvoidance && GFrameCounter - AvoidanceRequestFrame <= 1;
+}
+
+void UMCharacterMovementComponent::SetAvoidanceVelocity(const FVector& NewAvoidanceVelocity)
+{
+	AvoidanceVelocity = NewAvoidanceVelocity;
+	AvoidanceResultFrame = GFrameCounter;
+}
+
+void UMCharacterMovementComponent::RequestSurfaceMove(const FVector& MoveVelocity, const FVector& SurfaceUp, bool bForceMaxSpeed)
+{
+	if (SurfaceUp.IsZero())
+	{
+		RequestDirectMove(MoveVelocity, bForceMaxSpeed);
+		return;
+	}
+
+	// Small differences come from sampling, only realign on real surface changes to avoid replicating noise.
+	if (bAlignGravityToNavigation && GravityPoint.IsZero() && (GetGravityDirection(true) | SurfaceUp) > -NAVIGATION_GRAVITY_ALIGN_DOT)
+	{
+		SetGravityDirection(SurfaceUp * -1.0f);
+	}
+
+	const FVector SurfaceVelocity = FVector::VectorPlaneProject(MoveVelocity, SurfaceUp);
+	RequestDirectMove(SurfaceVelocity.GetSafeNormal() * MoveVelocity.Size(), bForceMaxSpeed);
+}
+
 float UMCharacterMovementComponent::GetMaxJumpHeight() const
 {
 	const float GravityMagnitude = GetGravityMagnitude();
@@ -1089,6 +1395,12 @@ float UMCharacterMovementComponent::GetMaxJumpHeight() const
 
 void UMCharacterMovementComponent::PhysFlying(float deltaTime, int32 Iterations)
 {
+	if (CanUseStockPhysics())
+	{
+		Super::PhysFlying(deltaTime, Iterations);
+		return;
+	}
+
 	if (deltaTime < MIN_TICK_TIME)
 	{
 		return;
@@ -1215,6 +1527,12 @@ void UMCharacterMovementComponent::ApplyRootMotionToVelocityOVERRIDEN(float delt
 
 void UMCharacterMovementComponent::PhysSwimming(float deltaTime, int32 Iterations)
 {
+	if (CanUseStockPhysics())
+	{
+		Super::PhysSwimming(deltaTime, Iterations);
+		return;
+	}
+
 	if (deltaTime < MIN_TICK_TIME)
 	{
 		return;
@@ -1464,6 +1782,18 @@ void UMCharacterMovementComponent::PhysFalling(float deltaTime, int32 Iterations
 	FVector FallAcceleration = GetFallingLateralAccelerationEx(deltaTime, GravityDir);
 	const bool bHasAirControl = FallAcceleration.SizeSquared() > 0.0f;
 
+	if (bUseBallisticFastPath && !bHasAirControl && PhysFallingBallistic(deltaTime, Iterations))
+	{
+		return;
+	}
+	BallisticClearTime = 0.0f;
+
+	if (CanUseStockPhysics())
+	{
+		Super::PhysFalling(deltaTime, Iterations);
+		return;
+	}
+
 	float RemainingTime = deltaTime;
 	while (RemainingTime >= MIN_TICK_TIME && Iterations < MaxSimulationIterations)
 	{
@@ -1729,6 +2059,135 @@ void UMCharacterMovementComponent::PhysFalling(float deltaTime, int32 Iterations
 	}
 }
 
+bool UMCharacterMovementComponent::PhysFallingBallistic(float deltaTime, int32 Iterations)
+{
+	if (!CharacterOwner || HasAnimRootMotion() || CurrentRootMotion.HasActiveRootMotionSources() || GetPhysicsVolume()->bWaterVolume)
+	{
+		return false;
+	}
+
+	const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	const FVector OldVelocity = Velocity;
+	FVector NewLocation;
+	FVector NewVelocity;
+
+	if (!CustomGravityDirection.IsZero() || GravityPoint.IsZero())
+	{
+		// Uniform gravity, the trajectory is a parabola. Reuse the last clearance check while the character is still on it.
+		const FVector Gravity = GetGravity();
+		const float ElapsedTime = BallisticElapsedTime;
+		const bool bOnCheckedTrajectory = BallisticClearTime > 0.0f && ElapsedTime + deltaTime <= BallisticClearTime && Gravity.Equals(BallisticGravity) &&
+			OldLocation.Equals(BallisticStartLocation + BallisticStartVelocity * ElapsedTime + Gravity * (0.5f * ElapsedTime * ElapsedTime), BALLISTIC_TRAJECTORY_TOLERANCE) &&
+			OldVelocity.Equals(BallisticStartVelocity + Gravity * ElapsedTime, BALLISTIC_TRAJECTORY_TOLERANCE);
+
+		float Time = ElapsedTime + deltaTime;
+		if (!bOnCheckedTrajectory)
+		{
+			const float CheckTime = FMath::Max(BallisticLookaheadTime, deltaTime);
+			const FVector EndLocation = OldLocation + OldVelocity * CheckTime + Gravity * (0.5f * CheckTime * CheckTime);
+
+			// Bounds of a parabola are its end points and its extremes along each axis
+			FBox PathBounds(ForceInit);
+			PathBounds += OldLocation;
+			PathBounds += EndLocation;
+			for (int32 Axis = 0; Axis < 3; Axis++)
+			{
+				if (Gravity[Axis] != 0.0f)
+				{
+					const float ExtremeTime = -OldVelocity[Axis] / Gravity[Axis];
+					if (ExtremeTime > 0.0f && ExtremeTime < CheckTime)
+					{
+						PathBounds += OldLocation + OldVelocity * ExtremeTime + Gravity * (0.5f * ExtremeTime * ExtremeTime);
+					}
+				}
+			}
+
+			if (!IsBallisticPathClear(PathBounds))
+			{
+				return false;
+			}
+
+			BallisticStartLocation = OldLocation;
+			BallisticStartVelocity = OldVelocity;
+			BallisticGravity = Gravity;
+			BallisticClearTime = CheckTime;
+			Time = deltaTime;
+		}
+
+		NewLocation = BallisticStartLocation + BallisticStartVelocity * Time + Gravity * (0.5f * Time * Time);
+		NewVelocity = BallisticStartVelocity + Gravity * Time;
+		BallisticElapsedTime = Time;
+	}
+	else
+	{
+		// Gravity towards a point turns along the path and has no cheap closed form.
+		// Integrate it without sweeps and check bounds of the whole step once.
+		const float GravityMagnitude = FMath::Abs(UPawnMovementComponent::GetGravityZ()) * GravityScale;
+		const int32 NumSteps = FMath::Max(FMath::CeilToInt(deltaTime / MaxSimulationTimeStep), 1);
+		const float StepTime = deltaTime / NumSteps;
+
+		FBox PathBounds(ForceInit);
+		PathBounds += OldLocation;
+		NewLocation = OldLocation;
+		NewVelocity = OldVelocity;
+		for (int32 Step = 0; Step < NumSteps; Step++)
+		{
+			const FVector Gravity = MVectorMath::GetSafeDirection(NewLocation, GravityPoint) * GravityMagnitude;
+			const FVector StepVelocity = NewVelocity + Gravity * StepTime;
+			NewLocation += (NewVelocity + StepVelocity) * (0.5f * StepTime);
+			NewVelocity = StepVelocity;
+			PathBounds += NewLocation;
+		}
+
+		// Path between integration points bulges out by at most an eighth of the acceleration over a step
+		if (!IsBallisticPathClear(PathBounds.ExpandBy(0.125f * FMath::Abs(GravityMagnitude) * StepTime * StepTime)))
+		{
+			return false;
+		}
+		BallisticClearTime = 0.0f;
+	}
+
+	const float TerminalLimit = FMath::Abs(GetPhysicsVolume()->TerminalVelocity);
+	if (NewVelocity.SizeSquared() > FMath::Square(TerminalLimit))
+	{
+		return false;
+	}
+
+	bJustTeleported = false;
+	Velocity = NewVelocity;
+
+	if (bNotifyApex && CharacterOwner->Controller && ((Velocity | GetGravityDirection()) * -1.0f) <= 0.0f)
+	{
+		// Just passed jump apex since now going down.
+		bNotifyApex = false;
+		NotifyJumpApex();
+	}
+
+	// Space was checked to be clear, only overlaps need to be updated.
+	MoveUpdatedComponent(NewLocation - OldLocation, UpdatedComponent->GetComponentQuat(), false);
+
+	if (HasValidData() && IsSwimming())
+	{
+		// Just entered water.
+		StartSwimmingOVERRIDEN(OldLocation, OldVelocity, deltaTime, 0.0f, Iterations);
+	}
+
+	return true;
+}
+
+bool UMCharacterMovementComponent::IsBallisticPathClear(const FBox& PathBounds) const
+{
+	// The capsule fits in a sphere of its half height
+	const FVector CapsuleExtent(CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() + BallisticClearanceMargin);
+
+	FCollisionQueryParams QueryParams(CharacterMovementComponentStatics::BallisticClearanceName, false, CharacterOwner);
+	FCollisionResponseParams ResponseParam;
+	InitCollisionParams(QueryParams, ResponseParam);
+
+	return !GetWorld()->OverlapBlockingTestByChannel(PathBounds.GetCenter(), FQuat::Identity, UpdatedComponent->GetCollisionObjectType(),
+		FCollisionShape::MakeBox(PathBounds.GetExtent() + CapsuleExtent), QueryParams, ResponseParam);
+}
+
 FVector UMCharacterMovementComponent::LimitAirControl(float DeltaTime, const FVector& FallAcceleration, const FHitResult& HitResult, bool bCheckForValidLandingSpot)
 {
 	return LimitAirControlEx(DeltaTime, FallAcceleration, HitResult, GetGravityDirection(true), bCheckForValidLandingSpot);
@@ -1958,6 +2417,12 @@ void UMCharacterMovementComponent::MaintainHorizontalGroundVelocity()
 
 void UMCharacterMovementComponent::PhysWalking(float deltaTime, int32 Iterations)
 {
+	if (CanUseStockPhysics())
+	{
+		Super::PhysWalking(deltaTime, Iterations);
+		return;
+	}
+
 	SCOPE_CYCLE_COUNTER(STAT_CharPhysWalking);
 
 	if (deltaTime < MIN_TICK_TIME)
@@ -2275,6 +2740,9 @@ void UMCharacterMovementComponent::OnTeleported()
 	bool bWasFalling = (MovementMode == MOVE_Falling);
 	bJustTeleported = true;
 
+	// Buffered snapshots lead to the old location.
+	SnapshotBuffer.Reset();
+
 	// Find floor at current location.
 	UpdateFloorFromAdjustment();
 
@@ -3398,6 +3866,10 @@ void UMCharacterMovementComponent::ServerMoveHandleClientError(float ClientTimeS
 		MovementBaseUtility::GetMovementBaseTransform(ClientMovementBase, ClientBaseBoneName, BaseLocation, BaseRotation);
 		ClientLoc += BaseLocation;
 	}
+	else
+	{
+		ClientLoc = FRepMovement::RebaseOntoLocalOrigin(ClientLoc, this);
+	}
 
 	// Compute the client error from the server's position.
 	// If client has accumulated a noticeable positional error, correct him.
@@ -3440,6 +3912,7 @@ void UMCharacterMovementComponent::ServerMoveHandleClientError(float ClientTimeS
 		ServerData->PendingAdjustment.MovementMode = PackNetworkMovementMode();
 
 		PerfCountersIncrement(TEXT("NumServerMoveCorrections"));
+		NumServerMoveCorrections++;
 	}
 	else
 	{
@@ -3473,6 +3946,7 @@ void UMCharacterMovementComponent::ServerMoveHandleClientError(float ClientTimeS
 	}
 
 	PerfCountersIncrement(TEXT("NumServerMoves"));
+	NumServerMoves++;
 
 	ServerData->bForceClientUpdate = false;
 }
@@ -3522,6 +3996,10 @@ void UMCharacterMovementComponent::ClientAdjustPosition_Implementation(float Tim
 		MovementBaseUtility::GetMovementBaseTransform(NewBase, NewBaseBoneName, BaseLocation, BaseRotation); // TODO: error handling if returns false.
 		NewLocation += BaseLocation;
 	}
+	else
+	{
+		NewLocation = FRepMovement::RebaseOntoLocalOrigin(NewLocation, this);
+	}
 
 #if !UE_BUILD_SHIPPING
 	if (CharacterMovementCVars::NetShowCorrections != 0)
@@ -3642,123 +4120,109 @@ void UMCharacterMovementComponent::ApplyDownwardForce(float DeltaSeconds)
 
 void UMCharacterMovementComponent::ApplyRepulsionForce(float DeltaSeconds)
 {
-	if (UpdatedPrimitive && RepulsionForce > 0.0f)
+	if (!UpdatedPrimitive || RepulsionForce <= 0.0f)
 	{
-		const TArray<FOverlapInfo>& Overlaps = UpdatedPrimitive->GetOverlapInfos();
-		if (Overlaps.Num() > 0)
-		{
-			FCollisionQueryParams QueryParams;
-			QueryParams.bReturnFaceIndex = false;
-			QueryParams.bReturnPhysicalMaterial = false;
-
-			float CapsuleRadius = 0.0f;
-			float CapsuleHalfHeight = 0.0f;
-			CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
-			const float RepulsionForceRadius = CapsuleRadius * 1.2f;
-			const float StopBodyDistance = 2.5f;
-			const FVector MyLocation = UpdatedPrimitive->GetComponentLocation();
-			const FVector CapsuleDown = GetComponentAxisZ() * -1.0f;
-
-			for (int32 i = 0; i < Overlaps.Num(); i++)
-			{
-				const FOverlapInfo& Overlap = Overlaps[i];
-
-				UPrimitiveComponent* OverlapComp = Overlap.OverlapInfo.Component.Get();
-				if (!OverlapComp || OverlapComp->Mobility < EComponentMobility::Movable)
-				{
-					continue;
-				}
-
-				// Use the body instead of the component for cases where we have multi-body overlaps enabled.
-				FBodyInstance* OverlapBody = nullptr;
-				const int32 OverlapBodyIndex = Overlap.GetBodyIndex();
-				const USkeletalMeshComponent* SkelMeshForBody = (OverlapBodyIndex != INDEX_NONE) ? Cast<USkeletalMeshComponent>(OverlapComp) : nullptr;
-				if (SkelMeshForBody != nullptr)
-				{
-					OverlapBody = SkelMeshForBody->Bodies.IsValidIndex(OverlapBodyIndex) ? SkelMeshForBody->Bodies[OverlapBodyIndex] : nullptr;
-				}
-				else
-				{
-					OverlapBody = OverlapComp->GetBodyInstance();
-				}
+		return;
+	}
 
-				if (!OverlapBody)
-				{
-					UE_LOG(LogCharacterMovement, Warning, TEXT("%s could not find overlap body for body index %d"), *GetName(), OverlapBodyIndex);
-					continue;
-				}
+	const TArray<FOverlapInfo>& Overlaps = UpdatedPrimitive->GetOverlapInfos();
+	if (Overlaps.Num() == 0)
+	{
+		return;
+	}
 
-				// Early out if this is not a destructible and the body is not simulated.
-				/*
-				if (!OverlapBody->IsInstanceSimulatingPhysics() && !Cast<UDestructibleComponent>(OverlapComp))
-				{
-				continue;
-				}
-				*/
-				if (!OverlapBody->IsInstanceSimulatingPhysics())
-				{
-					continue;
-				}
+	// Gather awake simulated bodies first, so the capsule math below runs in a single pass.
+	TArray<FBodyInstance*, TInlineAllocator<16>> OverlapBodies;
+	TArray<FVector, TInlineAllocator<16>> BodyLocations;
+	for (const FOverlapInfo& Overlap : Overlaps)
+	{
+		UPrimitiveComponent* OverlapComp = Overlap.OverlapInfo.Component.Get();
+		if (!OverlapComp || OverlapComp->Mobility < EComponentMobility::Movable)
+		{
+			continue;
+		}
 
-				FTransform BodyTransform = OverlapBody->GetUnrealWorldTransform();
+		// Use the body instead of the component for cases where we have multi-body overlaps enabled.
+		FBodyInstance* OverlapBody = nullptr;
+		const int32 OverlapBodyIndex = Overlap.GetBodyIndex();
+		const USkeletalMeshComponent* SkelMeshForBody = (OverlapBodyIndex != INDEX_NONE) ? Cast<USkeletalMeshComponent>(OverlapComp) : nullptr;
+		if (SkelMeshForBody != nullptr)
+		{
+			OverlapBody = SkelMeshForBody->Bodies.IsValidIndex(OverlapBodyIndex) ? SkelMeshForBody->Bodies[OverlapBodyIndex] : nullptr;
+		}
+		else
+		{
+			OverlapBody = OverlapComp->GetBodyInstance();
+		}
 
-				const FVector BodyVelocity = OverlapBody->GetUnrealWorldVelocity();
-				const FVector BodyLocation = BodyTransform.GetLocation();
-				const FVector LineTraceEnd = MyLocation + CapsuleDown * ((BodyLocation - MyLocation) | CapsuleDown);
+		if (!OverlapBody)
+		{
+			UE_LOG(LogCharacterMovement, Warning, TEXT("%s could not find overlap body for body index %d"), *GetName(), OverlapBodyIndex);
+			continue;
+		}
 
-				// Trace to get the hit location on the capsule.
-				FHitResult Hit;
-				bool bHasHit = UpdatedPrimitive->LineTraceComponent(Hit, BodyLocation, LineTraceEnd, QueryParams);
+		// Sleeping bodies stay put until something else wakes them.
+		if (!OverlapBody->IsInstanceSimulatingPhysics() || !OverlapBody->IsInstanceAwake())
+		{
+			continue;
+		}
 
-				FVector HitLoc = Hit.ImpactPoint;
-				bool bIsPenetrating = Hit.bStartPenetrating || Hit.PenetrationDepth > StopBodyDistance;
+		OverlapBodies.Add(OverlapBody);
+		BodyLocations.Add(OverlapBody->GetUnrealWorldTransform().GetLocation());
+	}
 
-				// If we didn't hit the capsule, we're inside the capsule.
-				if (!bHasHit)
-				{
-					HitLoc = BodyLocation;
-					bIsPenetrating = true;
-				}
+	if (OverlapBodies.Num() == 0)
+	{
+		return;
+	}
 
-				const float DistanceNow = FVector::VectorPlaneProject(HitLoc - BodyLocation, CapsuleDown).SizeSquared();
-				const float DistanceLater = FVector::VectorPlaneProject(HitLoc - (BodyLocation + BodyVelocity * DeltaSeconds), CapsuleDown).SizeSquared();
+	float CapsuleRadius = 0.0f;
+	float CapsuleHalfHeight = 0.0f;
+	CharacterOwner->GetCapsuleComponent()->GetScaledCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
+	const float RepulsionForceRadius = CapsuleRadius * 1.2f;
+	const float StopBodyDistance = 2.5f;
+	const float CylinderHalfHeight = FMath::Max(CapsuleHalfHeight - CapsuleRadius, 0.0f);
+	const FVector MyLocation = UpdatedPrimitive->GetComponentLocation();
+	const FVector CapsuleUp = GetComponentAxisZ();
 
-				if (bHasHit && DistanceNow < StopBodyDistance && !bIsPenetrating)
-				{
-					OverlapBody->SetLinearVelocity(FVector(0.0f, 0.0f, 0.0f), false);
-				}
-				else if (DistanceLater <= DistanceNow || bIsPenetrating)
-				{
-					FVector ForceCenter = MyLocation;
+	for (int32 i = 0; i < OverlapBodies.Num(); i++)
+	{
+		FBodyInstance* OverlapBody = OverlapBodies[i];
 
-					if (bHasHit)
-					{
-						ForceCenter += CapsuleDown * ((HitLoc - MyLocation) | CapsuleDown);
-					}
-					else
-					{
-						// Get the axis of the capsule bounded by the following two end points.
-						const FVector BottomPoint = ForceCenter + CapsuleDown * CapsuleHalfHeight;
-						const FVector TopPoint = ForceCenter - CapsuleDown * CapsuleHalfHeight;
-						const FVector Segment = TopPoint - BottomPoint;
+		// Split the body location into height along the capsule axis and offset from it.
+		const FVector BodyOffset = BodyLocations[i] - MyLocation;
+		const float Height = BodyOffset | CapsuleUp;
+		const FVector RadialOffset = BodyOffset - CapsuleUp * Height;
+		const float RadialDistance = RadialOffset.Size();
 
-						// Project the foreign body location on the segment.
-						const float Alpha = ((BodyLocation - BottomPoint) | Segment) / Segment.SizeSquared();
+		// Radius of the capsule cross section at that height, smaller along the hemispheres.
+		const float CapHeight = FMath::Abs(Height) - CylinderHalfHeight;
+		const float SurfaceRadius = (CapHeight > 0.0f) ? FMath::Sqrt(FMath::Max(FMath::Square(CapsuleRadius) - FMath::Square(CapHeight), 0.0f)) : CapsuleRadius;
 
-						if (Alpha < 0.0f)
-						{
-							ForceCenter = BottomPoint;
-						}
-						else if (Alpha > 1.0f)
-						{
-							ForceCenter = TopPoint;
-						}
-					}
+		// Bodies inside the capsule, or above or below it, are pushed away from the closest point on its axis.
+		const bool bIsPenetrating = FMath::Abs(Height) >= CapsuleHalfHeight || RadialDistance <= SurfaceRadius;
+		if (!bIsPenetrating)
+		{
+			// Offset from the closest point on the capsule surface towards the axis, at the body's height.
+			const FVector SurfaceOffset = RadialOffset * (1.0f - SurfaceRadius / RadialDistance);
+			const float DistanceNow = SurfaceOffset.SizeSquared();
+			if (DistanceNow < StopBodyDistance)
+			{
+				OverlapBody->SetLinearVelocity(FVector(0.0f, 0.0f, 0.0f), false);
+				continue;
+			}
 
-					OverlapBody->AddRadialForceToBody(ForceCenter, RepulsionForceRadius, RepulsionForce * Mass, ERadialImpulseFalloff::RIF_Constant);
-				}
+			// Skip bodies moving away from the capsule.
+			const FVector BodyVelocity = OverlapBody->GetUnrealWorldVelocity();
+			const float DistanceLater = (SurfaceOffset + FVector::VectorPlaneProject(BodyVelocity * DeltaSeconds, CapsuleUp)).SizeSquared();
+			if (DistanceLater > DistanceNow)
+			{
+				continue;
 			}
 		}
+
+		const FVector ForceCenter = MyLocation + CapsuleUp * FMath::Clamp(Height, -CapsuleHalfHeight, CapsuleHalfHeight);
+		OverlapBody->AddRadialForceToBody(ForceCenter, RepulsionForceRadius, RepulsionForce * Mass, ERadialImpulseFalloff::RIF_Constant);
 	}
 }
 
@@ -3781,7 +4245,38 @@ void UMCharacterMovementComponent::ApplyAccumulatedForces(float DeltaSeconds)
 	PendingForceToApply = FVector::ZeroVector;
 }
 
-FVector UMCharacterMovementComponent::GetGravity() const
+template<>
+FVector UMCharacterMovementComponent::GetGravityForMode<EMGravityMode::WorldZ>() const
+{
+	return FVector(0.0f, 0.0f, GetGravityZ());
+}
+
+template<>
+FVector UMCharacterMovementComponent::GetGravityForMode<EMGravityMode::Direction>() const
+{
+	return CustomGravityDirection * (FMath::Abs(UPawnMovementComponent::GetGravityZ()) * GravityScale);
+}
+
+template<>
+FVector UMCharacterMovementComponent::GetGravityForMode<EMGravityMode::Floor>() const
+{
+	return GetGravityForMode<EMGravityMode::Direction>();
+}
+
+template<>
+FVector UMCharacterMovementComponent::GetGravityForMode<EMGravityMode::Point>() const
+{
+	const FVector GravityDir = MVectorMath::GetSafeDirection(UpdatedComponent->GetComponentLocation(), GravityPoint);
+	if (!GravityDir.IsZero())
+	{
+		return GravityDir * (FMath::Abs(UPawnMovementComponent::GetGravityZ()) * GravityScale);
+	}
+
+	return FVector(0.0f, 0.0f, GetGravityZ());
+}
+
+template<>
+FVector UMCharacterMovementComponent::GetGravityForMode<EMGravityMode::Generic>() const
 {
 	if (!CustomGravityDirection.IsZero())
 	{
@@ -3790,17 +4285,65 @@ FVector UMCharacterMovementComponent::GetGravity() const
 
 	if (UpdatedComponent != nullptr && !GravityPoint.IsZero())
 	{
-		const FVector GravityDir = GravityPoint - UpdatedComponent->GetComponentLocation();
+		const FVector GravityDir = MVectorMath::GetSafeDirection(UpdatedComponent->GetComponentLocation(), GravityPoint);
 		if (!GravityDir.IsZero())
 		{
-			return GravityDir.GetSafeNormal() * (FMath::Abs(UPawnMovementComponent::GetGravityZ()) * GravityScale);
+			return GravityDir * (FMath::Abs(UPawnMovementComponent::GetGravityZ()) * GravityScale);
 		}
 	}
 
 	return FVector(0.0f, 0.0f, GetGravityZ());
 }
 
-FVector UMCharacterMovementComponent::GetGravityDirection(bool bAvoidZeroGravity) const
+FVector UMCharacterMovementComponent::GetGravity() const
+{
+	switch (GravityMode)
+	{
+	case EMGravityMode::WorldZ:
+		return GetGravityForMode<EMGravityMode::WorldZ>();
+	case EMGravityMode::Direction:
+		return GetGravityForMode<EMGravityMode::Direction>();
+	case EMGravityMode::Point:
+		return GetGravityForMode<EMGravityMode::Point>();
+	case EMGravityMode::Floor:
+		return GetGravityForMode<EMGravityMode::Floor>();
+	default:
+		return GetGravityForMode<EMGravityMode::Generic>();
+	}
+}
+
+template<>
+FVector UMCharacterMovementComponent::GetGravityDirectionForMode<EMGravityMode::WorldZ>(bool bAvoidZeroGravity) const
+{
+	return FVector(0.0f, 0.0f, -1.0f);
+}
+
+template<>
+FVector UMCharacterMovementComponent::GetGravityDirectionForMode<EMGravityMode::Direction>(bool bAvoidZeroGravity) const
+{
+	return CustomGravityDirection;
+}
+
+template<>
+FVector UMCharacterMovementComponent::GetGravityDirectionForMode<EMGravityMode::Floor>(bool bAvoidZeroGravity) const
+{
+	return CustomGravityDirection;
+}
+
+template<>
+FVector UMCharacterMovementComponent::GetGravityDirectionForMode<EMGravityMode::Point>(bool bAvoidZeroGravity) const
+{
+	const FVector GravityDir = MVectorMath::GetSafeDirection(UpdatedComponent->GetComponentLocation(), GravityPoint);
+	if (!bAvoidZeroGravity || !GravityDir.IsZero())
+	{
+		return GravityDir;
+	}
+
+	return FVector(0.0f, 0.0f, -1.0f);
+}
+
+template<>
+FVector UMCharacterMovementComponent::GetGravityDirectionForMode<EMGravityMode::Generic>(bool bAvoidZeroGravity) const
 {
 	// Gravity direction can be influenced by the custom gravity scale value.
 	if (GravityScale != 0.0f)
@@ -3812,10 +4355,10 @@ FVector UMCharacterMovementComponent::GetGravityDirection(bool bAvoidZeroGravity
 
 		if (UpdatedComponent != nullptr && !GravityPoint.IsZero())
 		{
-			const FVector GravityDir = GravityPoint - UpdatedComponent->GetComponentLocation();
+			const FVector GravityDir = MVectorMath::GetSafeDirection(UpdatedComponent->GetComponentLocation(), GravityPoint);
 			if (!bAvoidZeroGravity || !GravityDir.IsZero())
 			{
-				return GravityDir.GetSafeNormal() * ((GravityScale > 0.0f) ? 1.0f : -1.0f);
+				return GravityDir * ((GravityScale > 0.0f) ? 1.0f : -1.0f);
 			}
 		}
 
@@ -3847,6 +4390,53 @@ FVector UMCharacterMovementComponent::GetGravityDirection(bool bAvoidZeroGravity
 	return FVector::ZeroVector;
 }
 
+FVector UMCharacterMovementComponent::GetGravityDirection(bool bAvoidZeroGravity) const
+{
+	switch (GravityMode)
+	{
+	case EMGravityMode::WorldZ:
+		return GetGravityDirectionForMode<EMGravityMode::WorldZ>(bAvoidZeroGravity);
+	case EMGravityMode::Direction:
+		return GetGravityDirectionForMode<EMGravityMode::Direction>(bAvoidZeroGravity);
+	case EMGravityMode::Point:
+		return GetGravityDirectionForMode<EMGravityMode::Point>(bAvoidZeroGravity);
+	case EMGravityMode::Floor:
+		return GetGravityDirectionForMode<EMGravityMode::Floor>(bAvoidZeroGravity);
+	default:
+		return GetGravityDirectionForMode<EMGravityMode::Generic>(bAvoidZeroGravity);
+	}
+}
+
+void UMCharacterMovementComponent::ResolveGravityMode()
+{
+	// Specialized modes assume positive gravity pulling down, anything else stays generic.
+	if (UpdatedComponent == nullptr || GravityScale <= 0.0f || UPawnMovementComponent::GetGravityZ() >= 0.0f)
+	{
+		GravityMode = EMGravityMode::Generic;
+	}
+	else if (!CustomGravityDirection.IsZero())
+	{
+		GravityMode = bAlignCustomGravityToFloor ? EMGravityMode::Floor : EMGravityMode::Direction;
+	}
+	else if (!GravityPoint.IsZero())
+	{
+		GravityMode = EMGravityMode::Point;
+	}
+	else if (!bAlignComponentToFloor && !bAlignCustomGravityToFloor)
+	{
+		GravityMode = EMGravityMode::WorldZ;
+	}
+	else
+	{
+		GravityMode = EMGravityMode::Generic;
+	}
+}
+
+FORCEINLINE bool UMCharacterMovementComponent::CanUseStockPhysics() const
+{
+	return GravityMode == EMGravityMode::WorldZ && GetComponentAxisZ().Z >= THRESH_NORMALS_ARE_PARALLEL;
+}
+
 float UMCharacterMovementComponent::GetGravityMagnitude() const
 {
 	return FMath::Abs(GetGravityZ());
@@ -3859,8 +4449,10 @@ void UMCharacterMovementComponent::SetGravityDirection(const FVector& NewGravity
 
 FORCEINLINE void UMCharacterMovementComponent::SetCustomGravityDirection(const FVector& NewCustomGravityDirection)
 {
-	bDirtyCustomGravityDirection = CustomGravityDirection != NewCustomGravityDirection;
+	// Stays dirty until replicated, repeated calls with the same direction must not clear a pending change.
+	bDirtyCustomGravityDirection |= CustomGravityDirection != NewCustomGravityDirection;
 	CustomGravityDirection = NewCustomGravityDirection;
+	ResolveGravityMode();
 }
 
 void UMCharacterMovementComponent::ClientSetCustomGravityDirection_Implementation(const FVector& NewCustomGravityDirection)
@@ -3875,17 +4467,20 @@ void UMCharacterMovementComponent::ClientClearCustomGravityDirection_Implementat
 
 void UMCharacterMovementComponent::ClientSetGravityPoint_Implementation(const FVector& NewGravityPoint)
 {
-	GravityPoint = NewGravityPoint;
+	GravityPoint = FRepMovement::RebaseOntoLocalOrigin(NewGravityPoint, this);
+	ResolveGravityMode();
 }
 
 void UMCharacterMovementComponent::ClientClearGravityPoint_Implementation()
 {
 	GravityPoint = FVector::ZeroVector;
+	ResolveGravityMode();
 }
 
 void UMCharacterMovementComponent::ClientSetGravityScale_Implementation(float NewGravityScale)
 {
 	GravityScale = NewGravityScale;
+	ResolveGravityMode();
 }
 
 void UMCharacterMovementComponent::UpdateGravity(float DeltaTime)
@@ -3895,32 +4490,50 @@ void UMCharacterMovementComponent::UpdateGravity(float DeltaTime)
 		// Set the custom gravity direction to reversed floor normal vector.
 		SetCustomGravityDirection(CurrentFloor.HitResult.ImpactNormal * -1.0f);
 	}
+	else
+	{
+		// Gravity point and scale may be set directly, pick up any change once per update.
+		ResolveGravityMode();
+	}
 
-	if (!bDisableGravityReplication && CharacterOwner && CharacterOwner->HasAuthority() && GetNetMode() > NM_Standalone)
+	if (!bDisableGravityReplication && !bGravityReplicationPending && CharacterOwner && CharacterOwner->HasAuthority() && GetNetMode() > NM_Standalone &&
+		(bDirtyCustomGravityDirection || OldGravityPoint != GravityPoint || OldGravityScale != GravityScale))
 	{
-		if (bDirtyCustomGravityDirection)
+		// Replication isn't latency critical, let the server spread it across frames.
+		bGravityReplicationPending = true;
+		FMFrameBudgetScheduler::Schedule(GetWorld(), EMDeferredWorkCategory::GravityReplication, EMDeferredWorkPriority::High, this, [this]()
 		{
-			// Replicate custom gravity direction to clients.
-			(!CustomGravityDirection.IsZero()) ? ClientSetCustomGravityDirection(CustomGravityDirection) : ClientClearCustomGravityDirection();
-			bDirtyCustomGravityDirection = false;
-		}
+			ReplicateGravity();
+		});
+	}
 
-		if (OldGravityPoint != GravityPoint)
-		{
-			// Replicate gravity point to clients.
-			(!GravityPoint.IsZero()) ? ClientSetGravityPoint(GravityPoint) : ClientClearGravityPoint();
-			OldGravityPoint = GravityPoint;
-		}
+	UpdateComponentRotation();
+}
 
-		if (OldGravityScale != GravityScale)
-		{
-			// Replicate gravity scale to clients.
-			ClientSetGravityScale(GravityScale);
-			OldGravityScale = GravityScale;
-		}
+void UMCharacterMovementComponent::ReplicateGravity()
+{
+	bGravityReplicationPending = false;
+
+	if (bDirtyCustomGravityDirection)
+	{
+		// Replicate custom gravity direction to clients.
+		(!CustomGravityDirection.IsZero()) ? ClientSetCustomGravityDirection(CustomGravityDirection) : ClientClearCustomGravityDirection();
+		bDirtyCustomGravityDirection = false;
 	}
 
-	UpdateComponentRotation();
+	if (OldGravityPoint != GravityPoint)
+	{
+		// Replicate gravity point to clients.
+		(!GravityPoint.IsZero()) ? ClientSetGravityPoint(FRepMovement::RebaseOntoZeroOrigin(GravityPoint, this)) : ClientClearGravityPoint();
+		OldGravityPoint = GravityPoint;
+	}
+
+	if (OldGravityScale != GravityScale)
+	{
+		// Replicate gravity scale to clients.
+		ClientSetGravityScale(GravityScale);
+		OldGravityScale = GravityScale;
+	}
 }
 
 FRotator UMCharacterMovementComponent::ConstrainComponentRotation(const FRotator& Rotation) const
@@ -3931,22 +4544,12 @@ FRotator UMCharacterMovementComponent::ConstrainComponentRotation(const FRotator
 
 FORCEINLINE FVector UMCharacterMovementComponent::GetComponentAxisX() const
 {
-	// Fast simplification of FQuat::RotateVector() with FVector(1,0,0).
-	const FQuat ComponentRotation = UpdatedComponent->GetComponentQuat();
-	const FVector QuatVector(ComponentRotation.X, ComponentRotation.Y, ComponentRotation.Z);
-
-	return FVector(FMath::Square(ComponentRotation.W) - QuatVector.SizeSquared(), ComponentRotation.Z * ComponentRotation.W * 2.0f,
-		ComponentRotation.Y * ComponentRotation.W * -2.0f) + QuatVector * (ComponentRotation.X * 2.0f);
+	return MVectorMath::GetAxisX(UpdatedComponent->GetComponentQuat());
 }
 
 FORCEINLINE FVector UMCharacterMovementComponent::GetComponentAxisZ() const
 {
-	// Fast simplification of FQuat::RotateVector() with FVector(0,0,1).
-	const FQuat ComponentRotation = UpdatedComponent->GetComponentQuat();
-	const FVector QuatVector(ComponentRotation.X, ComponentRotation.Y, ComponentRotation.Z);
-
-	return FVector(ComponentRotation.Y * ComponentRotation.W * 2.0f, ComponentRotation.X * ComponentRotation.W * -2.0f,
-		FMath::Square(ComponentRotation.W) - QuatVector.SizeSquared()) + QuatVector * (ComponentRotation.Z * 2.0f);
+	return MVectorMath::GetAxisZ(UpdatedComponent->GetComponentQuat());
 }
 
 FVector UMCharacterMovementComponent::GetComponentDesiredAxisZ() const
@@ -3981,8 +4584,183 @@ void UMCharacterMovementComponent::UpdateComponentRotation()
 	}
 
 	// Take desired Z rotation axis of capsule, try to keep current X rotation axis of capsule.
-	const FMatrix RotationMatrix = FRotationMatrix::MakeFromZX(DesiredCapsuleUp, GetComponentAxisX());
+	const FQuat NewRotation = MVectorMath::MakeQuatFromZX(DesiredCapsuleUp, GetComponentAxisX());
 
 	// Intentionally not using MoveUpdatedComponent to bypass constraints.
-	UpdatedComponent->MoveComponent(FVector::ZeroVector, RotationMatrix.Rotator(), true);
+	UpdatedComponent->MoveComponent(FVector::ZeroVector, NewRotation, true);
+}
+
+void UMCharacterMovementComponent::UpdateComponentRotations(const TArray<UMCharacterMovementComponent*>& Components)
+{
+	struct FFrame
+	{
+		FQuat Rotation;
+
+		FVector DesiredAxisZ;
+
+		UMCharacterMovementComponent* Component;
+	};
+
+	TArray<FFrame, TInlineAllocator<64>> Frames;
+	Frames.Reserve(Components.Num());
+	for (UMCharacterMovementComponent* Component : Components)
+	{
+		if (Component && Component->HasValidData())
+		{
+			FFrame& Frame = Frames[Frames.AddUninitialized()];
+			Frame.Rotation = Component->UpdatedComponent->GetComponentQuat();
+			Frame.DesiredAxisZ = Component->GetComponentDesiredAxisZ();
+			Frame.Component = Component;
+		}
+	}
+
+	// Solve all frames first, moving components touches scattered memory
+	int32 NumChanged = 0;
+	for (FFrame& Frame : Frames)
+	{
+		if ((Frame.DesiredAxisZ | MVectorMath::GetAxisZ(Frame.Rotation)) < THRESH_NORMALS_ARE_PARALLEL)
+		{
+			Frame.Rotation = MVectorMath::MakeQuatFromZX(Frame.DesiredAxisZ, MVectorMath::GetAxisX(Frame.Rotation));
+			Frames[NumChanged++] = Frame;
+		}
+	}
+
+	for (int32 i = 0; i < NumChanged; i++)
+	{
+		Frames[i].Component->UpdatedComponent->MoveComponent(FVector::ZeroVector, Frames[i].Rotation, true);
+	}
+}
+
+float UMCharacterMovementComponent::GetMaxSpeed() const
+{
+	const float MaxSpeed = Super::GetMaxSpeed();
+
+	const AMCharacter* MCharacterOwner = Cast<AMCharacter>(CharacterOwner);
+	if (MCharacterOwner && IsMovingOnGround())
+	{
+		// Aiming takes precedence, characters can't run and aim at the same time.
+		if (MCharacterOwner->IsAiming())
+		{
+			return MaxSpeed * MCharacterOwner->GetHexStats().Get(EMHexStat::AimSpeed);
+		}
+
+		if (MCharacterOwner->IsRunning())
+		{
+			return MaxSpeed * MCharacterOwner->GetHexStats().Get(EMHexStat::RunSpeed);
+		}
+	}
+
+	return MaxSpeed;
+}
+
+FNetworkPredictionData_Client* UMCharacterMovementComponent::GetPredictionData_Client() const
+{
+	if (ClientPredictionData == nullptr)
+	{
+		UMCharacterMovementComponent* MutableThis = const_cast<UMCharacterMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_MCharacter(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UMCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	AMCharacter* MCharacterOwner = Cast<AMCharacter>(CharacterOwner);
+	if (MCharacterOwner)
+	{
+		const bool bWantsToRun = (Flags & FSavedMove_MCharacter::FLAG_WantsToRun) != 0;
+		const bool bIsAiming = (Flags & FSavedMove_MCharacter::FLAG_IsAiming) != 0;
+		MCharacterOwner->ApplyMovementFlags(bWantsToRun, bIsAiming);
+	}
+}
+
+bool UMCharacterMovementComponent::ClientUpdatePositionAfterServerUpdate()
+{
+	AMCharacter* MCharacterOwner = Cast<AMCharacter>(CharacterOwner);
+	if (!MCharacterOwner)
+	{
+		return Super::ClientUpdatePositionAfterServerUpdate();
+	}
+
+	// Replayed moves apply their own flags, restore the current input state afterwards.
+	const bool bRealWantsToRun = MCharacterOwner->WantsToRun();
+	const bool bRealIsAiming = MCharacterOwner->IsAiming();
+
+	const bool bResult = Super::ClientUpdatePositionAfterServerUpdate();
+
+	MCharacterOwner->ApplyMovementFlags(bRealWantsToRun, bRealIsAiming);
+
+	return bResult;
+}
+
+void FSavedMove_MCharacter::Clear()
+{
+	Super::Clear();
+
+	bSavedWantsToRun = false;
+	bSavedIsAiming = false;
+}
+
+uint8 FSavedMove_MCharacter::GetCompressedFlags() const
+{
+	uint8 Result = Super::GetCompressedFlags();
+
+	if (bSavedWantsToRun)
+	{
+		Result |= FLAG_WantsToRun;
+	}
+
+	if (bSavedIsAiming)
+	{
+		Result |= FLAG_IsAiming;
+	}
+
+	return Result;
+}
+
+bool FSavedMove_MCharacter::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* Character, float MaxDelta) const
+{
+	const FSavedMove_MCharacter* NewMCharacterMove = static_cast<const FSavedMove_MCharacter*>(NewMove.Get());
+	if (bSavedWantsToRun != NewMCharacterMove->bSavedWantsToRun || bSavedIsAiming != NewMCharacterMove->bSavedIsAiming)
+	{
+		return false;
+	}
+
+	return Super::CanCombineWith(NewMove, Character, MaxDelta);
+}
+
+void FSavedMove_MCharacter::SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(Character, InDeltaTime, NewAccel, ClientData);
+
+	const AMCharacter* MCharacter = Cast<AMCharacter>(Character);
+	if (MCharacter)
+	{
+		bSavedWantsToRun = MCharacter->WantsToRun();
+		bSavedIsAiming = MCharacter->IsAiming();
+	}
+}
+
+void FSavedMove_MCharacter::PrepMoveFor(ACharacter* Character)
+{
+	Super::PrepMoveFor(Character);
+
+	AMCharacter* MCharacter = Cast<AMCharacter>(Character);
+	if (MCharacter)
+	{
+		MCharacter->ApplyMovementFlags(bSavedWantsToRun, bSavedIsAiming);
+	}
+}
+
+FNetworkPredictionData_Client_MCharacter::FNetworkPredictionData_Client_MCharacter(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_MCharacter::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_MCharacter());
 }
@@ -0,0 +1,199 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MHitboxSet.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/SkeletalMesh.h"
+
+namespace
+{
+	/** Distance along a unit ray to where it enters a sphere, negative if it misses */
+	FORCEINLINE float RaySphere(const FVector& Origin, const FVector& Direction, const FVector& Center, float Radius)
+	{
+		const FVector OC = Origin - Center;
+		const float B = Direction | OC;
+		const float H = B * B - ((OC | OC) - Radius * Radius);
+		return H >= 0.0f ? -B - FMath::Sqrt(H) : -1.0f;
+	}
+
+	/** Distance along a unit ray to where it enters a capsule around segment A to A + BA, negative if it misses */
+	FORCEINLINE float RayCapsule(const FVector& Origin, const FVector& Direction, const FVector& A, const FVector& BA, float Radius)
+	{
+		const FVector OA = Origin - A;
+		const float BABA = BA | BA;
+		const float BARD = BA | Direction;
+		const float BAOA = BA | OA;
+
+		// Cylinder part, only where the hit projects inside the segment
+		const float QuadA = BABA - BARD * BARD;
+		if (QuadA > KINDA_SMALL_NUMBER)
+		{
+			const float QuadB = BABA * (Direction | OA) - BAOA * BARD;
+			const float QuadC = BABA * (OA | OA) - BAOA * BAOA - Radius * Radius * BABA;
+			const float H = QuadB * QuadB - QuadA * QuadC;
+			if (H < 0.0f)
+			{
+				return -1.0f;
+			}
+
+			const float Time = (-QuadB - FMath::Sqrt(H)) / QuadA;
+			const float Y = BAOA + Time * BARD;
+			if (Y > 0.0f && Y < BABA)
+			{
+				return Time;
+			}
+		}
+
+		// Hemispherical caps, the nearer one is hit first
+		const float TimeA = RaySphere(Origin, Direction, A, Radius);
+		const float TimeB = RaySphere(Origin, Direction, A + BA, Radius);
+		if (TimeA < 0.0f)
+		{
+			return TimeB;
+		}
+		return TimeB < 0.0f ? TimeA : FMath::Min(TimeA, TimeB);
+	}
+}
+
+FMHitboxDefinition::FMHitboxDefinition()
+	: BoneName(NAME_None)
+	, Zone(EMHitZone::Body)
+	, Offset(FVector::ZeroVector)
+	, Radius(10.0f)
+	, HalfLength(0.0f)
+{
+}
+
+FMHitboxSet::FMHitboxSet()
+	: InitializedMesh(nullptr)
+	, BoundsCenter(FVector::ZeroVector)
+	, BoundsRadius(0.0f)
+{
+}
+
+bool FMHitboxSet::IsInitializedFor(const USkeletalMeshComponent* Mesh) const
+{
+	return Mesh && InitializedMesh && Mesh->SkeletalMesh == InitializedMesh;
+}
+
+void FMHitboxSet::Init(const USkeletalMeshComponent* Mesh, const TArray<FMHitboxDefinition>& Definitions)
+{
+	InitializedMesh = Mesh ? Mesh->SkeletalMesh : nullptr;
+
+	BoneIndices.Reset(Definitions.Num());
+	BoneNames.Reset(Definitions.Num());
+	Zones.Reset(Definitions.Num());
+	LocalCenters.Reset(Definitions.Num());
+	HalfLengths.Reset(Definitions.Num());
+	Radii.Reset(Definitions.Num());
+
+	for (const FMHitboxDefinition& Definition : Definitions)
+	{
+		const int32 BoneIndex = Mesh ? Mesh->GetBoneIndex(Definition.BoneName) : INDEX_NONE;
+		if (BoneIndex == INDEX_NONE && Mesh && InitializedMesh)
+		{
+			UE_LOG(LogWeapon, Warning, TEXT("Hitbox bone %s not found on %s, hitbox follows the component"), *Definition.BoneName.ToString(), *GetNameSafe(InitializedMesh));
+		}
+
+		BoneIndices.Add(BoneIndex);
+		BoneNames.Add(Definition.BoneName);
+		Zones.Add(Definition.Zone);
+		LocalCenters.Add(Definition.Offset);
+		HalfLengths.Add(Definition.HalfLength);
+		Radii.Add(Definition.Radius);
+	}
+
+	SegmentStarts.SetNumZeroed(Radii.Num());
+	Segments.SetNumZeroed(Radii.Num());
+	BoundsCenter = FVector::ZeroVector;
+	BoundsRadius = 0.0f;
+}
+
+void FMHitboxSet::Update(const USkeletalMeshComponent* Mesh)
+{
+	if (!Mesh || Radii.Num() == 0)
+	{
+		return;
+	}
+
+	const FTransform& ComponentTransform = Mesh->GetComponentTransform();
+	FBox Box(ForceInit);
+	for (int32 i = 0; i < Radii.Num(); i++)
+	{
+		const FTransform BoneTransform = BoneIndices[i] != INDEX_NONE ? Mesh->GetBoneTransform(BoneIndices[i], ComponentTransform) : ComponentTransform;
+		const FVector Center = BoneTransform.TransformPosition(LocalCenters[i]);
+		const FVector HalfSegment = BoneTransform.TransformVector(FVector(HalfLengths[i], 0.0f, 0.0f));
+
+		SegmentStarts[i] = Center - HalfSegment;
+		Segments[i] = HalfSegment * 2.0f;
+		Box += SegmentStarts[i];
+		Box += SegmentStarts[i] + Segments[i];
+	}
+
+	BoundsCenter = Box.GetCenter();
+	BoundsRadius = 0.0f;
+	for (int32 i = 0; i < Radii.Num(); i++)
+	{
+		const float EndDistanceSq = FMath::Max(FVector::DistSquared(SegmentStarts[i], BoundsCenter), FVector::DistSquared(SegmentStarts[i] + Segments[i], BoundsCenter));
+		BoundsRadius = FMath::Max(BoundsRadius, FMath::Sqrt(EndDistanceSq) + Radii[i]);
+	}
+}
+
+bool FMHitboxSet::Raycast(const FVector& Start, const FVector& End, FMHitboxHit& OutHit) const
+{
+	FVector Direction;
+	float Length;
+	(End - Start).ToDirectionAndLength(Direction, Length);
+	if (Radii.Num() == 0 || Length < KINDA_SMALL_NUMBER || !FMath::LineSphereIntersection(Start, Direction, Length, BoundsCenter, BoundsRadius))
+	{
+		return false;
+	}
+
+	int32 BestIndex = INDEX_NONE;
+	float BestTime = Length;
+	for (int32 i = 0; i < Radii.Num(); i++)
+	{
+		const float Time = RayCapsule(Start, Direction, SegmentStarts[i], Segments[i], Radii[i]);
+		if (Time >= 0.0f && Time <= BestTime)
+		{
+			BestIndex = i;
+			BestTime = Time;
+		}
+	}
+
+	if (BestIndex == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// Normal points away from the closest point on the segment
+	const FVector Location = Start + Direction * BestTime;
+	const FVector& SegmentStart = SegmentStarts[BestIndex];
+	const FVector& Segment = Segments[BestIndex];
+	const float SegmentLengthSq = Segment.SizeSquared();
+	const float Alpha = SegmentLengthSq > KINDA_SMALL_NUMBER ? FMath::Clamp(((Location - SegmentStart) | Segment) / SegmentLengthSq, 0.0f, 1.0f) : 0.0f;
+
+	OutHit.Index = BestIndex;
+	OutHit.BoneName = BoneNames[BestIndex];
+	OutHit.Zone = Zones[BestIndex];
+	OutHit.Distance = BestTime;
+	OutHit.Location = Location;
+	OutHit.Normal = (Location - (SegmentStart + Segment * Alpha)).GetSafeNormal();
+	if (OutHit.Normal.IsZero())
+	{
+		OutHit.Normal = -Direction;
+	}
+	return true;
+}
+
+float FMHitboxSet::GetDistanceToSegment(int32 Index, const FVector& Start, const FVector& End) const
+{
+	if (!Radii.IsValidIndex(Index))
+	{
+		return BIG_NUMBER;
+	}
+
+	FVector ClosestOnSegment;
+	FVector ClosestOnHitbox;
+	FMath::SegmentDistToSegmentSafe(Start, End, SegmentStarts[Index], SegmentStarts[Index] + Segments[Index], ClosestOnSegment, ClosestOnHitbox);
+	return FVector::Dist(ClosestOnSegment, ClosestOnHitbox) - Radii[Index];
+}
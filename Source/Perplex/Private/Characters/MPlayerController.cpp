@@ -2,6 +2,35 @@
 
 #include "MPlayerController.h"
 #include "MPlayerCharacter.h"
+#include "Misc/CommandLine.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+
+namespace
+{
+	/** Seconds between bot decisions */
+	const float BotMinDecisionTime = 0.5f;
+	const float BotMaxDecisionTime = 3.0f;
+
+	/** Chance per decision to do something */
+	const float BotJumpChance = 0.2f;
+	const float BotFireChance = 0.4f;
+	const float BotRunChance = 0.3f;
+}
+
+AMPlayerController::AMPlayerController()
+{
+	bIsBot = false;
+	BotDecisionTime = 0.0f;
+	BotMoveHorizontal = 0.0f;
+	BotMoveVertical = 0.0f;
+	BotLookHorizontal = 0.0f;
+	BotLookVertical = 0.0f;
+	bBotFiring = false;
+	bBotRunning = false;
+	bBotJumping = false;
+	WorldOriginRebaseDistance = 200000.0f;
+}
 
 void AMPlayerController::SetupInputComponent()
 {
@@ -27,6 +56,28 @@ void AMPlayerController::SetupInputComponent()
 	}
 }
 
+void AMPlayerController::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (IsLocalController() && GetNetMode() == NM_Client && FParse::Param(FCommandLine::Get(), TEXT("PerplexBot")))
+	{
+		bIsBot = true;
+
+		int32 Seed = 0;
+		if (!FParse::Value(FCommandLine::Get(), TEXT("PerplexBotSeed="), Seed))
+		{
+			Seed = (int32)FPlatformTime::Cycles();
+		}
+		BotRandom.Initialize(Seed);
+	}
+}
+
+void AMPlayerController::SetGenericTeamId(const FGenericTeamId& NewTeamId)
+{
+	TeamId = NewTeamId;
+}
+
 void AMPlayerController::BeginPlayingState()
 {
 	Super::BeginPlayingState();
@@ -34,9 +85,108 @@ void AMPlayerController::BeginPlayingState()
 	PlayerCharacter = Cast<AMPlayerCharacter>(GetCharacter());
 }
 
+void AMPlayerController::PlayerTick(float DeltaTime)
+{
+	Super::PlayerTick(DeltaTime);
+
+	if (bIsBot)
+	{
+		TickBot(DeltaTime);
+	}
+
+	UpdateWorldOrigin();
+}
+
+void AMPlayerController::UpdateWorldOrigin()
+{
+	UWorld* World = GetWorld();
+	if (WorldOriginRebaseDistance <= 0.0f || !IsLocalController() || !World->GetWorldSettings()->bEnableWorldOriginRebasing)
+	{
+		return;
+	}
+
+	// Servers stay at the zero origin that clients rebase replicated locations against
+	const ENetMode NetMode = GetNetMode();
+	if (NetMode != NM_Standalone && NetMode != NM_Client)
+	{
+		return;
+	}
+
+	const APawn* ViewPawn = GetPawnOrSpectator();
+	if (!ViewPawn)
+	{
+		return;
+	}
+
+	const FVector Location = ViewPawn->GetActorLocation();
+	if (Location.SizeSquared() > FMath::Square(WorldOriginRebaseDistance))
+	{
+		const FIntVector Offset(FMath::RoundToInt(Location.X), FMath::RoundToInt(Location.Y), FMath::RoundToInt(Location.Z));
+		World->RequestNewWorldOrigin(World->OriginLocation + Offset);
+	}
+}
+
+void AMPlayerController::TickBot(float DeltaTime)
+{
+	if (!PlayerCharacter)
+	{
+		return;
+	}
+
+	BotDecisionTime -= DeltaTime;
+	if (BotDecisionTime <= 0.0f)
+	{
+		UpdateBotDecision();
+		BotDecisionTime = BotRandom.FRandRange(BotMinDecisionTime, BotMaxDecisionTime);
+	}
+
+	// Axes are fed every frame, same as bound input
+	OnMoveHorizontal(BotMoveHorizontal);
+	OnMoveVertical(BotMoveVertical);
+	OnLookHorizontal(BotLookHorizontal * DeltaTime);
+	OnLookVertical(BotLookVertical * DeltaTime);
+}
+
+void AMPlayerController::UpdateBotDecision()
+{
+	BotMoveHorizontal = BotRandom.FRandRange(-1.0f, 1.0f);
+	BotMoveVertical = BotRandom.FRandRange(-0.25f, 1.0f);
+	BotLookHorizontal = BotRandom.FRandRange(-30.0f, 30.0f);
+	BotLookVertical = BotRandom.FRandRange(-5.0f, 5.0f);
+
+	// Jump is held until next decision, releasing it in the same frame would never jump
+	if (bBotJumping)
+	{
+		bBotJumping = false;
+		OnStopJump();
+	}
+	if (BotRandom.FRand() < BotJumpChance)
+	{
+		bBotJumping = true;
+		OnStartJump();
+	}
+
+	const bool bWantsToRun = BotRandom.FRand() < BotRunChance;
+	if (bWantsToRun != bBotRunning)
+	{
+		bBotRunning = bWantsToRun;
+		bBotRunning ? OnStartRun() : OnStopRun();
+	}
+
+	const bool bWantsToFire = BotRandom.FRand() < BotFireChance;
+	if (bWantsToFire != bBotFiring)
+	{
+		bBotFiring = bWantsToFire;
+		bBotFiring ? OnStartWeaponFire() : OnStopWeaponFire();
+	}
+}
+
 void AMPlayerController::OnMoveHorizontal(float AxisValue)
 {
-	PlayerCharacter->MoveHorizontal(AxisValue);
+	if (PlayerCharacter)
+	{
+		PlayerCharacter->MoveHorizontal(AxisValue);
+	}
 }
 
 void AMPlayerController::OnMoveVertical(float AxisValue)
@@ -6,3 +6,8 @@ AMExplosionEffect::AMExplosionEffect()
 {
 	PrimaryActorTick.bCanEverTick = false;
 }
+
+bool AMExplosionEffect::NeedsLoadForServer() const
+{
+	return false;
+}
@@ -6,3 +6,8 @@ AMImpactEffect::AMImpactEffect()
 {
 	PrimaryActorTick.bCanEverTick = false;
 }
+
+bool AMImpactEffect::NeedsLoadForServer() const
+{
+	return false;
+}
@@ -0,0 +1,95 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MCharacterHash.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Characters/MCharacter.h"
+
+FMCharacterHash::FMCharacterHash()
+	: CellSize(1.0f)
+{
+}
+
+FIntVector FMCharacterHash::GetCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize), FMath::FloorToInt(Location.Z / CellSize));
+}
+
+void FMCharacterHash::Rebuild(UWorld* World, float InCellSize)
+{
+	CellSize = FMath::Max(InCellSize, 1.0f);
+	Locations.Reset();
+	Characters.Reset();
+	CharacterCells.Reset();
+
+	if (World)
+	{
+		for (TActorIterator<AMCharacter> It(World); It; ++It)
+		{
+			AMCharacter* Character = *It;
+			if (Character->IsPendingKill() || Character->bTearOff || Character->GetHealth() <= 0.0f)
+			{
+				continue;
+			}
+
+			Locations.Add(Character->GetActorLocation());
+			Characters.Add(Character);
+			CharacterCells.Add(GetCell(Locations.Last()));
+		}
+	}
+
+	// Counted first and then filled in
+	Cells.Reset();
+	for (const FIntVector& Cell : CharacterCells)
+	{
+		FCellRange* Range = Cells.Find(Cell);
+		if (!Range)
+		{
+			Range = &Cells.Add(Cell, FCellRange{ 0, 0 });
+		}
+		Range->Num++;
+	}
+
+	int32 Offset = 0;
+	for (auto& Pair : Cells)
+	{
+		Pair.Value.Start = Offset;
+		Offset += Pair.Value.Num;
+		Pair.Value.Num = 0;
+	}
+
+	SortedCharacters.SetNumUninitialized(CharacterCells.Num());
+	for (int32 Index = 0; Index < CharacterCells.Num(); Index++)
+	{
+		FCellRange& Range = Cells.FindChecked(CharacterCells[Index]);
+		SortedCharacters[Range.Start + Range.Num++] = Index;
+	}
+}
+
+void FMCharacterHash::GetCharactersInRadius(const FVector& Origin, float Radius, TArray<AMCharacter*>& OutCharacters) const
+{
+	OutCharacters.Reset();
+
+	const float RadiusSq = FMath::Square(Radius);
+	const FIntVector MinCell = GetCell(Origin - FVector(Radius));
+	const FIntVector MaxCell = GetCell(Origin + FVector(Radius));
+	for (int32 X = MinCell.X; X <= MaxCell.X; X++)
+	for (int32 Y = MinCell.Y; Y <= MaxCell.Y; Y++)
+	for (int32 Z = MinCell.Z; Z <= MaxCell.Z; Z++)
+	{
+		const FCellRange* Range = Cells.Find(FIntVector(X, Y, Z));
+		if (!Range)
+		{
+			continue;
+		}
+
+		for (int32 i = Range->Start; i < Range->Start + Range->Num; i++)
+		{
+			const int32 Index = SortedCharacters[i];
+			if (FVector::DistSquared(Locations[Index], Origin) <= RadiusSq)
+			{
+				OutCharacters.Add(Characters[Index]);
+			}
+		}
+	}
+}
@@ -0,0 +1,61 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MGameState.h"
+#include "UnrealNetwork.h"
+#include "Assets/MAssetStreamer.h"
+#include "GameModes/MJointGameMode.h"
+#include "Weapons/MWeapon.h"
+
+AMGameState::AMGameState(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+}
+
+void AMGameState::ReceivedGameModeClass()
+{
+	Super::ReceivedGameModeClass();
+
+	const AMJointGameMode* DefaultGameMode = GetDefaultGameMode<AMJointGameMode>();
+	if (!DefaultGameMode)
+	{
+		return;
+	}
+
+	TArray<FSoftObjectPath> Paths;
+	DefaultGameMode->GetLoadoutWeapons(Paths);
+	LoadoutWeaponsHandle = FMAssetStreamer::RequestLoad(Paths, EMAssetStreamPriority::Preload, FStreamableDelegate::CreateUObject(this, &AMGameState::OnLoadoutWeaponsLoaded));
+}
+
+void AMGameState::OnLoadoutWeaponsLoaded()
+{
+	const AMJointGameMode* DefaultGameMode = GetDefaultGameMode<AMJointGameMode>();
+	if (!DefaultGameMode)
+	{
+		return;
+	}
+
+	// Resolved from paths, the handle isn't assigned yet if everything was already loaded
+	TArray<FSoftObjectPath> WeaponPaths;
+	DefaultGameMode->GetLoadoutWeapons(WeaponPaths);
+
+	TArray<FSoftObjectPath> Paths;
+	for (const FSoftObjectPath& WeaponPath : WeaponPaths)
+	{
+		UClass* WeaponClass = Cast<UClass>(WeaponPath.ResolveObject());
+		const AMWeapon* DefaultWeapon = WeaponClass ? Cast<AMWeapon>(WeaponClass->GetDefaultObject()) : nullptr;
+		if (DefaultWeapon)
+		{
+			DefaultWeapon->GetGameplayAssets(Paths);
+			DefaultWeapon->GetCosmeticAssets(Paths);
+		}
+	}
+
+	LoadoutAssetsHandle = FMAssetStreamer::RequestLoad(Paths, EMAssetStreamPriority::Preload);
+}
+
+void AMGameState::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AMGameState, TeamRegistry);
+}
@@ -1,3 +1,317 @@
 // Copyright 2018 Tin Rabzelj. All Rights Reserved.
 
 #include "MJointGameMode.h"
+#include "Engine/World.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/DamageType.h"
+#include "Misc/CommandLine.h"
+#include "GameFramework/PlayerState.h"
+#include "Assets/MAssetStreamer.h"
+#include "Characters/MCharacter.h"
+#include "Characters/MCharacterMovementComponent.h"
+#include "GameModes/MGameState.h"
+#include "Weapons/MWeapon.h"
+
+static FAutoConsoleCommandWithWorld DumpNetUpdateRatesCommand(
+	TEXT("Perplex.DumpNetUpdateRates"),
+	TEXT("Logs adaptive NetUpdateFrequency of every character on the server."),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		AMJointGameMode* GameMode = World ? World->GetAuthGameMode<AMJointGameMode>() : nullptr;
+		if (GameMode)
+		{
+			GameMode->GetNetUpdateRateController().DumpStats();
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld ServerLoadReportCommand(
+	TEXT("Perplex.ServerLoadReport"),
+	TEXT("Starts recording server load, or logs the summary and writes a CSV if already recording."),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		AMJointGameMode* GameMode = World ? World->GetAuthGameMode<AMJointGameMode>() : nullptr;
+		if (!GameMode)
+		{
+			return;
+		}
+
+		FMServerLoadReport& Report = GameMode->GetServerLoadReport();
+		if (Report.bEnabled)
+		{
+			GameMode->ExportServerLoadReport();
+		}
+		else
+		{
+			Report.Reset();
+			Report.bEnabled = true;
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld NetBandwidthProfileCommand(
+	TEXT("Perplex.NetBandwidthProfile"),
+	TEXT("Starts recording bits per replicated property and RPC per connection, or logs the summary and writes a CSV if already recording."),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		AMJointGameMode* GameMode = World ? World->GetAuthGameMode<AMJointGameMode>() : nullptr;
+		if (!GameMode)
+		{
+			return;
+		}
+
+		FMNetBandwidthProfiler& Profiler = GameMode->GetNetBandwidthProfiler();
+		if (Profiler.bEnabled)
+		{
+			GameMode->ExportNetBandwidthProfile();
+		}
+		else
+		{
+			Profiler.Reset();
+			Profiler.bEnabled = true;
+		}
+	}));
+
+static FAutoConsoleCommandWithWorld DumpFrameBudgetCommand(
+	TEXT("Perplex.DumpFrameBudget"),
+	TEXT("Logs per category usage of the deferred work frame budget."),
+	FConsoleCommandWithWorldDelegate::CreateStatic([](UWorld* World)
+	{
+		AMJointGameMode* GameMode = World ? World->GetAuthGameMode<AMJointGameMode>() : nullptr;
+		if (GameMode)
+		{
+			GameMode->GetFrameBudgetScheduler().DumpStats();
+		}
+	}));
+
+AMJointGameMode::AMJointGameMode(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	GameStateClass = AMGameState::StaticClass();
+
+	NumTeams = 1;
+	DeferredWorkBudgetMicroseconds = 1000.0f;
+}
+
+void AMJointGameMode::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	ServerLoadReport.bEnabled = FParse::Param(FCommandLine::Get(), TEXT("PerplexLoadReport"));
+	NetBandwidthProfiler.bEnabled = FParse::Param(FCommandLine::Get(), TEXT("PerplexNetProfile"));
+}
+
+void AMJointGameMode::InitGameState()
+{
+	Super::InitGameState();
+
+	AMGameState* MGameState = GetGameState<AMGameState>();
+	if (MGameState)
+	{
+		MGameState->GetTeamRegistry().Init(NumTeams);
+	}
+}
+
+void AMJointGameMode::PostLogin(APlayerController* NewPlayer)
+{
+	Super::PostLogin(NewPlayer);
+
+	AssignTeam(NewPlayer);
+}
+
+void AMJointGameMode::Logout(AController* Exiting)
+{
+	ReleaseTeam(Exiting);
+
+	Super::Logout(Exiting);
+}
+
+void AMJointGameMode::AssignTeam(AController* Controller)
+{
+	IGenericTeamAgentInterface* TeamAgent = Cast<IGenericTeamAgentInterface>(Controller);
+	AMGameState* MGameState = GetGameState<AMGameState>();
+	if (!TeamAgent || !MGameState)
+	{
+		return;
+	}
+
+	FMTeamRegistry& TeamRegistry = MGameState->GetTeamRegistry();
+	TeamRegistry.RemoveMember(TeamAgent->GetGenericTeamId());
+
+	FGenericTeamId Team = FGenericTeamId::NoTeam;
+	if (!Controller->PlayerState || !Controller->PlayerState->bOnlySpectator)
+	{
+		Team = TeamRegistry.PickTeam();
+		TeamRegistry.AddMember(Team);
+	}
+	TeamAgent->SetGenericTeamId(Team);
+
+	// Pawns possessed before the team was known
+	AMCharacter* Character = Cast<AMCharacter>(Controller->GetPawn());
+	if (Character)
+	{
+		Character->UpdateTeam();
+	}
+}
+
+void AMJointGameMode::ReleaseTeam(AController* Controller)
+{
+	IGenericTeamAgentInterface* TeamAgent = Cast<IGenericTeamAgentInterface>(Controller);
+	AMGameState* MGameState = GetGameState<AMGameState>();
+	if (!TeamAgent || !MGameState)
+	{
+		return;
+	}
+
+	MGameState->GetTeamRegistry().RemoveMember(TeamAgent->GetGenericTeamId());
+	TeamAgent->SetGenericTeamId(FGenericTeamId::NoTeam);
+}
+
+bool AMJointGameMode::ApplyRadialDamage(float BaseDamage, float MinimumDamage, const FVector& Origin, float InnerRadius, float OuterRadius, float DamageFalloff,
+	TSubclassOf<UDamageType> DamageTypeClass, AActor* DamageCauser, AController* InstigatedBy)
+{
+	const IGenericTeamAgentInterface* TeamAgent = Cast<IGenericTeamAgentInterface>(InstigatedBy);
+	const AMGameState* MGameState = GetGameState<AMGameState>();
+	if (!TeamAgent || !MGameState)
+	{
+		return false;
+	}
+
+	TArray<AMCharacter*> Enemies;
+	MGameState->GetTeamRegistry().GetEnemiesInRadius(CharacterHash, TeamAgent->GetGenericTeamId(), Origin, OuterRadius, Enemies);
+
+	FRadialDamageEvent DamageEvent;
+	DamageEvent.DamageTypeClass = DamageTypeClass ? DamageTypeClass : TSubclassOf<UDamageType>(UDamageType::StaticClass());
+	DamageEvent.Origin = Origin;
+	DamageEvent.Params = FRadialDamageParams(BaseDamage, MinimumDamage, InnerRadius, OuterRadius, DamageFalloff);
+
+	FCollisionQueryParams TraceParams(SCENE_QUERY_STAT(RadialDamage), false, DamageCauser);
+
+	bool bDamaged = false;
+	for (AMCharacter* Enemy : Enemies)
+	{
+		// Hash locations are from the start of the tick, falloff uses the current capsule
+		UCapsuleComponent* Capsule = Enemy->GetCapsuleComponent();
+		FVector ClosestPoint;
+		if (Capsule->GetClosestPointOnCollision(Origin, ClosestPoint) < 0.0f)
+		{
+			ClosestPoint = Enemy->GetActorLocation();
+		}
+
+		FCollisionQueryParams EnemyTraceParams = TraceParams;
+		EnemyTraceParams.AddIgnoredActor(Enemy);
+		EnemyTraceParams.AddIgnoredActor(Enemy->GetWeapon());
+		if (GetWorld()->LineTraceTestByChannel(Origin, Enemy->GetActorLocation(), ECC_Visibility, EnemyTraceParams))
+		{
+			continue;
+		}
+
+		DamageEvent.ComponentHits.Reset();
+		DamageEvent.ComponentHits.Add(FHitResult(Enemy, Capsule, ClosestPoint, (ClosestPoint - Origin).GetSafeNormal()));
+		Enemy->TakeDamage(BaseDamage, DamageEvent, InstigatedBy, DamageCauser);
+		bDamaged = true;
+	}
+
+	return bDamaged;
+}
+
+void AMJointGameMode::UpdateCharacterRotations()
+{
+	MovementComponents.Reset();
+	for (AMCharacter* Character : CharacterHash.GetCharacters())
+	{
+		if (Character->GetCustomCharacterMovementComponent())
+		{
+			MovementComponents.Add(Character->GetCustomCharacterMovementComponent());
+		}
+	}
+
+	UMCharacterMovementComponent::UpdateComponentRotations(MovementComponents);
+}
+
+void AMJointGameMode::GetLoadoutWeapons(TArray<FSoftObjectPath>& OutPaths) const
+{
+	const AMCharacter* DefaultCharacter = DefaultPawnClass ? Cast<AMCharacter>(DefaultPawnClass->GetDefaultObject()) : nullptr;
+	if (DefaultCharacter)
+	{
+		FMAssetStreamer::AddPath(OutPaths, DefaultCharacter->GetStartWeaponClass());
+	}
+
+	for (const TSoftClassPtr<AMWeapon>& WeaponClass : LoadoutWeapons)
+	{
+		FMAssetStreamer::AddPath(OutPaths, WeaponClass);
+	}
+}
+
+void AMJointGameMode::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (ServerLoadReport.bEnabled)
+	{
+		ExportServerLoadReport();
+	}
+
+	if (NetBandwidthProfiler.bEnabled)
+	{
+		ExportNetBandwidthProfile();
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AMJointGameMode::ExportServerLoadReport()
+{
+	ServerLoadReport.DumpSummary();
+
+	FString Filename;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("PerplexLoadReportCsv="), Filename))
+	{
+		Filename = FMServerLoadReport::GetDefaultCsvFilename();
+	}
+
+	if (ServerLoadReport.WriteCsv(Filename))
+	{
+		UE_LOG(LogPerplexNet, Log, TEXT("Server load report written to %s"), *Filename);
+	}
+	else
+	{
+		UE_LOG(LogPerplexNet, Warning, TEXT("Failed to write server load report to %s"), *Filename);
+	}
+}
+
+void AMJointGameMode::ExportNetBandwidthProfile()
+{
+	NetBandwidthProfiler.DumpSummary();
+
+	FString Filename;
+	if (!FParse::Value(FCommandLine::Get(), TEXT("PerplexNetProfileCsv="), Filename))
+	{
+		Filename = FMNetBandwidthProfiler::GetDefaultCsvFilename();
+	}
+
+	if (NetBandwidthProfiler.WriteCsv(Filename))
+	{
+		UE_LOG(LogPerplexNet, Log, TEXT("Net bandwidth profile written to %s"), *Filename);
+	}
+	else
+	{
+		UE_LOG(LogPerplexNet, Warning, TEXT("Failed to write net bandwidth profile to %s"), *Filename);
+	}
+}
+
+void AMJointGameMode::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	RelevancyGrid.Rebuild(GetWorld(), RelevancyGridSettings);
+	CrowdAvoidance.Tick(GetWorld(), CrowdAvoidanceSettings);
+	CharacterHash.Rebuild(GetWorld(), AITargetingSettings.SearchRadius);
+	UpdateCharacterRotations();
+	AITargetingService.Tick(GetWorld(), CharacterHash, AITargetingSettings);
+
+	NetUpdateRateController.Tick(GetWorld(), DeltaSeconds, NetUpdateRateSettings);
+	ServerLoadReport.Tick(GetWorld(), DeltaSeconds);
+	NetBandwidthProfiler.Tick(GetWorld(), DeltaSeconds);
+
+	FrameBudgetScheduler.BudgetMicroseconds = DeferredWorkBudgetMicroseconds;
+	FrameBudgetScheduler.Tick(DeltaSeconds);
+}
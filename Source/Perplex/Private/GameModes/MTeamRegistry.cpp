@@ -0,0 +1,109 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MTeamRegistry.h"
+#include "Characters/MCharacter.h"
+#include "GameModes/MCharacterHash.h"
+
+FMTeamRegistry::FMTeamRegistry()
+{
+}
+
+void FMTeamRegistry::Init(int32 InNumTeams)
+{
+	const int32 NumTeams = FMath::Clamp(InNumTeams, 1, MaxTeams);
+
+	EnemyMasks.Reset();
+	NumMembers.Reset();
+	EnemyMasks.AddZeroed(NumTeams);
+	NumMembers.AddZeroed(NumTeams);
+
+	if (NumTeams == 1)
+	{
+		SetEnemies(0, 0, true);
+		return;
+	}
+
+	for (int32 TeamA = 0; TeamA < NumTeams; TeamA++)
+	{
+		for (int32 TeamB = TeamA + 1; TeamB < NumTeams; TeamB++)
+		{
+			SetEnemies(TeamA, TeamB, true);
+		}
+	}
+}
+
+void FMTeamRegistry::SetEnemies(FGenericTeamId TeamA, FGenericTeamId TeamB, bool bEnemies)
+{
+	if (TeamA.GetId() >= EnemyMasks.Num() || TeamB.GetId() >= EnemyMasks.Num())
+	{
+		return;
+	}
+
+	if (bEnemies)
+	{
+		EnemyMasks[TeamA.GetId()] |= 1u << TeamB.GetId();
+		EnemyMasks[TeamB.GetId()] |= 1u << TeamA.GetId();
+	}
+	else
+	{
+		EnemyMasks[TeamA.GetId()] &= ~(1u << TeamB.GetId());
+		EnemyMasks[TeamB.GetId()] &= ~(1u << TeamA.GetId());
+	}
+}
+
+FGenericTeamId FMTeamRegistry::PickTeam() const
+{
+	int32 BestTeam = INDEX_NONE;
+	for (int32 Team = 0; Team < NumMembers.Num(); Team++)
+	{
+		if (BestTeam == INDEX_NONE || NumMembers[Team] < NumMembers[BestTeam])
+		{
+			BestTeam = Team;
+		}
+	}
+
+	return BestTeam != INDEX_NONE ? FGenericTeamId(BestTeam) : FGenericTeamId::NoTeam;
+}
+
+void FMTeamRegistry::AddMember(FGenericTeamId Team)
+{
+	if (Team.GetId() < NumMembers.Num())
+	{
+		NumMembers[Team.GetId()]++;
+	}
+}
+
+void FMTeamRegistry::RemoveMember(FGenericTeamId Team)
+{
+	if (Team.GetId() < NumMembers.Num())
+	{
+		NumMembers[Team.GetId()] = FMath::Max(NumMembers[Team.GetId()] - 1, 0);
+	}
+}
+
+void FMTeamRegistry::GetEnemiesInRadius(const FMCharacterHash& CharacterHash, FGenericTeamId Team, const FVector& Origin, float Radius, TArray<AMCharacter*>& OutEnemies) const
+{
+	OutEnemies.Reset();
+	if (GetEnemyMask(Team) == 0)
+	{
+		return;
+	}
+
+	TArray<AMCharacter*> Characters;
+	CharacterHash.GetCharactersInRadius(Origin, Radius, Characters);
+	FilterEnemies(Team, Characters, OutEnemies);
+}
+
+void FMTeamRegistry::FilterEnemies(FGenericTeamId Team, const TArray<AMCharacter*>& Characters, TArray<AMCharacter*>& OutEnemies) const
+{
+	OutEnemies.Reset();
+
+	const uint32 EnemyMask = GetEnemyMask(Team);
+	for (AMCharacter* Character : Characters)
+	{
+		if (Character && IsInMask(EnemyMask, Character->GetGenericTeamId()))
+		{
+			OutEnemies.Add(Character);
+		}
+	}
+}
@@ -2,22 +2,131 @@
 
 #include "MHex.h"
 
+FMHexModifier::FMHexModifier()
+	: Stat(EMHexStat::RunSpeed)
+	, Add(0.0f)
+	, Multiply(1.0f)
+{
+}
+
+FMHexStats::FMHexStats()
+{
+	Values[(int32)EMHexStat::RunSpeed] = 3.0f;
+	Values[(int32)EMHexStat::AimSpeed] = 0.5f;
+	Values[(int32)EMHexStat::Spread] = 1.0f;
+	Values[(int32)EMHexStat::Stability] = 10.0f;
+}
+
+void FMHexStatArray::Write(const FMHexStats& Stats)
+{
+	if (Items.Num() != (int32)EMHexStat::Count)
+	{
+		Items.SetNum((int32)EMHexStat::Count);
+		for (int32 i = 0; i < Items.Num(); i++)
+		{
+			Items[i].Stat = (EMHexStat)i;
+			Items[i].Value = Stats.Values[i];
+			MarkItemDirty(Items[i]);
+		}
+		return;
+	}
+
+	for (FMHexStatItem& Item : Items)
+	{
+		const float Value = Stats.Get(Item.Stat);
+		if (Item.Value != Value)
+		{
+			Item.Value = Value;
+			MarkItemDirty(Item);
+		}
+	}
+}
+
+void FMHexStatArray::Read(FMHexStats& OutStats) const
+{
+	for (const FMHexStatItem& Item : Items)
+	{
+		if (Item.Stat < EMHexStat::Count)
+		{
+			OutStats.Values[(int32)Item.Stat] = Item.Value;
+		}
+	}
+}
+
 FMHex::FMHex()
-	: Stability(10.0f)
 {
 }
 
 bool FMHex::IsFunctional() const
 {
-	return Stability >= 0.0f;
+	return Stats.Get(EMHexStat::Stability) >= 0.0f;
 }
 
 float FMHex::GetAimingSpeed() const
 {
-	return 0.5f;
+	return Stats.Get(EMHexStat::AimSpeed);
 }
 
 float FMHex::GetRunningSpeed() const
 {
-	return 3.0f;
+	return Stats.Get(EMHexStat::RunSpeed);
+}
+
+float FMHex::GetSpreadModifier() const
+{
+	return Stats.Get(EMHexStat::Spread);
+}
+
+void FMHex::EquipModule(const FMHexModule& Module)
+{
+	Modules.Add(Module);
+	Recompute();
+}
+
+bool FMHex::UnequipModule(FName Name)
+{
+	const int32 Index = Modules.IndexOfByPredicate([Name](const FMHexModule& Module)
+	{
+		return Module.Name == Name;
+	});
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	Modules.RemoveAt(Index);
+	Recompute();
+	return true;
+}
+
+void FMHex::SetReplicatedStats(const FMHexStatArray& StatArray)
+{
+	StatArray.Read(Stats);
+}
+
+void FMHex::Recompute()
+{
+	float Add[(int32)EMHexStat::Count] = {};
+	float Multiply[(int32)EMHexStat::Count];
+	for (float& Value : Multiply)
+	{
+		Value = 1.0f;
+	}
+
+	for (const FMHexModule& Module : Modules)
+	{
+		for (const FMHexModifier& Modifier : Module.Modifiers)
+		{
+			if (Modifier.Stat < EMHexStat::Count)
+			{
+				Add[(int32)Modifier.Stat] += Modifier.Add;
+				Multiply[(int32)Modifier.Stat] *= Modifier.Multiply;
+			}
+		}
+	}
+
+	for (int32 i = 0; i < (int32)EMHexStat::Count; i++)
+	{
+		Stats.Values[i] = (BaseStats.Values[i] + Add[i]) * Multiply[i];
+	}
 }
@@ -0,0 +1,96 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MVectorMath.h"
+#include "Perplex.h"
+#include "HAL/IConsoleManager.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace
+{
+	const int32 DefaultBenchmarkIterations = 1000000;
+
+	/** Scalar versions replaced by the kernels, kept as reference. Frames went through a rotator before. */
+	FORCEINLINE FVector ScalarAxisX(const FQuat& Quat)
+	{
+		const FVector QuatVector(Quat.X, Quat.Y, Quat.Z);
+		return FVector(FMath::Square(Quat.W) - QuatVector.SizeSquared(), Quat.Z * Quat.W * 2.0f, Quat.Y * Quat.W * -2.0f) + QuatVector * (Quat.X * 2.0f);
+	}
+
+	FORCEINLINE FVector ScalarAxisZ(const FQuat& Quat)
+	{
+		const FVector QuatVector(Quat.X, Quat.Y, Quat.Z);
+		return FVector(Quat.Y * Quat.W * 2.0f, Quat.X * Quat.W * -2.0f, FMath::Square(Quat.W) - QuatVector.SizeSquared()) + QuatVector * (Quat.Z * 2.0f);
+	}
+
+	FORCEINLINE FQuat ScalarQuatFromZX(const FVector& Z, const FVector& X)
+	{
+		return FRotationMatrix::MakeFromZX(Z, X).Rotator().Quaternion();
+	}
+
+	/** Run a kernel and return nanoseconds per call */
+	template<typename FunctionType>
+	double Measure(int32 Iterations, FunctionType&& Function)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < Iterations; i++)
+		{
+			Function(i);
+		}
+		return (FPlatformTime::Seconds() - StartTime) * 1.0e9 / Iterations;
+	}
+
+	void RunBenchmark(const TArray<FString>& Args)
+	{
+		const int32 Iterations = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : DefaultBenchmarkIterations;
+
+		// Random inputs, sized to stay in cache so memory doesn't dominate
+		const int32 NumInputs = 1024;
+		FRandomStream Random(0x5EED);
+		TArray<FQuat> Quats;
+		TArray<FVector> Vectors;
+		for (int32 i = 0; i < NumInputs; i++)
+		{
+			Quats.Add(FQuat(Random.GetUnitVector(), Random.FRandRange(-PI, PI)));
+			Vectors.Add(Random.GetUnitVector() * Random.FRandRange(1.0f, 1000.0f));
+		}
+
+		FVector VectorSink = FVector::ZeroVector;
+		FQuat QuatSink = FQuat::Identity;
+
+		const double ScalarAxes = Measure(Iterations, [&](int32 i) { VectorSink += ScalarAxisX(Quats[i & (NumInputs - 1)]) + ScalarAxisZ(Quats[i & (NumInputs - 1)]); });
+		const double VectorAxes = Measure(Iterations, [&](int32 i) { VectorSink += MVectorMath::GetAxisX(Quats[i & (NumInputs - 1)]) + MVectorMath::GetAxisZ(Quats[i & (NumInputs - 1)]); });
+
+		const double ScalarDirection = Measure(Iterations, [&](int32 i) { VectorSink += (Vectors[i & (NumInputs - 1)] - Vectors[(i + 1) & (NumInputs - 1)]).GetSafeNormal(); });
+		const double VectorDirection = Measure(Iterations, [&](int32 i) { VectorSink += MVectorMath::GetSafeDirection(Vectors[(i + 1) & (NumInputs - 1)], Vectors[i & (NumInputs - 1)]); });
+
+		const double ScalarFrame = Measure(Iterations, [&](int32 i) { QuatSink *= ScalarQuatFromZX(Vectors[i & (NumInputs - 1)], Vectors[(i + 1) & (NumInputs - 1)]); });
+		const double VectorFrame = Measure(Iterations, [&](int32 i) { QuatSink *= MVectorMath::MakeQuatFromZX(Vectors[i & (NumInputs - 1)], Vectors[(i + 1) & (NumInputs - 1)]); });
+
+		// Largest deviation from the scalar versions
+		float MaxAxisError = 0.0f;
+		float MaxFrameError = 0.0f;
+		for (int32 i = 0; i < NumInputs; i++)
+		{
+			MaxAxisError = FMath::Max(MaxAxisError, (ScalarAxisX(Quats[i]) - MVectorMath::GetAxisX(Quats[i])).GetAbsMax());
+			MaxAxisError = FMath::Max(MaxAxisError, (ScalarAxisZ(Quats[i]) - MVectorMath::GetAxisZ(Quats[i])).GetAbsMax());
+
+			const FQuat ScalarQuat = ScalarQuatFromZX(Vectors[i], Vectors[(i + 1) & (NumInputs - 1)]);
+			const FQuat VectorQuat = MVectorMath::MakeQuatFromZX(Vectors[i], Vectors[(i + 1) & (NumInputs - 1)]);
+			MaxFrameError = FMath::Max(MaxFrameError, (float)ScalarQuat.AngularDistance(VectorQuat));
+		}
+
+		UE_LOG(LogPerplexMovement, Log, TEXT("Vector math benchmark, %d iterations (ns per call, scalar / vector):"), Iterations);
+		UE_LOG(LogPerplexMovement, Log, TEXT("  Capsule axes X and Z: %.2f / %.2f (%.2fx), max error %g"), ScalarAxes, VectorAxes, ScalarAxes / VectorAxes, MaxAxisError);
+		UE_LOG(LogPerplexMovement, Log, TEXT("  Gravity direction: %.2f / %.2f (%.2fx)"), ScalarDirection, VectorDirection, ScalarDirection / VectorDirection);
+		UE_LOG(LogPerplexMovement, Log, TEXT("  Frame from Z and X: %.2f / %.2f (%.2fx), max error %g rad"), ScalarFrame, VectorFrame, ScalarFrame / VectorFrame, MaxFrameError);
+		UE_LOG(LogPerplexMovement, Verbose, TEXT("  Sink %s %s"), *VectorSink.ToString(), *QuatSink.ToString());
+	}
+}
+
+static FAutoConsoleCommand BenchVectorMathCommand(
+	TEXT("Perplex.BenchVectorMath"),
+	TEXT("Compares scalar and vectorized capsule frame and gravity math. Optional argument is the number of iterations."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&RunBenchmark));
+
+#endif // !UE_BUILD_SHIPPING
@@ -0,0 +1,518 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MNetBandwidthProfiler.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/CoreNet.h"
+#include "UObject/UnrealType.h"
+#include "GameModes/MJointGameMode.h"
+
+namespace
+{
+	/** Hard cap on recorded samples, oldest are dropped past it */
+	const int32 MaxSamples = 500000;
+
+	/** Seconds of samples between pruning states of destroyed actors */
+	const float PruneInterval = 10.0f;
+
+	const FName ActorPropertiesName(TEXT("(Actor)"));
+	const FName ComponentPropertiesName(TEXT("(Components)"));
+
+	const TCHAR* KindNames[] = { TEXT("Property"), TEXT("RPC") };
+
+	const TCHAR* MeasureNames[] = { TEXT("Wire"), TEXT("Payload"), TEXT("Estimate") };
+}
+
+FMNetBandwidthProfiler::FMNetBandwidthProfiler()
+	: SampleInterval(1.0f)
+	, bEnabled(false)
+{
+	Reset();
+}
+
+FMNetBandwidthProfiler* FMNetBandwidthProfiler::Find(const UWorld* World)
+{
+	AMJointGameMode* GameMode = World ? World->GetAuthGameMode<AMJointGameMode>() : nullptr;
+	if (GameMode && GameMode->GetNetBandwidthProfiler().bEnabled)
+	{
+		return &GameMode->GetNetBandwidthProfiler();
+	}
+
+	return nullptr;
+}
+
+void FMNetBandwidthProfiler::Reset()
+{
+	Entries.Reset();
+	EntryIndices.Reset();
+	Samples.Reset();
+	FirstSample = 0;
+	ActorStates.Reset();
+	NetProperties.Reset();
+	ConnectionNames.Reset();
+	IntervalTime = 0.0f;
+	Duration = 0.0f;
+}
+
+void FMNetBandwidthProfiler::Tick(UWorld* World, float DeltaSeconds)
+{
+	if (!bEnabled || !World)
+	{
+		return;
+	}
+
+	IntervalTime += DeltaSeconds;
+	if (IntervalTime < SampleInterval)
+	{
+		return;
+	}
+
+	const float Time = World->GetTimeSeconds();
+	for (int32 i = 0; i < Entries.Num(); i++)
+	{
+		FEntry& Entry = Entries[i];
+		if (Entry.IntervalCount == 0)
+		{
+			continue;
+		}
+
+		FMNetBandwidthSample Sample;
+		Sample.Time = Time;
+		Sample.Entry = i;
+		Sample.BitsPerSecond = Entry.IntervalBits / IntervalTime;
+		Sample.CountPerSecond = Entry.IntervalCount / IntervalTime;
+
+		if (Samples.Num() < MaxSamples)
+		{
+			Samples.Add(Sample);
+		}
+		else
+		{
+			if (FirstSample == 0)
+			{
+				UE_LOG(LogPerplexNet, Warning, TEXT("Net bandwidth profiler is full, oldest samples are overwritten."));
+			}
+			Samples[FirstSample] = Sample;
+			FirstSample = (FirstSample + 1) % MaxSamples;
+		}
+
+		Entry.IntervalBits = 0;
+		Entry.IntervalCount = 0;
+	}
+
+	// Destroyed actors and closed connections take their states with them
+	if (FMath::FloorToInt((Duration + IntervalTime) / PruneInterval) != FMath::FloorToInt(Duration / PruneInterval))
+	{
+		for (auto It = ActorStates.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().ResolveObjectPtr())
+			{
+				It.RemoveCurrent();
+				continue;
+			}
+
+			for (auto SentIt = It.Value().SentHashes.CreateIterator(); SentIt; ++SentIt)
+			{
+				if (!SentIt.Key().IsValid())
+				{
+					SentIt.RemoveCurrent();
+				}
+			}
+		}
+	}
+
+	Duration += IntervalTime;
+	IntervalTime = 0.0f;
+}
+
+void FMNetBandwidthProfiler::RecordReplicatedProperties(const AActor* Actor, UNetConnection* Connection, const FReplicationFlags& RepFlags, int64 ActorBits, int64 ComponentBits)
+{
+	if (!bEnabled || !Actor || !Connection)
+	{
+		return;
+	}
+
+	if (ComponentBits > 0)
+	{
+		Record(Connection, Actor, ComponentPropertiesName, EMNetBandwidthKind::Property, EDirection::Sent, EMNetBandwidthMeasure::Wire, ComponentBits);
+	}
+
+	if (ActorBits <= 0)
+	{
+		return;
+	}
+	Record(Connection, Actor, ActorPropertiesName, EMNetBandwidthKind::Property, EDirection::Sent, EMNetBandwidthMeasure::Wire, ActorBits);
+
+	const TArray<FNetProperty>& Properties = GetNetProperties(Actor->GetClass());
+	FActorState& State = ActorStates.FindOrAdd(FObjectKey(Actor));
+	if (State.Frame != GFrameCounter || State.Hashes.Num() != Properties.Num())
+	{
+		State.Frame = GFrameCounter;
+		HashProperties(Actor, Properties, State.Hashes);
+	}
+
+	// Properties that differ from what the connection last got, new connections start from class defaults.
+	// Properties skipped by their condition keep their old hash, so they count once the condition is met.
+	TArray<uint32>& SentHashes = State.SentHashes.FindOrAdd(Connection);
+	if (SentHashes.Num() != Properties.Num())
+	{
+		HashProperties(Actor->GetClass()->GetDefaultObject(), Properties, SentHashes);
+	}
+
+	FNetBitWriter Writer(Connection->PackageMap, 0);
+	for (int32 i = 0; i < Properties.Num(); i++)
+	{
+		const FNetProperty& NetProperty = Properties[i];
+		if (SentHashes[i] == State.Hashes[i] || !IsConditionMet(NetProperty.Condition, RepFlags))
+		{
+			continue;
+		}
+		SentHashes[i] = State.Hashes[i];
+
+		Writer.Reset();
+		bool bExact = true;
+		for (int32 Index = 0; Index < NetProperty.Property->ArrayDim; Index++)
+		{
+			bExact &= SerializeValue(NetProperty.Property, NetProperty.Property->ContainerPtrToValuePtr<void>(const_cast<AActor*>(Actor), Index), Writer);
+		}
+		Record(Connection, Actor, NetProperty.Property->GetFName(), EMNetBandwidthKind::Property, EDirection::Sent, bExact ? EMNetBandwidthMeasure::Payload : EMNetBandwidthMeasure::Estimate, Writer.GetNumBits());
+	}
+}
+
+void FMNetBandwidthProfiler::RecordReceivedRPC(const UObject* Object, const UFunction* Function, void* Parameters, UNetConnection* Connection)
+{
+	if (!bEnabled || !Object || !Function || !Connection)
+	{
+		return;
+	}
+
+	// Same layout as RPC parameters are sent with, parameters other than bools are prefixed by a bit telling if they differ from default
+	FNetBitWriter Writer(Connection->PackageMap, 0);
+	bool bExact = true;
+	for (TFieldIterator<UProperty> It(Function); It && (It->PropertyFlags & CPF_Parm); ++It)
+	{
+		if (It->PropertyFlags & CPF_ReturnParm)
+		{
+			continue;
+		}
+
+		for (int32 Index = 0; Index < It->ArrayDim; Index++)
+		{
+			bool bSend = true;
+			if (!It->IsA<UBoolProperty>())
+			{
+				bSend = !It->Identical_InContainer(Parameters, nullptr, Index);
+				Writer.WriteBit(bSend ? 1 : 0);
+			}
+			if (bSend)
+			{
+				bExact &= SerializeValue(*It, It->ContainerPtrToValuePtr<void>(Parameters, Index), Writer);
+			}
+		}
+	}
+
+	Record(Connection, Object, Function->GetFName(), EMNetBandwidthKind::RPC, EDirection::Received, bExact ? EMNetBandwidthMeasure::Payload : EMNetBandwidthMeasure::Estimate, Writer.GetNumBits());
+}
+
+void FMNetBandwidthProfiler::Record(UNetConnection* Connection, const UObject* Object, FName Name, EMNetBandwidthKind Kind, EDirection Direction, EMNetBandwidthMeasure Measure, int64 Bits)
+{
+	FString* ConnectionName = ConnectionNames.Find(Connection);
+	if (!ConnectionName)
+	{
+		ConnectionName = &ConnectionNames.Add(Connection, Connection->LowLevelGetRemoteAddress(true));
+	}
+
+	FEntryKey Key;
+	Key.Connection = *ConnectionName;
+	Key.Class = Object->GetClass()->GetFName();
+	Key.Name = Name;
+	Key.Kind = Kind;
+	Key.Direction = Direction;
+
+	int32* Index = EntryIndices.Find(Key);
+	if (!Index)
+	{
+		Index = &EntryIndices.Add(Key, Entries.Num());
+
+		FEntry& NewEntry = Entries[Entries.AddZeroed()];
+		NewEntry.Key = Key;
+	}
+
+	FEntry& Entry = Entries[*Index];
+	Entry.Measure = FMath::Max(Entry.Measure, Measure);
+	Entry.IntervalBits += Bits;
+	Entry.IntervalCount++;
+	Entry.TotalBits += Bits;
+	Entry.TotalCount++;
+}
+
+const TArray<FMNetBandwidthProfiler::FNetProperty>& FMNetBandwidthProfiler::GetNetProperties(const UClass* Class)
+{
+	TArray<FNetProperty>* Properties = NetProperties.Find(Class);
+	if (!Properties)
+	{
+		Properties = &NetProperties.Add(Class);
+
+		TArray<FLifetimeProperty> LifetimeProperties;
+		Class->GetDefaultObject()->GetLifetimeReplicatedProps(LifetimeProperties);
+
+		for (TFieldIterator<UProperty> It(Class); It; ++It)
+		{
+			if (It->PropertyFlags & CPF_Net)
+			{
+				FNetProperty NetProperty;
+				NetProperty.Property = *It;
+				NetProperty.Condition = COND_None;
+				for (const FLifetimeProperty& LifetimeProperty : LifetimeProperties)
+				{
+					if (LifetimeProperty.RepIndex == It->RepIndex)
+					{
+						NetProperty.Condition = LifetimeProperty.Condition;
+						break;
+					}
+				}
+				Properties->Add(NetProperty);
+			}
+		}
+	}
+
+	return *Properties;
+}
+
+void FMNetBandwidthProfiler::HashProperties(const UObject* Object, const TArray<FNetProperty>& Properties, TArray<uint32>& OutHashes)
+{
+	OutHashes.SetNumUninitialized(Properties.Num());
+
+	FString Text;
+	for (int32 i = 0; i < Properties.Num(); i++)
+	{
+		const UProperty* Property = Properties[i].Property;
+		uint32 Hash = 0;
+		for (int32 Index = 0; Index < Property->ArrayDim; Index++)
+		{
+			Text.Reset();
+			Property->ExportTextItem(Text, Property->ContainerPtrToValuePtr<void>(Object, Index), nullptr, const_cast<UObject*>(Object), PPF_None);
+			Hash = FCrc::StrCrc32(*Text, Hash);
+		}
+		OutHashes[i] = Hash;
+	}
+}
+
+int64 FMNetBandwidthProfiler::GetConnectionOutBits(const UNetConnection* Connection)
+{
+	return (int64)Connection->OutBytes * 8 + Connection->SendBuffer.GetNumBits();
+}
+
+bool FMNetBandwidthProfiler::IsConditionMet(uint8 Condition, const FReplicationFlags& RepFlags)
+{
+	// Same as the condition map of replication states
+	const bool bInitial = RepFlags.bNetInitial;
+	const bool bOwner = RepFlags.bNetOwner;
+	const bool bSimulated = RepFlags.bNetSimulated;
+	const bool bPhysics = RepFlags.bRepPhysics;
+	const bool bReplay = RepFlags.bReplay;
+
+	switch ((ELifetimeCondition)Condition)
+	{
+	case COND_InitialOnly:
+		return bInitial;
+	case COND_OwnerOnly:
+		return bOwner;
+	case COND_SkipOwner:
+		return !bOwner;
+	case COND_SimulatedOnly:
+		return bSimulated;
+	case COND_SimulatedOnlyNoReplay:
+		return bSimulated && !bReplay;
+	case COND_AutonomousOnly:
+		return !bSimulated;
+	case COND_SimulatedOrPhysics:
+		return bSimulated || bPhysics;
+	case COND_SimulatedOrPhysicsNoReplay:
+		return (bSimulated || bPhysics) && !bReplay;
+	case COND_InitialOrOwner:
+		return bInitial || bOwner;
+	case COND_ReplayOrOwner:
+		return bReplay || bOwner;
+	case COND_ReplayOnly:
+		return bReplay;
+	case COND_SkipReplay:
+		return !bReplay;
+	default:
+		// Custom conditions can't be seen from here and are counted as active
+		return true;
+	}
+}
+
+bool FMNetBandwidthProfiler::SerializeValue(const UProperty* Property, void* Value, FNetBitWriter& Writer)
+{
+	const UStructProperty* StructProperty = Cast<UStructProperty>(Property);
+	if (StructProperty && !(StructProperty->Struct->StructFlags & STRUCT_NetSerializeNative))
+	{
+		// Replication sends changed members of structs without a net serializer
+		for (TFieldIterator<UProperty> It(StructProperty->Struct); It; ++It)
+		{
+			if (!(It->PropertyFlags & CPF_RepSkip))
+			{
+				for (int32 Index = 0; Index < It->ArrayDim; Index++)
+				{
+					SerializeValue(*It, It->ContainerPtrToValuePtr<void>(Value, Index), Writer);
+				}
+			}
+		}
+		return false;
+	}
+
+	const UArrayProperty* ArrayProperty = Cast<UArrayProperty>(Property);
+	if (ArrayProperty)
+	{
+		// Replication sends the count and changed elements
+		FScriptArrayHelper ArrayHelper(ArrayProperty, Value);
+		uint16 Num = ArrayHelper.Num();
+		Writer << Num;
+		for (int32 i = 0; i < ArrayHelper.Num(); i++)
+		{
+			SerializeValue(ArrayProperty->Inner, ArrayHelper.GetRawPtr(i), Writer);
+		}
+		return false;
+	}
+
+	Property->NetSerializeItem(Writer, Writer.PackageMap, Value);
+	return true;
+}
+
+void FMNetBandwidthProfiler::DumpSummary() const
+{
+	struct FTotal
+	{
+		FName Class;
+		FName Name;
+		EMNetBandwidthKind Kind;
+		EDirection Direction;
+		EMNetBandwidthMeasure Measure;
+		int64 Bits;
+		int32 Count;
+		TSet<FString> Connections;
+	};
+
+	// Entries summed over connections
+	TMap<FString, FTotal> Totals;
+	for (const FEntry& Entry : Entries)
+	{
+		const FString TotalKey = FString::Printf(TEXT("%s.%s.%d.%d"), *Entry.Key.Class.ToString(), *Entry.Key.Name.ToString(), (int32)Entry.Key.Kind, (int32)Entry.Key.Direction);
+		FTotal* Total = Totals.Find(TotalKey);
+		if (!Total)
+		{
+			Total = &Totals.Add(TotalKey);
+			Total->Class = Entry.Key.Class;
+			Total->Name = Entry.Key.Name;
+			Total->Kind = Entry.Key.Kind;
+			Total->Direction = Entry.Key.Direction;
+			Total->Measure = Entry.Measure;
+			Total->Bits = 0;
+			Total->Count = 0;
+		}
+
+		Total->Measure = FMath::Max(Total->Measure, Entry.Measure);
+		Total->Bits += Entry.TotalBits;
+		Total->Count += Entry.TotalCount;
+		Total->Connections.Add(Entry.Key.Connection);
+	}
+
+	Totals.ValueSort([](const FTotal& A, const FTotal& B)
+	{
+		return A.Bits / (float)A.Connections.Num() > B.Bits / (float)B.Connections.Num();
+	});
+
+	const float Seconds = FMath::Max(Duration + IntervalTime, KINDA_SMALL_NUMBER);
+	UE_LOG(LogPerplexNet, Log, TEXT("Net bandwidth profile, %.1f seconds, per connection per second, ~ marks estimates:"), Seconds);
+	for (const auto& Pair : Totals)
+	{
+		const FTotal& Total = Pair.Value;
+		const float NumConnections = Total.Connections.Num();
+		UE_LOG(LogPerplexNet, Log, TEXT(" %s%8.0f bits %6.1f calls  %s %-8s %s::%s"),
+			Total.Measure == EMNetBandwidthMeasure::Estimate ? TEXT("~") : TEXT(" "),
+			Total.Bits / NumConnections / Seconds,
+			Total.Count / NumConnections / Seconds,
+			Total.Direction == EDirection::Sent ? TEXT("sent") : TEXT("recv"),
+			KindNames[(int32)Total.Kind],
+			*Total.Class.ToString(),
+			*Total.Name.ToString());
+	}
+}
+
+bool FMNetBandwidthProfiler::WriteCsv(const FString& Filename) const
+{
+	// Measure tells if BitsPerSecond was measured on the wire, serialized, or is an estimate
+	FString Csv = TEXT("Time,Connection,Class,Name,Kind,Direction,Measure,BitsPerSecond,CountPerSecond\n");
+	for (int32 i = 0; i < Samples.Num(); i++)
+	{
+		const FMNetBandwidthSample& Sample = Samples[(FirstSample + i) % Samples.Num()];
+		const FEntry& Entry = Entries[Sample.Entry];
+		const FEntryKey& Key = Entry.Key;
+		Csv += FString::Printf(TEXT("%.2f,%s,%s,%s,%s,%s,%s,%.1f,%.2f\n"),
+			Sample.Time,
+			*Key.Connection,
+			*Key.Class.ToString(),
+			*Key.Name.ToString(),
+			KindNames[(int32)Key.Kind],
+			Key.Direction == EDirection::Sent ? TEXT("Sent") : TEXT("Received"),
+			MeasureNames[(int32)Entry.Measure],
+			Sample.BitsPerSecond,
+			Sample.CountPerSecond);
+	}
+
+	return FFileHelper::SaveStringToFile(Csv, *Filename);
+}
+
+FString FMNetBandwidthProfiler::GetDefaultCsvFilename()
+{
+	return FPaths::ProfilingDir() / TEXT("Perplex") / FString::Printf(TEXT("NetBandwidth-%s.csv"), *FDateTime::Now().ToString());
+}
+
+FMNetBandwidthProfiler::FScopedSentRPC::FScopedSentRPC(const UObject* InObject, const UFunction* InFunction)
+	: Object(InObject)
+	, Function(InFunction)
+	, NetDriver(nullptr)
+{
+	const UWorld* World = Object ? Object->GetWorld() : nullptr;
+	Profiler = Find(World);
+	if (!Profiler)
+	{
+		return;
+	}
+
+	NetDriver = World->GetNetDriver();
+	if (NetDriver)
+	{
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (Connection)
+			{
+				StartBits.Emplace(Connection, GetConnectionOutBits(Connection));
+			}
+		}
+	}
+}
+
+FMNetBandwidthProfiler::FScopedSentRPC::~FScopedSentRPC()
+{
+	if (!Profiler || !NetDriver)
+	{
+		return;
+	}
+
+	// Only connections that existed before the call are compared, sending never adds connections
+	for (const TPair<UNetConnection*, int64>& Start : StartBits)
+	{
+		const int64 Bits = GetConnectionOutBits(Start.Key) - Start.Value;
+		if (Bits > 0)
+		{
+			Profiler->Record(Start.Key, Object, Function->GetFName(), EMNetBandwidthKind::RPC, EDirection::Sent, EMNetBandwidthMeasure::Wire, Bits);
+		}
+	}
+}
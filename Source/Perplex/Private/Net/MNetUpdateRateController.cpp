@@ -0,0 +1,235 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MNetUpdateRateController.h"
+#include "Engine/World.h"
+#include "Engine/NetConnection.h"
+#include "GameFramework/PlayerController.h"
+#include "EngineUtils.h"
+#include "Characters/MCharacter.h"
+#include "Characters/MCharacterMovementComponent.h"
+
+namespace
+{
+	/** Share of the score given to activity, the rest goes to crowd */
+	const float ActivityWeight = 0.6f;
+	const float CrowdWeight = 0.25f;
+	const float BaseScore = 0.15f;
+
+	/** Score multiplier for characters far from every viewer */
+	const float FarProximityScale = 0.2f;
+
+	/** Score contribution of firing */
+	const float FiringActivity = 0.75f;
+}
+
+FMNetUpdateRateSettings::FMNetUpdateRateSettings()
+	: bEnabled(true)
+	, MinNetUpdateFrequency(5.0f)
+	, MaxNetUpdateFrequency(60.0f)
+	, EvaluationInterval(0.2f)
+	, NearViewerDistance(3000.0f)
+	, FarViewerDistance(20000.0f)
+	, CrowdViewerCount(8)
+	, SaturatingAcceleration(4000.0f)
+	, FrequencyDecayRate(20.0f)
+	, BitsPerUpdate(160)
+	, ConnectionBudgetFraction(0.5f)
+{
+}
+
+FMNetUpdateRateStats::FMNetUpdateRateStats()
+	: Score(0.0f)
+	, DesiredFrequency(0.0f)
+	, Frequency(0.0f)
+	, ViewerCount(0)
+	, NearestViewerDistance(0.0f)
+	, LastVelocity(FVector::ZeroVector)
+	, LastGravityDirection(FVector::ZeroVector)
+	, BudgetLimitedCount(0)
+{
+}
+
+FMNetUpdateRateController::FMNetUpdateRateController()
+	: TimeSinceEvaluation(0.0f)
+{
+}
+
+void FMNetUpdateRateController::Tick(UWorld* World, float DeltaSeconds, const FMNetUpdateRateSettings& Settings)
+{
+	if (!World || !Settings.bEnabled)
+	{
+		return;
+	}
+
+	TimeSinceEvaluation += DeltaSeconds;
+	if (TimeSinceEvaluation < Settings.EvaluationInterval)
+	{
+		return;
+	}
+
+	const float EvaluationTime = TimeSinceEvaluation;
+	TimeSinceEvaluation = 0.0f;
+
+	// Gather remote viewers and their budgets
+	TArray<FViewer> Viewers;
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if (!PlayerController || PlayerController->IsLocalController())
+		{
+			continue;
+		}
+
+		FViewer Viewer;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(Viewer.Location, ViewRotation);
+
+		UNetConnection* Connection = PlayerController->GetNetConnection();
+		Viewer.BudgetBits = Connection ? Connection->CurrentNetSpeed * 8.0f * Settings.ConnectionBudgetFraction : MAX_flt;
+		Viewer.RequestedBits = 0.0f;
+		Viewers.Add(Viewer);
+	}
+
+	const float NearDistanceSq = FMath::Square(Settings.NearViewerDistance);
+	const float FarDistanceSq = FMath::Square(Settings.FarViewerDistance);
+
+	// Score characters and accumulate requested bandwidth per viewer
+	TArray<AMCharacter*> Characters;
+	for (TActorIterator<AMCharacter> It(World); It; ++It)
+	{
+		AMCharacter* Character = *It;
+		if (Character->IsPendingKill() || Character->bTearOff || Character->GetHealth() <= 0.0f)
+		{
+			continue;
+		}
+
+		UMCharacterMovementComponent* Movement = Character->GetCustomCharacterMovementComponent();
+		if (!Movement)
+		{
+			continue;
+		}
+
+		FMNetUpdateRateStats& CharacterStats = Stats.FindOrAdd(Character);
+
+		const FVector Velocity = Character->GetVelocity();
+		const FVector GravityDirection = Movement->GetGravityDirection();
+		const float Acceleration = (Velocity - CharacterStats.LastVelocity).Size() / EvaluationTime;
+		const float GravityChange = CharacterStats.LastGravityDirection.IsZero() ? 0.0f : 1.0f - (GravityDirection | CharacterStats.LastGravityDirection);
+		CharacterStats.LastVelocity = Velocity;
+		CharacterStats.LastGravityDirection = GravityDirection;
+
+		float Activity = Acceleration / Settings.SaturatingAcceleration + GravityChange;
+		if (Character->IsFiring())
+		{
+			Activity += FiringActivity;
+		}
+		Activity = FMath::Min(Activity, 1.0f);
+
+		const FVector Location = Character->GetActorLocation();
+		float NearestDistanceSq = MAX_flt;
+		int32 ViewerCount = 0;
+		for (const FViewer& Viewer : Viewers)
+		{
+			const float DistanceSq = FVector::DistSquared(Viewer.Location, Location);
+			NearestDistanceSq = FMath::Min(NearestDistanceSq, DistanceSq);
+			if (DistanceSq < NearDistanceSq)
+			{
+				ViewerCount++;
+			}
+		}
+
+		const float NearestDistance = NearestDistanceSq < MAX_flt ? FMath::Sqrt(NearestDistanceSq) : Settings.FarViewerDistance;
+		const float Proximity = 1.0f - FMath::Clamp((NearestDistance - Settings.NearViewerDistance) / FMath::Max(Settings.FarViewerDistance - Settings.NearViewerDistance, 1.0f), 0.0f, 1.0f);
+		const float Crowd = FMath::Min((float)ViewerCount / Settings.CrowdViewerCount, 1.0f);
+
+		CharacterStats.Score = FMath::Clamp(BaseScore + ActivityWeight * Activity + CrowdWeight * Crowd, 0.0f, 1.0f) * FMath::Lerp(FarProximityScale, 1.0f, Proximity);
+		CharacterStats.DesiredFrequency = FMath::Lerp(Settings.MinNetUpdateFrequency, Settings.MaxNetUpdateFrequency, CharacterStats.Score);
+		CharacterStats.ViewerCount = ViewerCount;
+		CharacterStats.NearestViewerDistance = NearestDistance;
+
+		const float RequestedBits = CharacterStats.DesiredFrequency * Settings.BitsPerUpdate;
+		for (FViewer& Viewer : Viewers)
+		{
+			if (FVector::DistSquared(Viewer.Location, Location) < FarDistanceSq)
+			{
+				Viewer.RequestedBits += RequestedBits;
+			}
+		}
+
+		Characters.Add(Character);
+	}
+
+	// Scale rates to fit the most constrained connection that receives the character
+	for (AMCharacter* Character : Characters)
+	{
+		FMNetUpdateRateStats& CharacterStats = Stats.FindChecked(Character);
+		const FVector Location = Character->GetActorLocation();
+
+		float BudgetScale = 1.0f;
+		for (const FViewer& Viewer : Viewers)
+		{
+			if (Viewer.RequestedBits > Viewer.BudgetBits && FVector::DistSquared(Viewer.Location, Location) < FarDistanceSq)
+			{
+				BudgetScale = FMath::Min(BudgetScale, Viewer.BudgetBits / Viewer.RequestedBits);
+			}
+		}
+
+		float TargetFrequency = CharacterStats.DesiredFrequency;
+		if (BudgetScale < 1.0f)
+		{
+			TargetFrequency = FMath::Max(TargetFrequency * BudgetScale, Settings.MinNetUpdateFrequency);
+			CharacterStats.BudgetLimitedCount++;
+		}
+
+		// Raise immediately so bursts of activity replicate right away, decay slowly
+		const bool bRaised = TargetFrequency > CharacterStats.Frequency;
+		CharacterStats.Frequency = bRaised ? TargetFrequency : FMath::Max(TargetFrequency, CharacterStats.Frequency - Settings.FrequencyDecayRate * EvaluationTime);
+
+		const float OldFrequency = Character->NetUpdateFrequency;
+		Character->NetUpdateFrequency = CharacterStats.Frequency;
+		if (bRaised && CharacterStats.Frequency > OldFrequency * 2.0f)
+		{
+			Character->ForceNetUpdate();
+		}
+	}
+
+	// Forget destroyed characters
+	for (auto It = Stats.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FMNetUpdateRateController::RemoveCharacter(AMCharacter* Character)
+{
+	if (Character && Stats.Remove(Character) > 0)
+	{
+		Character->NetUpdateFrequency = Character->GetClass()->GetDefaultObject<AMCharacter>()->NetUpdateFrequency;
+	}
+}
+
+const FMNetUpdateRateStats* FMNetUpdateRateController::GetStats(const AMCharacter* Character) const
+{
+	return Stats.Find(const_cast<AMCharacter*>(Character));
+}
+
+void FMNetUpdateRateController::DumpStats() const
+{
+	UE_LOG(LogPerplexNet, Log, TEXT("Adaptive net update rates for %d characters:"), Stats.Num());
+	for (auto It = Stats.CreateConstIterator(); It; ++It)
+	{
+		const AMCharacter* Character = It.Key().Get();
+		const FMNetUpdateRateStats& CharacterStats = It.Value();
+		UE_LOG(LogPerplexNet, Log, TEXT("  %s: %.1f Hz (desired %.1f, score %.2f, viewers %d, nearest %.0f, budget limited %d)"),
+			Character ? *Character->GetName() : TEXT("None"),
+			CharacterStats.Frequency,
+			CharacterStats.DesiredFrequency,
+			CharacterStats.Score,
+			CharacterStats.ViewerCount,
+			CharacterStats.NearestViewerDistance,
+			CharacterStats.BudgetLimitedCount);
+	}
+}
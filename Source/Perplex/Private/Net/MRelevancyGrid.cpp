@@ -0,0 +1,215 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MRelevancyGrid.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetDriver.h"
+#include "GameFramework/WorldSettings.h"
+#include "Characters/MCharacter.h"
+#include "World/MGravityWell.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Occluded Relevancy Pairs"), STAT_OccludedRelevancyPairs, STATGROUP_Game);
+
+FMRelevancyGridSettings::FMRelevancyGridSettings()
+	: bEnabled(true)
+	, OpenSpaceCellSize(20000.0f)
+	, CrossSpaceRelevancyDistance(5000.0f)
+	, bOcclusionCulling(true)
+	, OcclusionRadiusScale(0.95f)
+	, OcclusionHysteresis(500.0f)
+{
+}
+
+FMRelevancyGrid::FMRelevancyGrid()
+	: NumOccludedPairs(0)
+{
+	Settings.bEnabled = false;
+}
+
+void FMRelevancyGrid::Rebuild(UWorld* World, const FMRelevancyGridSettings& InSettings)
+{
+	Settings = InSettings;
+	Wells.Reset();
+	Viewers.Reset();
+	Targets.Reset();
+	NumOccludedPairs = 0;
+
+	// Pairs not tested again, e.g. after either actor is gone or moved out of view, are forgotten
+	Swap(OccludedPairs, PreviousOccludedPairs);
+	OccludedPairs.Reset();
+
+	UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+	if (!NetDriver || !Settings.bEnabled)
+	{
+		PreviousOccludedPairs.Reset();
+		SET_DWORD_STAT(STAT_OccludedRelevancyPairs, 0);
+		return;
+	}
+
+	for (TActorIterator<AMGravityWell> It(World); It; ++It)
+	{
+		const AMGravityWell* GravityWell = *It;
+
+		FWell Well;
+		Well.Center = GravityWell->GetActorLocation();
+		Well.RadiusSquared = FMath::Square(GravityWell->GetInfluenceRadius());
+		Well.CellSize = GravityWell->GetRelevancyCellSize();
+		Well.OccluderRadius = Settings.bOcclusionCulling ? GravityWell->GetSurfaceRadius() * Settings.OcclusionRadiusScale : 0.0f;
+		Wells.Add(Well);
+	}
+
+	Wells.Sort([](const FWell& A, const FWell& B)
+	{
+		return A.RadiusSquared < B.RadiusSquared;
+	});
+
+	// Cells of characters are found once, not once per connection
+	TArray<const AActor*, TInlineAllocator<128>> TargetActors;
+	TArray<FVector, TInlineAllocator<128>> TargetLocations;
+	TArray<FCell, TInlineAllocator<128>> TargetCells;
+	for (TActorIterator<AMCharacter> It(World); It; ++It)
+	{
+		const AMCharacter* Character = *It;
+		if (Character->IsPendingKill())
+		{
+			continue;
+		}
+
+		TargetActors.Add(Character);
+		TargetLocations.Add(Character->GetActorLocation());
+		TargetCells.Add(GetCell(TargetLocations.Last()));
+		Targets.Add(Character);
+	}
+
+	for (UNetConnection* Connection : NetDriver->ClientConnections)
+	{
+		if (!Connection || !Connection->OwningActor || !Connection->ViewTarget)
+		{
+			continue;
+		}
+
+		// Same viewer and location the net driver passes to IsNetRelevantFor
+		const FNetViewer NetViewer(Connection, 0.0f);
+		const FCell ViewCell = GetCell(NetViewer.ViewLocation);
+
+		FViewer& Viewer = Viewers.Add(NetViewer.InViewer);
+		for (int32 i = 0; i < TargetActors.Num(); i++)
+		{
+			if (AreCellsRelevant(NetViewer.ViewLocation, ViewCell, TargetLocations[i], TargetCells[i]) &&
+				!UpdateOcclusion(NetViewer.InViewer, TargetActors[i], NetViewer.ViewLocation, TargetLocations[i]))
+			{
+				Viewer.RelevantActors.Add(TargetActors[i]);
+			}
+		}
+	}
+
+	SET_DWORD_STAT(STAT_OccludedRelevancyPairs, NumOccludedPairs);
+}
+
+FMRelevancyGrid::FCell FMRelevancyGrid::GetCell(const FVector& Location) const
+{
+	FCell Cell;
+	Cell.Space = INDEX_NONE;
+
+	FVector Origin = FVector::ZeroVector;
+	float CellSize = Settings.OpenSpaceCellSize;
+	for (int32 i = 0; i < Wells.Num(); i++)
+	{
+		const FWell& Well = Wells[i];
+		if (FVector::DistSquared(Location, Well.Center) <= Well.RadiusSquared)
+		{
+			Cell.Space = i;
+			Origin = Well.Center;
+			CellSize = Well.CellSize;
+			break;
+		}
+	}
+
+	const FVector Local = (Location - Origin) / CellSize;
+	Cell.Coordinates = FIntVector(FMath::FloorToInt(Local.X), FMath::FloorToInt(Local.Y), FMath::FloorToInt(Local.Z));
+	return Cell;
+}
+
+bool FMRelevancyGrid::AreCellsRelevant(const FVector& ViewLocation, const FCell& ViewCell, const FVector& TargetLocation, const FCell& TargetCell) const
+{
+	if (ViewCell.Space != TargetCell.Space)
+	{
+		return FVector::DistSquared(ViewLocation, TargetLocation) < FMath::Square(Settings.CrossSpaceRelevancyDistance);
+	}
+
+	const FIntVector Delta = ViewCell.Coordinates - TargetCell.Coordinates;
+	return FMath::Abs(Delta.X) <= 1 && FMath::Abs(Delta.Y) <= 1 && FMath::Abs(Delta.Z) <= 1;
+}
+
+bool FMRelevancyGrid::IsRelevant(const AActor* Viewer, const AActor* Target, const FVector& ViewLocation, const FVector& TargetLocation) const
+{
+	const FViewer* ResolvedViewer = Viewers.Find(Viewer);
+	if (ResolvedViewer && Targets.Contains(Target))
+	{
+		return ResolvedViewer->RelevantActors.Contains(Target);
+	}
+
+	return AreCellsRelevant(ViewLocation, GetCell(ViewLocation), TargetLocation, GetCell(TargetLocation)) &&
+		!IsSegmentOccluded(ViewLocation, TargetLocation, Settings.OcclusionHysteresis);
+}
+
+bool FMRelevancyGrid::IsSegmentOccluded(const FVector& ViewLocation, const FVector& TargetLocation, float Hysteresis) const
+{
+	if (!Settings.bOcclusionCulling)
+	{
+		return false;
+	}
+
+	const FVector Segment = TargetLocation - ViewLocation;
+	const float SegmentSizeSquared = Segment.SizeSquared();
+	if (SegmentSizeSquared < KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	for (const FWell& Well : Wells)
+	{
+		const float Radius = Well.OccluderRadius - Hysteresis;
+		if (Radius <= 0.0f)
+		{
+			continue;
+		}
+
+		// Endpoints inside the occluder, e.g. in caves, can't be judged by a sphere
+		const float RadiusSquared = FMath::Square(Radius);
+		if (FVector::DistSquared(ViewLocation, Well.Center) <= RadiusSquared || FVector::DistSquared(TargetLocation, Well.Center) <= RadiusSquared)
+		{
+			continue;
+		}
+
+		const float Alpha = FMath::Clamp(((Well.Center - ViewLocation) | Segment) / SegmentSizeSquared, 0.0f, 1.0f);
+		if (FVector::DistSquared(ViewLocation + Segment * Alpha, Well.Center) < RadiusSquared)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool FMRelevancyGrid::UpdateOcclusion(const AActor* Viewer, const AActor* Target, const FVector& ViewLocation, const FVector& TargetLocation)
+{
+	if (!Settings.bOcclusionCulling)
+	{
+		return false;
+	}
+
+	const uint64 Key = ((uint64)Target->GetUniqueID() << 32) | (uint64)Viewer->GetUniqueID();
+	const bool bWasOccluded = PreviousOccludedPairs.Contains(Key);
+
+	// Pairs already culled stay culled until sight clears the occluder itself
+	const bool bOccluded = IsSegmentOccluded(ViewLocation, TargetLocation, bWasOccluded ? 0.0f : Settings.OcclusionHysteresis);
+	if (bOccluded)
+	{
+		OccludedPairs.Add(Key);
+		NumOccludedPairs++;
+	}
+
+	return bOccluded;
+}
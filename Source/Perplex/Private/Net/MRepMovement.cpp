@@ -0,0 +1,256 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MRepMovement.h"
+#include "Engine/EngineTypes.h"
+
+namespace
+{
+	/**
+	* Bit budgets per precision tier.
+	* Packed vectors take a 4 to 5 bit header and as many bits per component as the largest one needs,
+	* so budgets only cap the range. Velocity is sent in steps of VelocityStep / VelocityScale units.
+	*/
+	template<EMRepMovementPrecision Precision>
+	struct TMRepMovementPrecisionTraits;
+
+	template<>
+	struct TMRepMovementPrecisionTraits<EMRepMovementPrecision::Low>
+	{
+		enum
+		{
+			LocationScale = 1,
+			LocationBits = 20,
+			RelativeLocationBits = 17,
+			VelocityScale = 1,
+			VelocityStep = 4,
+			VelocityBits = 20,
+			RotationBits = 7
+		};
+	};
+
+	/** Same location and velocity range and resolution as FRepMovement, finer rotation */
+	template<>
+	struct TMRepMovementPrecisionTraits<EMRepMovementPrecision::Default>
+	{
+		enum
+		{
+			LocationScale = 1,
+			LocationBits = 20,
+			RelativeLocationBits = 17,
+			VelocityScale = 1,
+			VelocityStep = 1,
+			VelocityBits = 20,
+			RotationBits = 9
+		};
+	};
+
+	template<>
+	struct TMRepMovementPrecisionTraits<EMRepMovementPrecision::High>
+	{
+		enum
+		{
+			LocationScale = 10,
+			LocationBits = 24,
+			RelativeLocationBits = 20,
+			VelocityScale = 10,
+			VelocityStep = 1,
+			VelocityBits = 24,
+			RotationBits = 11
+		};
+	};
+
+	/** Timestamps are sent in units of TimeStampResolution and wrap after TimeStampBits */
+	const uint32 TimeStampBits = 12;
+	const uint32 TimeStampRange = 1u << TimeStampBits;
+	const float TimeStampResolution = 0.004f;
+
+	/** Largest possible magnitude of the three smallest components of a unit quaternion */
+	const float SmallestThreeRange = 0.70710678f;
+
+	/**
+	* Serializes a unit quaternion as index of the largest component and three signed quantized components.
+	* Each component is prefixed by a bit telling if it's non-zero, so rotations about a single axis cost one component.
+	*/
+	template<uint32 NumBits>
+	void SerializeQuantizedQuat(FArchive& Ar, FQuat& Quat)
+	{
+		const int32 MaxQuantized = (1 << (NumBits - 1)) - 1;
+
+		if (Ar.IsSaving())
+		{
+			const FQuat Normalized = Quat.GetNormalized();
+			const float Components[4] = { Normalized.X, Normalized.Y, Normalized.Z, Normalized.W };
+
+			uint32 LargestIndex = 0;
+			for (uint32 i = 1; i < 4; i++)
+			{
+				if (FMath::Abs(Components[i]) > FMath::Abs(Components[LargestIndex]))
+				{
+					LargestIndex = i;
+				}
+			}
+
+			// Q and -Q are the same rotation, flip so the dropped component is positive
+			const float Sign = Components[LargestIndex] < 0.0f ? -1.0f : 1.0f;
+
+			Ar.SerializeInt(LargestIndex, 4);
+			for (uint32 i = 0; i < 4; i++)
+			{
+				if (i != LargestIndex)
+				{
+					const float Alpha = FMath::Clamp(Components[i] * Sign / SmallestThreeRange, -1.0f, 1.0f);
+					const int32 Quantized = FMath::RoundToInt(Alpha * MaxQuantized);
+
+					uint8 bNonZero = Quantized != 0 ? 1 : 0;
+					Ar.SerializeBits(&bNonZero, 1);
+					if (bNonZero)
+					{
+						uint32 Biased = Quantized + MaxQuantized;
+						Ar.SerializeInt(Biased, 1u << NumBits);
+					}
+				}
+			}
+		}
+		else
+		{
+			uint32 LargestIndex = 0;
+			Ar.SerializeInt(LargestIndex, 4);
+
+			float Components[4];
+			float SumSquares = 0.0f;
+			for (uint32 i = 0; i < 4; i++)
+			{
+				if (i != LargestIndex)
+				{
+					uint8 bNonZero = 0;
+					Ar.SerializeBits(&bNonZero, 1);
+
+					uint32 Biased = MaxQuantized;
+					if (bNonZero)
+					{
+						Ar.SerializeInt(Biased, 1u << NumBits);
+					}
+					Components[i] = ((int32)Biased - MaxQuantized) / (float)MaxQuantized * SmallestThreeRange;
+					SumSquares += FMath::Square(Components[i]);
+				}
+			}
+			Components[LargestIndex] = FMath::Sqrt(FMath::Max(0.0f, 1.0f - SumSquares));
+
+			Quat = FQuat(Components[0], Components[1], Components[2], Components[3]);
+			Quat.Normalize();
+		}
+	}
+
+	template<EMRepMovementPrecision Precision>
+	bool SerializeWithPrecision(FArchive& Ar, bool bRelativeToBase, FVector& Location, FQuat& Rotation, FVector& LinearVelocity)
+	{
+		typedef TMRepMovementPrecisionTraits<Precision> Traits;
+
+		// Offsets from a base are bounded, so they get by with fewer bits
+		bool bSuccess = bRelativeToBase
+			? SerializePackedVector<Traits::LocationScale, Traits::RelativeLocationBits>(Location, Ar)
+			: SerializePackedVector<Traits::LocationScale, Traits::LocationBits>(Location, Ar);
+
+		SerializeQuantizedQuat<Traits::RotationBits>(Ar, Rotation);
+
+		// Standing characters are common, skip velocity entirely for them
+		const float VelocityQuantum = (float)Traits::VelocityStep / Traits::VelocityScale;
+		uint8 bZeroVelocity = Ar.IsSaving() ? (LinearVelocity.IsNearlyZero(VelocityQuantum) ? 1 : 0) : 0;
+		Ar.SerializeBits(&bZeroVelocity, 1);
+		if (bZeroVelocity)
+		{
+			LinearVelocity = FVector::ZeroVector;
+		}
+		else
+		{
+			FVector Steps = LinearVelocity / Traits::VelocityStep;
+			bSuccess &= SerializePackedVector<Traits::VelocityScale, Traits::VelocityBits>(Steps, Ar);
+			LinearVelocity = Steps * Traits::VelocityStep;
+		}
+
+		return bSuccess;
+	}
+}
+
+/** Relative location bits of every precision tier cover this range */
+const float FMRepMovement::MaxRelativeLocation = 50000.0f;
+
+FMRepMovement::FMRepMovement()
+	: Location(FVector::ZeroVector)
+	, Rotation(FQuat::Identity)
+	, LinearVelocity(FVector::ZeroVector)
+	, Precision(EMRepMovementPrecision::Default)
+	, bRelativeToBase(false)
+	, ServerTimeStamp(0)
+{
+}
+
+bool FMRepMovement::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// Precision is a per-class setting both ends already know, it isn't sent
+	uint8 bRelative = bRelativeToBase ? 1 : 0;
+	Ar.SerializeBits(&bRelative, 1);
+	bRelativeToBase = bRelative != 0;
+
+	uint32 TimeStamp = ServerTimeStamp;
+	Ar.SerializeInt(TimeStamp, TimeStampRange);
+	ServerTimeStamp = (uint16)TimeStamp;
+
+	switch (Precision)
+	{
+	case EMRepMovementPrecision::Low:
+		bOutSuccess = SerializeWithPrecision<EMRepMovementPrecision::Low>(Ar, bRelativeToBase, Location, Rotation, LinearVelocity);
+		break;
+	case EMRepMovementPrecision::High:
+		bOutSuccess = SerializeWithPrecision<EMRepMovementPrecision::High>(Ar, bRelativeToBase, Location, Rotation, LinearVelocity);
+		break;
+	default:
+		bOutSuccess = SerializeWithPrecision<EMRepMovementPrecision::Default>(Ar, bRelativeToBase, Location, Rotation, LinearVelocity);
+		break;
+	}
+
+	return true;
+}
+
+float FMRepMovement::GetLocationQuantum() const
+{
+	switch (Precision)
+	{
+	case EMRepMovementPrecision::Low:
+		return 1.0f / TMRepMovementPrecisionTraits<EMRepMovementPrecision::Low>::LocationScale;
+	case EMRepMovementPrecision::High:
+		return 1.0f / TMRepMovementPrecisionTraits<EMRepMovementPrecision::High>::LocationScale;
+	default:
+		return 1.0f / TMRepMovementPrecisionTraits<EMRepMovementPrecision::Default>::LocationScale;
+	}
+}
+
+void FMRepMovement::CopyTo(FRepMovement& RepMovement) const
+{
+	RepMovement.Location = Location;
+	RepMovement.Rotation = Rotation.Rotator();
+	RepMovement.LinearVelocity = LinearVelocity;
+	RepMovement.AngularVelocity = FVector::ZeroVector;
+	RepMovement.bSimulatedPhysicSleep = false;
+	RepMovement.bRepPhysics = false;
+}
+
+void FMRepMovement::MakeWorldSpace(const FVector& BaseLocation, const FQuat& BaseRotation)
+{
+	Location = BaseLocation + BaseRotation.RotateVector(Location);
+	Rotation = BaseRotation * Rotation;
+	LinearVelocity = BaseRotation.RotateVector(LinearVelocity);
+}
+
+uint16 FMRepMovement::MakeTimeStamp(float TimeSeconds)
+{
+	return (uint16)((int64)(TimeSeconds / TimeStampResolution) & (TimeStampRange - 1));
+}
+
+float FMRepMovement::GetTimeStampDelta(uint16 FromTimeStamp, uint16 ToTimeStamp)
+{
+	// Wrapped difference mapped into [-TimeStampRange / 2, TimeStampRange / 2)
+	const int32 Delta = ((int32)ToTimeStamp - (int32)FromTimeStamp) & (TimeStampRange - 1);
+	const int32 SignedDelta = Delta >= (int32)(TimeStampRange / 2) ? Delta - (int32)TimeStampRange : Delta;
+	return SignedDelta * TimeStampResolution;
+}
@@ -0,0 +1,165 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MSnapshotBuffer.h"
+#include "Net/MRepMovement.h"
+
+namespace
+{
+	/** Hard cap on buffered snapshots */
+	const int32 MaxBufferedSnapshots = 32;
+
+	/** Smoothing factors for the running estimates */
+	const float JitterSmoothing = 0.1f;
+	const float IntervalSmoothing = 0.1f;
+	const float DelaySmoothing = 0.05f;
+
+	/** Clock offset follows early packets quickly and late packets slowly */
+	const float ClockOffsetEarlySmoothing = 0.5f;
+	const float ClockOffsetLateSmoothing = 0.02f;
+
+	/** Arrival gap after which wrapped timestamps can't be compared, a bit under half of the timestamp period */
+	const double MaxArrivalGap = 8.0;
+}
+
+FMSnapshotBuffer::FMSnapshotBuffer()
+	: MinInterpolationDelay(0.05f)
+	, MaxInterpolationDelay(0.25f)
+	, JitterMultiplier(2.0f)
+	, MaxExtrapolationTime(0.25f)
+{
+	Reset();
+}
+
+void FMSnapshotBuffer::Reset()
+{
+	Snapshots.Reset();
+	LastTimeStamp = 0;
+	LastServerTime = 0.0;
+	LastLocalTime = 0.0;
+	ClockOffset = 0.0;
+	Jitter = 0.0f;
+	SnapshotInterval = 0.0f;
+	InterpolationDelay = MinInterpolationDelay;
+}
+
+void FMSnapshotBuffer::ApplyWorldOffset(const FVector& InOffset)
+{
+	for (FMMovementSnapshot& Snapshot : Snapshots)
+	{
+		Snapshot.Location += InOffset;
+	}
+}
+
+void FMSnapshotBuffer::AddSnapshot(uint16 ServerTimeStamp, double LocalTime, const FVector& Location, const FQuat& Rotation, const FVector& Velocity)
+{
+	// Unchanged movement isn't replicated, so gaps longer than the timestamp range are normal for idle characters.
+	// Property updates arrive in order, so a delta that isn't positive also means the timestamps wrapped.
+	if (Snapshots.Num() > 0 && (LocalTime - LastLocalTime > MaxArrivalGap || FMRepMovement::GetTimeStampDelta(LastTimeStamp, ServerTimeStamp) <= 0.0f))
+	{
+		Reset();
+	}
+
+	double ServerTime;
+	if (Snapshots.Num() == 0)
+	{
+		ServerTime = LastServerTime;
+		ClockOffset = LocalTime - ServerTime;
+	}
+	else
+	{
+		// Signed difference handles wrap around within MaxArrivalGap
+		const float Delta = FMRepMovement::GetTimeStampDelta(LastTimeStamp, ServerTimeStamp);
+		ServerTime = LastServerTime + Delta;
+
+		// Unchanged movement isn't replicated, so a long gap means the previous state held until recently
+		const float IntervalSample = FMath::Min(Delta, MaxInterpolationDelay);
+		if (Delta > IntervalSample)
+		{
+			Snapshots.Last().ServerTime = ServerTime - IntervalSample;
+		}
+		SnapshotInterval = SnapshotInterval > 0.0f ? FMath::Lerp(SnapshotInterval, IntervalSample, IntervalSmoothing) : IntervalSample;
+
+		const double Offset = LocalTime - ServerTime;
+		Jitter = FMath::Lerp(Jitter, (float)FMath::Abs(Offset - ClockOffset), JitterSmoothing);
+		ClockOffset = FMath::Lerp(ClockOffset, Offset, Offset < ClockOffset ? (double)ClockOffsetEarlySmoothing : (double)ClockOffsetLateSmoothing);
+	}
+
+	LastTimeStamp = ServerTimeStamp;
+	LastServerTime = ServerTime;
+	LastLocalTime = LocalTime;
+
+	const float TargetDelay = FMath::Clamp(SnapshotInterval + Jitter * JitterMultiplier, MinInterpolationDelay, MaxInterpolationDelay);
+	InterpolationDelay = FMath::Lerp(InterpolationDelay, TargetDelay, DelaySmoothing);
+
+	if (Snapshots.Num() >= MaxBufferedSnapshots)
+	{
+		Snapshots.RemoveAt(0, 1, false);
+	}
+
+	FMMovementSnapshot& Snapshot = Snapshots[Snapshots.AddUninitialized()];
+	Snapshot.ServerTime = ServerTime;
+	Snapshot.Location = Location;
+	Snapshot.Rotation = Rotation;
+	Snapshot.Velocity = Velocity;
+}
+
+bool FMSnapshotBuffer::Sample(double LocalTime, const FVector& Gravity, FVector& OutLocation, FQuat& OutRotation, FVector& OutVelocity)
+{
+	if (Snapshots.Num() == 0)
+	{
+		return false;
+	}
+
+	const double RenderTime = LocalTime - ClockOffset - InterpolationDelay;
+
+	if (RenderTime <= Snapshots[0].ServerTime)
+	{
+		const FMMovementSnapshot& First = Snapshots[0];
+		OutLocation = First.Location;
+		OutRotation = First.Rotation;
+		OutVelocity = First.Velocity;
+		return true;
+	}
+
+	const FMMovementSnapshot& Last = Snapshots.Last();
+	if (RenderTime >= Last.ServerTime)
+	{
+		// Buffer ran dry, extrapolate along the ballistic path for a limited time
+		const float Time = FMath::Min((float)(RenderTime - Last.ServerTime), MaxExtrapolationTime);
+		OutLocation = Last.Location + Last.Velocity * Time + Gravity * (0.5f * Time * Time);
+		OutRotation = Last.Rotation;
+		OutVelocity = Last.Velocity + Gravity * Time;
+
+		// Keep only the last snapshot, older ones can't be rendered anymore
+		if (Snapshots.Num() > 1)
+		{
+			Snapshots.RemoveAt(0, Snapshots.Num() - 1, false);
+		}
+		return true;
+	}
+
+	int32 Index = 0;
+	while (Snapshots[Index + 1].ServerTime <= RenderTime)
+	{
+		Index++;
+	}
+
+	const FMMovementSnapshot& From = Snapshots[Index];
+	const FMMovementSnapshot& To = Snapshots[Index + 1];
+	const float Duration = (float)(To.ServerTime - From.ServerTime);
+	const float Alpha = (float)(RenderTime - From.ServerTime) / Duration;
+
+	// Hermite spline through both positions using velocities as tangents
+	const FVector FromTangent = From.Velocity * Duration;
+	const FVector ToTangent = To.Velocity * Duration;
+	OutLocation = FMath::CubicInterp(From.Location, FromTangent, To.Location, ToTangent, Alpha);
+	OutVelocity = FMath::CubicInterpDerivative(From.Location, FromTangent, To.Location, ToTangent, Alpha) / Duration;
+	OutRotation = FQuat::Slerp(From.Rotation, To.Rotation, Alpha);
+
+	if (Index > 0)
+	{
+		Snapshots.RemoveAt(0, Index, false);
+	}
+
+	return true;
+}
@@ -0,0 +1,150 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MFrameBudgetScheduler.h"
+#include "Engine/World.h"
+#include "GameModes/MJointGameMode.h"
+
+DECLARE_CYCLE_STAT(TEXT("Frame Budget Scheduler"), STAT_FrameBudgetScheduler, STATGROUP_Game);
+
+namespace
+{
+	const TCHAR* CategoryNames[] = { TEXT("GravityReplication"), TEXT("Ragdoll"), TEXT("Inventory"), TEXT("Navigation"), TEXT("Misc") };
+	static_assert(ARRAY_COUNT(CategoryNames) == (int32)EMDeferredWorkCategory::Count, "Missing deferred work category names");
+
+	/** Smoothing of average category usage */
+	const float UsageSmoothing = 0.05f;
+}
+
+FMDeferredWorkStats::FMDeferredWorkStats()
+	: NumQueued(0)
+	, NumExecuted(0)
+	, NumStarved(0)
+	, LastFrameMicroseconds(0.0f)
+	, AverageMicroseconds(0.0f)
+	, MaxWaitSeconds(0.0f)
+{
+}
+
+FMFrameBudgetScheduler::FMFrameBudgetScheduler()
+	: BudgetMicroseconds(1000.0f)
+	, StarvationSeconds(0.5f)
+{
+}
+
+void FMFrameBudgetScheduler::Schedule(UWorld* World, EMDeferredWorkCategory Category, EMDeferredWorkPriority Priority, const UObject* Context, TFunction<void()>&& Work)
+{
+	AMJointGameMode* GameMode = World ? World->GetAuthGameMode<AMJointGameMode>() : nullptr;
+	if (GameMode)
+	{
+		GameMode->GetFrameBudgetScheduler().Enqueue(Category, Priority, Context, MoveTemp(Work));
+	}
+	else
+	{
+		Work();
+	}
+}
+
+void FMFrameBudgetScheduler::Enqueue(EMDeferredWorkCategory Category, EMDeferredWorkPriority Priority, const UObject* Context, TFunction<void()>&& Work)
+{
+	FWork& NewWork = Queues[(int32)Priority][Queues[(int32)Priority].AddDefaulted()];
+	NewWork.Function = MoveTemp(Work);
+	NewWork.Context = Context;
+	NewWork.EnqueueTime = FPlatformTime::Seconds();
+	NewWork.Category = Category;
+
+	Stats[(int32)Category].NumQueued++;
+}
+
+void FMFrameBudgetScheduler::Tick(float DeltaSeconds)
+{
+	SCOPE_CYCLE_COUNTER(STAT_FrameBudgetScheduler);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	// Promote starving work, oldest work is at the front of each queue
+	for (int32 Priority = 0; Priority < (int32)EMDeferredWorkPriority::Count - 1; Priority++)
+	{
+		TArray<FWork>& Queue = Queues[Priority];
+		int32 NumStarving = 0;
+		while (NumStarving < Queue.Num() && StartTime - Queue[NumStarving].EnqueueTime > StarvationSeconds)
+		{
+			Stats[(int32)Queue[NumStarving].Category].NumStarved++;
+			NumStarving++;
+		}
+
+		if (NumStarving > 0)
+		{
+			TArray<FWork>& HigherQueue = Queues[Priority + 1];
+			TArray<FWork> Promoted;
+			Promoted.Reserve(NumStarving + HigherQueue.Num());
+			for (int32 i = 0; i < NumStarving; i++)
+			{
+				Promoted.Add(MoveTemp(Queue[i]));
+			}
+			for (FWork& Work : HigherQueue)
+			{
+				Promoted.Add(MoveTemp(Work));
+			}
+			HigherQueue = MoveTemp(Promoted);
+			Queue.RemoveAt(0, NumStarving, false);
+		}
+	}
+
+	float FrameMicroseconds[(int32)EMDeferredWorkCategory::Count] = {};
+	const double EndTime = StartTime + BudgetMicroseconds * 1e-6;
+	bool bExecutedAny = false;
+
+	for (int32 Priority = (int32)EMDeferredWorkPriority::Count - 1; Priority >= 0; Priority--)
+	{
+		TArray<FWork>& Queue = Queues[Priority];
+		int32 NumProcessed = 0;
+
+		// Always run at least one item per frame so the queue makes progress with a tiny budget
+		while (NumProcessed < Queue.Num() && (!bExecutedAny || FPlatformTime::Seconds() < EndTime))
+		{
+			// Work may enqueue more work, don't hold references into the queue while it runs
+			FWork Work = MoveTemp(Queue[NumProcessed++]);
+			FMDeferredWorkStats& CategoryStats = Stats[(int32)Work.Category];
+			CategoryStats.NumQueued--;
+
+			if (Work.Context.IsStale())
+			{
+				continue;
+			}
+
+			const double WorkStartTime = FPlatformTime::Seconds();
+			Work.Function();
+			const double WorkEndTime = FPlatformTime::Seconds();
+
+			FrameMicroseconds[(int32)Work.Category] += (WorkEndTime - WorkStartTime) * 1e6;
+			CategoryStats.NumExecuted++;
+			CategoryStats.MaxWaitSeconds = FMath::Max(CategoryStats.MaxWaitSeconds, (float)(WorkStartTime - Work.EnqueueTime));
+			bExecutedAny = true;
+		}
+
+		Queue.RemoveAt(0, NumProcessed, false);
+	}
+
+	for (int32 Category = 0; Category < (int32)EMDeferredWorkCategory::Count; Category++)
+	{
+		Stats[Category].LastFrameMicroseconds = FrameMicroseconds[Category];
+		Stats[Category].AverageMicroseconds = FMath::Lerp(Stats[Category].AverageMicroseconds, FrameMicroseconds[Category], UsageSmoothing);
+	}
+}
+
+void FMFrameBudgetScheduler::DumpStats() const
+{
+	UE_LOG(LogPerplexNet, Log, TEXT("Frame budget scheduler, %.0f us per frame:"), BudgetMicroseconds);
+	for (int32 Category = 0; Category < (int32)EMDeferredWorkCategory::Count; Category++)
+	{
+		const FMDeferredWorkStats& CategoryStats = Stats[Category];
+		UE_LOG(LogPerplexNet, Log, TEXT("  %s: %.1f us avg, %.1f us last frame, %d queued, %d executed, %d starved, %.3f s max wait"),
+			CategoryNames[Category],
+			CategoryStats.AverageMicroseconds,
+			CategoryStats.LastFrameMicroseconds,
+			CategoryStats.NumQueued,
+			CategoryStats.NumExecuted,
+			CategoryStats.NumStarved,
+			CategoryStats.MaxWaitSeconds);
+	}
+}
@@ -0,0 +1,186 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MServerLoadReport.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetConnection.h"
+#include "EngineUtils.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Characters/MCharacter.h"
+#include "Characters/MCharacterMovementComponent.h"
+
+namespace
+{
+	/** Hard cap on recorded samples, one hour at default interval */
+	const int32 MaxSamples = 3600;
+}
+
+FMServerLoadReport::FMServerLoadReport()
+	: SampleInterval(1.0f)
+	, bEnabled(false)
+{
+	Reset();
+}
+
+void FMServerLoadReport::Reset()
+{
+	Samples.Reset();
+	IntervalTime = 0.0f;
+	IntervalFrames = 0;
+	FrameMsSum = 0.0f;
+	FrameMsMax = 0.0f;
+	GameThreadMsSum = 0.0f;
+	LastServerMoves = 0;
+	LastServerMoveCorrections = 0;
+}
+
+void FMServerLoadReport::Tick(UWorld* World, float DeltaSeconds)
+{
+	if (!bEnabled || !World)
+	{
+		return;
+	}
+
+	const float FrameMs = DeltaSeconds * 1000.0f;
+	IntervalTime += DeltaSeconds;
+	IntervalFrames++;
+	FrameMsSum += FrameMs;
+	FrameMsMax = FMath::Max(FrameMsMax, FrameMs);
+	GameThreadMsSum += FPlatformTime::ToMilliseconds(GGameThreadTime);
+
+	if (IntervalTime < SampleInterval)
+	{
+		return;
+	}
+
+	FMServerLoadSample Sample;
+	Sample.Time = World->GetTimeSeconds();
+	Sample.AvgFrameMs = FrameMsSum / IntervalFrames;
+	Sample.MaxFrameMs = FrameMsMax;
+	Sample.AvgGameThreadMs = GameThreadMsSum / IntervalFrames;
+	Sample.NumConnections = 0;
+	Sample.AvgOutBytesPerConnection = 0.0f;
+	Sample.MaxOutBytesPerConnection = 0.0f;
+	Sample.AvgInBytesPerConnection = 0.0f;
+
+	UNetDriver* NetDriver = World->GetNetDriver();
+	if (NetDriver)
+	{
+		for (UNetConnection* Connection : NetDriver->ClientConnections)
+		{
+			if (Connection)
+			{
+				Sample.NumConnections++;
+				Sample.AvgOutBytesPerConnection += Connection->OutBytesPerSecond;
+				Sample.AvgInBytesPerConnection += Connection->InBytesPerSecond;
+				Sample.MaxOutBytesPerConnection = FMath::Max(Sample.MaxOutBytesPerConnection, (float)Connection->OutBytesPerSecond);
+			}
+		}
+
+		if (Sample.NumConnections > 0)
+		{
+			Sample.AvgOutBytesPerConnection /= Sample.NumConnections;
+			Sample.AvgInBytesPerConnection /= Sample.NumConnections;
+		}
+	}
+
+	int32 ServerMoves = 0;
+	int32 ServerMoveCorrections = 0;
+	for (TActorIterator<AMCharacter> It(World); It; ++It)
+	{
+		const UMCharacterMovementComponent* Movement = It->GetCustomCharacterMovementComponent();
+		if (Movement)
+		{
+			ServerMoves += Movement->GetNumServerMoves();
+			ServerMoveCorrections += Movement->GetNumServerMoveCorrections();
+		}
+	}
+
+	// Destroyed characters take their counters with them
+	Sample.ServerMoves = FMath::Max(0, ServerMoves - LastServerMoves);
+	Sample.ServerMoveCorrections = FMath::Max(0, ServerMoveCorrections - LastServerMoveCorrections);
+	LastServerMoves = ServerMoves;
+	LastServerMoveCorrections = ServerMoveCorrections;
+
+	if (Samples.Num() >= MaxSamples)
+	{
+		Samples.RemoveAt(0, 1, false);
+	}
+	Samples.Add(Sample);
+
+	IntervalTime = 0.0f;
+	IntervalFrames = 0;
+	FrameMsSum = 0.0f;
+	FrameMsMax = 0.0f;
+	GameThreadMsSum = 0.0f;
+}
+
+void FMServerLoadReport::DumpSummary() const
+{
+	TMap<int32, TArray<const FMServerLoadSample*>> SamplesByConnections;
+	for (const FMServerLoadSample& Sample : Samples)
+	{
+		SamplesByConnections.FindOrAdd(Sample.NumConnections).Add(&Sample);
+	}
+	SamplesByConnections.KeySort(TLess<int32>());
+
+	UE_LOG(LogPerplexNet, Log, TEXT("Server load report, %d samples:"), Samples.Num());
+	for (const auto& Pair : SamplesByConnections)
+	{
+		float FrameMs = 0.0f;
+		float MaxFrameMs = 0.0f;
+		float GameThreadMs = 0.0f;
+		float OutBytes = 0.0f;
+		float InBytes = 0.0f;
+		int32 ServerMoves = 0;
+		int32 ServerMoveCorrections = 0;
+		for (const FMServerLoadSample* Sample : Pair.Value)
+		{
+			FrameMs += Sample->AvgFrameMs;
+			MaxFrameMs = FMath::Max(MaxFrameMs, Sample->MaxFrameMs);
+			GameThreadMs += Sample->AvgGameThreadMs;
+			OutBytes += Sample->AvgOutBytesPerConnection;
+			InBytes += Sample->AvgInBytesPerConnection;
+			ServerMoves += Sample->ServerMoves;
+			ServerMoveCorrections += Sample->ServerMoveCorrections;
+		}
+
+		const float Count = Pair.Value.Num();
+		UE_LOG(LogPerplexNet, Log, TEXT("  %3d connections: frame %.2f ms (max %.2f), game thread %.2f ms, out %.0f B/s, in %.0f B/s per connection, corrections %.2f%%"),
+			Pair.Key,
+			FrameMs / Count,
+			MaxFrameMs,
+			GameThreadMs / Count,
+			OutBytes / Count,
+			InBytes / Count,
+			ServerMoves > 0 ? 100.0f * ServerMoveCorrections / ServerMoves : 0.0f);
+	}
+}
+
+bool FMServerLoadReport::WriteCsv(const FString& Filename) const
+{
+	FString Csv = TEXT("Time,Connections,AvgFrameMs,MaxFrameMs,AvgGameThreadMs,AvgOutBytesPerConnection,MaxOutBytesPerConnection,AvgInBytesPerConnection,ServerMoves,ServerMoveCorrections\n");
+	for (const FMServerLoadSample& Sample : Samples)
+	{
+		Csv += FString::Printf(TEXT("%.2f,%d,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,%d,%d\n"),
+			Sample.Time,
+			Sample.NumConnections,
+			Sample.AvgFrameMs,
+			Sample.MaxFrameMs,
+			Sample.AvgGameThreadMs,
+			Sample.AvgOutBytesPerConnection,
+			Sample.MaxOutBytesPerConnection,
+			Sample.AvgInBytesPerConnection,
+			Sample.ServerMoves,
+			Sample.ServerMoveCorrections);
+	}
+
+	return FFileHelper::SaveStringToFile(Csv, *Filename);
+}
+
+FString FMServerLoadReport::GetDefaultCsvFilename()
+{
+	return FPaths::ProfilingDir() / TEXT("Perplex") / FString::Printf(TEXT("ServerLoad-%s.csv"), *FDateTime::Now().ToString());
+}
@@ -0,0 +1,115 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "Engine/EngineTypes.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+#include "Net/MRepMovement.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	/** ACharacter replicates its server timestamp as a float next to FRepMovement, FMRepMovement replaces both */
+	const int64 EngineTimeStampBits = 32;
+
+	const FVector TestLocation(10000.0f, -5000.0f, 300.0f);
+	const FVector TestVelocity(400.0f, -300.0f, 50.0f);
+
+	FRepMovement MakeRepMovement(const FRotator& Rotation)
+	{
+		FRepMovement RepMovement;
+		RepMovement.Location = TestLocation;
+		RepMovement.Rotation = Rotation;
+		RepMovement.LinearVelocity = TestVelocity;
+		return RepMovement;
+	}
+
+	FMRepMovement MakeMRepMovement(const FRotator& Rotation)
+	{
+		FMRepMovement MRepMovement;
+		MRepMovement.Location = TestLocation;
+		MRepMovement.Rotation = Rotation.Quaternion();
+		MRepMovement.LinearVelocity = TestVelocity;
+		MRepMovement.Precision = EMRepMovementPrecision::Default;
+		MRepMovement.ServerTimeStamp = FMRepMovement::MakeTimeStamp(1234.5f);
+		return MRepMovement;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMRepMovementSizeTest, "Perplex.Net.RepMovement.SerializedSize", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMRepMovementSizeTest::RunTest(const FString& Parameters)
+{
+	const FRotator Rotations[] = { FRotator(30.0f, 60.0f, 45.0f), FRotator(0.0f, 60.0f, 0.0f) };
+	const int64 ExpectedRepMovementBits[] = { 112, 96 };
+	const int64 ExpectedMRepMovementBits[] = { 129, 111 };
+
+	for (int32 i = 0; i < ARRAY_COUNT(Rotations); i++)
+	{
+		bool bSuccess = false;
+
+		FRepMovement RepMovement = MakeRepMovement(Rotations[i]);
+		FBitWriter RepMovementWriter(0, true);
+		RepMovement.NetSerialize(RepMovementWriter, nullptr, bSuccess);
+
+		FMRepMovement MRepMovement = MakeMRepMovement(Rotations[i]);
+		FBitWriter MRepMovementWriter(0, true);
+		MRepMovement.NetSerialize(MRepMovementWriter, nullptr, bSuccess);
+
+		TestEqual(TEXT("FRepMovement bits"), RepMovementWriter.GetNumBits(), ExpectedRepMovementBits[i]);
+		TestEqual(TEXT("FMRepMovement bits, header included"), MRepMovementWriter.GetNumBits(), ExpectedMRepMovementBits[i]);
+		TestTrue(TEXT("FMRepMovement is smaller than FRepMovement and the server timestamp"), MRepMovementWriter.GetNumBits() < RepMovementWriter.GetNumBits() + EngineTimeStampBits);
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMRepMovementAccuracyTest, "Perplex.Net.RepMovement.Accuracy", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMRepMovementAccuracyTest::RunTest(const FString& Parameters)
+{
+	const FRotator Rotations[] = { FRotator(30.0f, 60.0f, 45.0f), FRotator(0.0f, 60.0f, 0.0f), FRotator(12.3f, -77.7f, 3.1f) };
+
+	for (const FRotator& Rotation : Rotations)
+	{
+		bool bSuccess = false;
+
+		FRepMovement RepMovement = MakeRepMovement(Rotation);
+		FBitWriter RepMovementWriter(0, true);
+		RepMovement.NetSerialize(RepMovementWriter, nullptr, bSuccess);
+
+		FRepMovement ReceivedRepMovement;
+		FBitReader RepMovementReader(RepMovementWriter.GetData(), RepMovementWriter.GetNumBits());
+		ReceivedRepMovement.NetSerialize(RepMovementReader, nullptr, bSuccess);
+
+		FMRepMovement MRepMovement = MakeMRepMovement(Rotation);
+		FBitWriter MRepMovementWriter(0, true);
+		MRepMovement.NetSerialize(MRepMovementWriter, nullptr, bSuccess);
+
+		FMRepMovement ReceivedMRepMovement;
+		ReceivedMRepMovement.Precision = EMRepMovementPrecision::Default;
+		FBitReader MRepMovementReader(MRepMovementWriter.GetData(), MRepMovementWriter.GetNumBits());
+		ReceivedMRepMovement.NetSerialize(MRepMovementReader, nullptr, bSuccess);
+
+		TestEqual(TEXT("Every bit is read back"), MRepMovementReader.GetPosBits(), MRepMovementWriter.GetNumBits());
+		TestEqual(TEXT("Timestamp is received"), ReceivedMRepMovement.ServerTimeStamp, MRepMovement.ServerTimeStamp);
+
+		const FQuat Quat = Rotation.Quaternion();
+		const float RepMovementRotationError = FMath::RadiansToDegrees(Quat.AngularDistance(ReceivedRepMovement.Rotation.Quaternion()));
+		const float MRepMovementRotationError = FMath::RadiansToDegrees(Quat.AngularDistance(ReceivedMRepMovement.Rotation));
+		TestTrue(TEXT("Rotation is more accurate than FRepMovement"), MRepMovementRotationError < RepMovementRotationError);
+
+		const float RepMovementLocationError = FVector::Dist(TestLocation, ReceivedRepMovement.Location);
+		const float MRepMovementLocationError = FVector::Dist(TestLocation, ReceivedMRepMovement.Location);
+		TestTrue(TEXT("Location is as accurate as FRepMovement"), MRepMovementLocationError <= RepMovementLocationError + KINDA_SMALL_NUMBER);
+
+		const float RepMovementVelocityError = FVector::Dist(TestVelocity, ReceivedRepMovement.LinearVelocity);
+		const float MRepMovementVelocityError = FVector::Dist(TestVelocity, ReceivedMRepMovement.LinearVelocity);
+		TestTrue(TEXT("Velocity is as accurate as FRepMovement"), MRepMovementVelocityError <= RepMovementVelocityError + KINDA_SMALL_NUMBER);
+	}
+
+	return true;
+}
+
+#endif
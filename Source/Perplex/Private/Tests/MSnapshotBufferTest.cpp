@@ -0,0 +1,43 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "Net/MRepMovement.h"
+#include "Net/MSnapshotBuffer.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMSnapshotBufferLongGapTest, "Perplex.Net.SnapshotBuffer.LongGap", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMSnapshotBufferLongGapTest::RunTest(const FString& Parameters)
+{
+	FMSnapshotBuffer Buffer;
+
+	float ServerTime = 1.0f;
+	double LocalTime = 10.0;
+	Buffer.AddSnapshot(FMRepMovement::MakeTimeStamp(ServerTime), LocalTime, FVector::ZeroVector, FQuat::Identity, FVector::ZeroVector);
+	ServerTime += 0.1f;
+	LocalTime += 0.1;
+	const uint16 LastTimeStamp = FMRepMovement::MakeTimeStamp(ServerTime);
+	Buffer.AddSnapshot(LastTimeStamp, LocalTime, FVector(10.0f, 0.0f, 0.0f), FQuat::Identity, FVector::ZeroVector);
+
+	// Idle for 12 seconds, the wrapped delta is negative
+	ServerTime += 12.0f;
+	LocalTime += 12.0;
+	TestTrue(TEXT("Wrapped delta isn't positive"), FMRepMovement::GetTimeStampDelta(LastTimeStamp, FMRepMovement::MakeTimeStamp(ServerTime)) <= 0.0f);
+	Buffer.AddSnapshot(FMRepMovement::MakeTimeStamp(ServerTime), LocalTime, FVector(1000.0f, 0.0f, 0.0f), FQuat::Identity, FVector::ZeroVector);
+	ServerTime += 0.1f;
+	LocalTime += 0.1;
+	Buffer.AddSnapshot(FMRepMovement::MakeTimeStamp(ServerTime), LocalTime, FVector(1010.0f, 0.0f, 0.0f), FQuat::Identity, FVector::ZeroVector);
+
+	TestEqual(TEXT("Snapshots after the gap are accepted"), Buffer.Num(), 2);
+
+	FVector Location;
+	FQuat Rotation;
+	FVector Velocity;
+	TestTrue(TEXT("Buffer can be sampled"), Buffer.Sample(LocalTime + 1.0, FVector::ZeroVector, Location, Rotation, Velocity));
+	TestTrue(TEXT("Proxy follows snapshots after the gap"), FMath::IsNearlyEqual(Location.X, 1010.0f, 1.0f));
+
+	return true;
+}
+
+#endif
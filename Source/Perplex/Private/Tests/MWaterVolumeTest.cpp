@@ -0,0 +1,32 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+#include "World/MWaterVolume.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FMWaterSphereShellTest, "Perplex.World.WaterVolume.Shell", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+bool FMWaterSphereShellTest::RunTest(const FString& Parameters)
+{
+	const FVector Center(1000.0f, 0.0f, 0.0f);
+	const FMWaterSphere Water(Center, 20000.0f, 15000.0f);
+
+	const FVector CorePoint = Center + FVector(0.0f, 0.0f, 10000.0f);
+	const FVector WaterPoint = Center + FVector(0.0f, 0.0f, 18000.0f);
+	const FVector OutsidePoint = Center + FVector(0.0f, 0.0f, 25000.0f);
+
+	TestTrue(TEXT("Core isn't in the volume"), Water.GetDistanceToWater(CorePoint) > 0.0f);
+	TestTrue(TEXT("Shell is in the volume"), Water.GetDistanceToWater(WaterPoint) <= 0.0f);
+	TestTrue(TEXT("Outside of the surface isn't in the volume"), Water.GetDistanceToWater(OutsidePoint) > 0.0f);
+
+	// Volume membership and immersion agree
+	const FVector Offset(0.0f, 0.0f, 100.0f);
+	TestEqual(TEXT("Core is dry"), Water.GetImmersion(CorePoint - Offset, CorePoint + Offset), 0.0f);
+	TestEqual(TEXT("Shell is immersed"), Water.GetImmersion(WaterPoint - Offset, WaterPoint + Offset), 1.0f);
+	TestEqual(TEXT("Outside of the surface is dry"), Water.GetImmersion(OutsidePoint - Offset, OutsidePoint + Offset), 0.0f);
+
+	return true;
+}
+
+#endif
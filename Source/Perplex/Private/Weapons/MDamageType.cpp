@@ -1,3 +1,23 @@
 // Copyright 2018 Tin Rabzelj. All Rights Reserved.
 
 #include "MDamageType.h"
+
+UMDamageType::UMDamageType(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	HeadDamageMultiplier = 2.0f;
+	LimbDamageMultiplier = 0.75f;
+}
+
+float UMDamageType::GetDamageMultiplier(EMHitZone Zone) const
+{
+	switch (Zone)
+	{
+	case EMHitZone::Head:
+		return HeadDamageMultiplier;
+	case EMHitZone::Limb:
+		return LimbDamageMultiplier;
+	default:
+		return 1.0f;
+	}
+}
@@ -5,6 +5,8 @@
 #include "Particles/ParticleSystemComponent.h"
 #include "Kismet/GameplayStatics.h"
 #include "UnrealNetwork.h"
+#include "AI/MAIController.h"
+#include "Assets/MAssetStreamer.h"
 #include "Characters/MCharacter.h"
 #include "Effects/MImpactEffect.h"
 
@@ -12,12 +14,14 @@ FMInstantWeaponData::FMInstantWeaponData()
 {
 	WeaponSpread = 5.0f;
 	AimSpreadModifier = 0.25f;
+	AISpreadModifier = 1.5f;
 	FiringSpreadIncrement = 1.0f;
 	FiringSpreadMax = 10.0f;
 	WeaponRange = 10000.0f;
 	HitDamage = 10;
 	DamageType = UDamageType::StaticClass();
 	ClientSideHitLeeway = 200.0f;
+	ClientSideHitboxLeeway = 30.0f;
 	AllowedViewDotHitDir = 0.8f;
 }
 
@@ -26,6 +30,16 @@ AMInstantWeapon::AMInstantWeapon()
 	CurrentFiringSpread = 0.0f;
 }
 
+void AMInstantWeapon::GetCosmeticAssets(TArray<FSoftObjectPath>& OutPaths) const
+{
+	Super::GetCosmeticAssets(OutPaths);
+
+#if WITH_COSMETICS
+	FMAssetStreamer::AddPath(OutPaths, ImpactTemplate);
+	FMAssetStreamer::AddPath(OutPaths, TrailFX);
+#endif
+}
+
 void AMInstantWeapon::FireWeapon()
 {
 	const int32 RandomSeed = FMath::Rand();
@@ -100,7 +114,7 @@ void AMInstantWeapon::ServerNotifyHit_Implementation(const FHitResult& Impact, F
 						FMath::Abs(Impact.Location.X - BoxCenter.X) < BoxExtent.X &&
 						FMath::Abs(Impact.Location.Y - BoxCenter.Y) < BoxExtent.Y)
 					{
-						ProcessInstantHit_Confirmed(Impact, Origin, ShootDir, RandomSeed, ReticleSpread);
+						ProcessInstantHit_Confirmed(ResolveServerHitbox(Impact, ShootDir), Origin, ShootDir, RandomSeed, ReticleSpread);
 					}
 					else
 					{
@@ -135,11 +149,13 @@ void AMInstantWeapon::ServerNotifyMiss_Implementation(FVector_NetQuantizeNormal
 	HitNotify.ReticleSpread = ReticleSpread;
 
 	// play FX locally
+#if WITH_COSMETICS
 	if (GetNetMode() != NM_DedicatedServer)
 	{
 		const FVector EndTrace = Origin + ShootDir * InstantData.WeaponRange;
 		SpawnTrailEffect(EndTrace);
 	}
+#endif
 }
 
 void AMInstantWeapon::ProcessInstantHit(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 RandomSeed, float ReticleSpread)
@@ -188,6 +204,7 @@ void AMInstantWeapon::ProcessInstantHit_Confirmed(const FHitResult& Impact, cons
 	}
 
 	// play FX locally
+#if WITH_COSMETICS
 	if (GetNetMode() != NM_DedicatedServer)
 	{
 		const FVector EndTrace = Origin + ShootDir * InstantData.WeaponRange;
@@ -196,6 +213,40 @@ void AMInstantWeapon::ProcessInstantHit_Confirmed(const FHitResult& Impact, cons
 		SpawnTrailEffect(EndPoint);
 		SpawnImpactEffects(Impact);
 	}
+#endif
+}
+
+FHitResult AMInstantWeapon::ResolveServerHitbox(const FHitResult& Impact, const FVector& ShootDir)
+{
+	FHitResult ServerImpact = Impact;
+
+	// The bounding box check doesn't cover zones, so clients could claim a headshot on every hit
+	AMCharacter* HitCharacter = Cast<AMCharacter>(Impact.GetActor());
+	if (HitCharacter && HitCharacter->UsesHitboxes())
+	{
+		const FVector StartTrace = GetCameraDamageStartLocation(ShootDir);
+		const FVector EndTrace = StartTrace + ShootDir * InstantData.WeaponRange;
+
+		// Unrewound server pose is behind what the client shot at, close enough is a hit
+		if (HitCharacter->GetHitboxDistance(Impact.Item, StartTrace, EndTrace) <= InstantData.ClientSideHitboxLeeway)
+		{
+			return ServerImpact;
+		}
+
+		FMHitboxHit HitboxHit;
+		if (HitCharacter->RaycastHitboxes(StartTrace, EndTrace, HitboxHit))
+		{
+			ServerImpact.Item = HitboxHit.Index;
+			ServerImpact.BoneName = HitboxHit.BoneName;
+		}
+		else
+		{
+			ServerImpact.Item = INDEX_NONE;
+			ServerImpact.BoneName = NAME_None;
+		}
+	}
+
+	return ServerImpact;
 }
 
 bool AMInstantWeapon::ShouldDealDamage(AActor* TestActor) const
@@ -239,6 +290,7 @@ void AMInstantWeapon::OnRep_HitNotify()
 
 void AMInstantWeapon::SimulateInstantHit(const FVector& ShotOrigin, int32 RandomSeed, float ReticleSpread)
 {
+#if WITH_COSMETICS
 	FRandomStream WeaponRandomStream(RandomSeed);
 	const float ConeHalfAngle = FMath::DegreesToRadians(ReticleSpread * 0.5f);
 
@@ -257,11 +309,14 @@ void AMInstantWeapon::SimulateInstantHit(const FVector& ShotOrigin, int32 Random
 	{
 		SpawnTrailEffect(EndTrace);
 	}
+#endif
 }
 
 void AMInstantWeapon::SpawnImpactEffects(const FHitResult& Impact)
 {
-	if (ImpactTemplate && Impact.bBlockingHit)
+#if WITH_COSMETICS
+	UClass* ImpactClass = FMAssetStreamer::GetLoaded(ImpactTemplate);
+	if (ImpactClass && Impact.bBlockingHit)
 	{
 		FHitResult UseImpact = Impact;
 
@@ -276,7 +331,7 @@ void AMInstantWeapon::SpawnImpactEffects(const FHitResult& Impact)
 
 		FTransform const SpawnTransform(Impact.ImpactNormal.Rotation(), Impact.ImpactPoint);
 		/*
-		AMImpactEffect* EffectActor = GetWorld()->SpawnActorDeferred<AMImpactEffect>(ImpactTemplate, SpawnTransform);
+		AMImpactEffect* EffectActor = GetWorld()->SpawnActorDeferred<AMImpactEffect>(ImpactClass, SpawnTransform);
 		if (EffectActor)
 		{
 			EffectActor->SurfaceHit = UseImpact;
@@ -284,20 +339,24 @@ void AMInstantWeapon::SpawnImpactEffects(const FHitResult& Impact)
 		}
 		*/
 	}
+#endif
 }
 
 void AMInstantWeapon::SpawnTrailEffect(const FVector& EndPoint)
 {
-	if (TrailFX)
+#if WITH_COSMETICS
+	UParticleSystem* Trail = FMAssetStreamer::GetLoaded(TrailFX);
+	if (Trail)
 	{
 		const FVector Origin = GetMuzzleLocation();
 
-		UParticleSystemComponent* TrailPSC = UGameplayStatics::SpawnEmitterAtLocation(this, TrailFX, Origin);
+		UParticleSystemComponent* TrailPSC = UGameplayStatics::SpawnEmitterAtLocation(this, Trail, Origin);
 		if (TrailPSC)
 		{
 			TrailPSC->SetVectorParameter(TrailTargetParam, EndPoint);
 		}
 	}
+#endif
 }
 
 void AMInstantWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -310,10 +369,18 @@ void AMInstantWeapon::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutL
 float AMInstantWeapon::GetCurrentSpread() const
 {
 	float FinalSpread = InstantData.WeaponSpread + CurrentFiringSpread;
+	if (OwnerCharacter)
+	{
+		FinalSpread *= OwnerCharacter->GetHexStats().Get(EMHexStat::Spread);
+	}
 	if (OwnerCharacter && OwnerCharacter->IsAiming())
 	{
 		FinalSpread *= InstantData.AimSpreadModifier;
 	}
+	if (OwnerCharacter && Cast<AMAIController>(OwnerCharacter->Controller))
+	{
+		FinalSpread *= InstantData.AISpreadModifier;
+	}
 
 	return FinalSpread;
 }
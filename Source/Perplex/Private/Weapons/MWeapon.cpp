@@ -2,14 +2,19 @@
 
 #include "MWeapon.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "Engine/ActorChannel.h"
 #include "Kismet/GameplayStatics.h"
 #include "Particles/ParticleSystem.h"
 #include "Particles/ParticleSystemComponent.h"
 #include "TimerManager.h"
 #include "UnrealNetwork.h"
+#include "Net/DataBunch.h"
 #include "MCharacter.h"
 #include "MPlayerCharacter.h"
 #include "MPlayerController.h"
+#include "AI/MAIController.h"
+#include "Assets/MAssetStreamer.h"
+#include "Net/MNetBandwidthProfiler.h"
 
 AMWeapon::AMWeapon()
 {
@@ -49,6 +54,37 @@ AMWeapon::AMWeapon()
 	Super::SetTickGroup(TG_PrePhysics);
 	Super::SetReplicates(true);
 	bNetUseOwnerRelevancy = true;
+	NetDormancy = DORM_Awake;
+}
+
+void AMWeapon::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	// Usually preloaded with the loadout, otherwise effects are skipped until they arrive
+	TArray<FSoftObjectPath> Paths;
+	GetGameplayAssets(Paths);
+	GameplayAssetsHandle = FMAssetStreamer::RequestLoad(Paths, EMAssetStreamPriority::Gameplay);
+
+	Paths.Reset();
+	GetCosmeticAssets(Paths);
+	CosmeticAssetsHandle = FMAssetStreamer::RequestLoad(Paths, EMAssetStreamPriority::Cosmetic);
+}
+
+void AMWeapon::GetGameplayAssets(TArray<FSoftObjectPath>& OutPaths) const
+{
+	FMAssetStreamer::AddPath(OutPaths, FireAnimation.FirstPerson);
+	FMAssetStreamer::AddPath(OutPaths, FireAnimation.ThirdPerson);
+	FMAssetStreamer::AddPath(OutPaths, EquipAnimation.FirstPerson);
+	FMAssetStreamer::AddPath(OutPaths, EquipAnimation.ThirdPerson);
+}
+
+void AMWeapon::GetCosmeticAssets(TArray<FSoftObjectPath>& OutPaths) const
+{
+#if WITH_COSMETICS
+	FMAssetStreamer::AddPath(OutPaths, MuzzleEffect);
+	FMAssetStreamer::AddPath(OutPaths, FireCameraShake);
+#endif
 }
 
 USkeletalMeshComponent* AMWeapon::GetWeaponMesh() const
@@ -276,6 +312,52 @@ void AMWeapon::ServerStopFire_Implementation()
 	StopFire();
 }
 
+bool AMWeapon::CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack)
+{
+	FMNetBandwidthProfiler::FScopedSentRPC ScopedSentRPC(this, Function);
+	return Super::CallRemoteFunction(Function, Parameters, OutParms, Stack);
+}
+
+void AMWeapon::ProcessEvent(UFunction* Function, void* Parameters)
+{
+	// RPCs from clients are executed through here on the server
+	if (Function->FunctionFlags & FUNC_NetServer)
+	{
+		FMNetBandwidthProfiler* Profiler = FMNetBandwidthProfiler::Find(GetWorld());
+		if (Profiler)
+		{
+			Profiler->RecordReceivedRPC(this, Function, Parameters, GetNetConnection());
+		}
+	}
+
+	Super::ProcessEvent(Function, Parameters);
+}
+
+bool AMWeapon::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
+{
+	// Actor properties were just written, components follow
+	const int64 ActorBits = Bunch->GetNumBits();
+	const bool bWroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags);
+
+	FMNetBandwidthProfiler* Profiler = FMNetBandwidthProfiler::Find(GetWorld());
+	if (Profiler)
+	{
+		Profiler->RecordReplicatedProperties(this, Channel->Connection, *RepFlags, ActorBits, Bunch->GetNumBits() - ActorBits);
+	}
+
+	return bWroteSomething;
+}
+
+void AMWeapon::GetLifetimeReplicatedProps(TArray< FLifetimeProperty > & OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AMWeapon, OwnerCharacter);
+
+	// everyone except local owner: fire events are locally instigated
+	DOREPLIFETIME_CONDITION(AMWeapon, BurstCounter, COND_SkipOwner);
+}
+
 void AMWeapon::OnRep_OwnerCharacter()
 {
 	if (OwnerCharacter)
@@ -302,12 +384,14 @@ void AMWeapon::OnRep_BurstCounter()
 
 void AMWeapon::SimulateWeaponFire()
 {
+#if WITH_COSMETICS
 	if (Role == ROLE_Authority && CurrentState != EMWeaponState::Firing)
 	{
 		return;
 	}
 
-	if (MuzzleEffect)
+	UParticleSystem* MuzzleFX = FMAssetStreamer::GetLoaded(MuzzleEffect);
+	if (MuzzleFX)
 	{
 		USkeletalMeshComponent* UseWeaponMesh = GetWeaponMesh();
 		if (!bLoopedMuzzleEffect || MuzzleParticleSystem == NULL)
@@ -319,19 +403,19 @@ void AMWeapon::SimulateWeaponFire()
 				if (PlayerCon != nullptr)
 				{
 					MeshFP->GetSocketLocation(MuzzleAttachPoint);
-					MuzzleParticleSystem = UGameplayStatics::SpawnEmitterAttached(MuzzleEffect, MeshFP, MuzzleAttachPoint);
+					MuzzleParticleSystem = UGameplayStatics::SpawnEmitterAttached(MuzzleFX, MeshFP, MuzzleAttachPoint);
 					MuzzleParticleSystem->bOwnerNoSee = false;
 					MuzzleParticleSystem->bOnlyOwnerSee = true;
 
 					MeshTP->GetSocketLocation(MuzzleAttachPoint);
-					MuzzleParticleSystemSecondary = UGameplayStatics::SpawnEmitterAttached(MuzzleEffect, MeshTP, MuzzleAttachPoint);
+					MuzzleParticleSystemSecondary = UGameplayStatics::SpawnEmitterAttached(MuzzleFX, MeshTP, MuzzleAttachPoint);
 					MuzzleParticleSystemSecondary->bOwnerNoSee = true;
 					MuzzleParticleSystemSecondary->bOnlyOwnerSee = false;
 				}
 			}
 			else
 			{
-				MuzzleParticleSystem = UGameplayStatics::SpawnEmitterAttached(MuzzleEffect, UseWeaponMesh, MuzzleAttachPoint);
+				MuzzleParticleSystem = UGameplayStatics::SpawnEmitterAttached(MuzzleFX, UseWeaponMesh, MuzzleAttachPoint);
 			}
 		}
 	}
@@ -345,15 +429,18 @@ void AMWeapon::SimulateWeaponFire()
 	AMPlayerController* PC = (OwnerCharacter != nullptr) ? Cast<AMPlayerController>(OwnerCharacter->Controller) : nullptr;
 	if (PC && PC->IsLocalController())
 	{
-		if (FireCameraShake)
+		UClass* FireCameraShakeClass = FMAssetStreamer::GetLoaded(FireCameraShake);
+		if (FireCameraShakeClass)
 		{
-			PC->ClientPlayCameraShake(FireCameraShake, 1);
+			PC->ClientPlayCameraShake(FireCameraShakeClass, 1);
 		}
 	}
+#endif
 }
 
 void AMWeapon::StopSimulatingWeaponFire()
 {
+#if WITH_COSMETICS
 	if (bLoopedMuzzleEffect)
 	{
 		if (MuzzleParticleSystem)
@@ -373,6 +460,7 @@ void AMWeapon::StopSimulatingWeaponFire()
 		StopWeaponAnimation(FireAnimation);
 		bPlayingFireAnimation = false;
 	}
+#endif
 }
 
 float AMWeapon::PlayWeaponAnimation(const FMWeaponAnimation& Animation)
@@ -380,7 +468,7 @@ float AMWeapon::PlayWeaponAnimation(const FMWeaponAnimation& Animation)
 	float Duration = 0.0f;
 	if (OwnerCharacter)
 	{
-		UAnimMontage* UseAnim = OwnerCharacter->IsFirstPerson() ? Animation.FirstPerson : Animation.ThirdPerson;
+		UAnimMontage* UseAnim = FMAssetStreamer::GetLoaded(OwnerCharacter->IsFirstPerson() ? Animation.FirstPerson : Animation.ThirdPerson);
 		if (UseAnim)
 		{
 			Duration = OwnerCharacter->PlayAnimMontage(UseAnim);
@@ -394,7 +482,7 @@ void AMWeapon::StopWeaponAnimation(const FMWeaponAnimation& Animation)
 {
 	if (OwnerCharacter)
 	{
-		UAnimMontage* UseAnim = OwnerCharacter->IsFirstPerson() ? Animation.FirstPerson : Animation.ThirdPerson;
+		UAnimMontage* UseAnim = OwnerCharacter->IsFirstPerson() ? Animation.FirstPerson.Get() : Animation.ThirdPerson.Get();
 		if (UseAnim)
 		{
 			OwnerCharacter->StopAnimMontage(UseAnim);
@@ -417,8 +505,12 @@ FVector AMWeapon::GetAdjustedAim() const
 	}
 	else if (Instigator)
 	{
-		// Now see if we have an AI controller - we will want to get the aim from there if we do
-		// TODO
+		// Bots aim at their target from the muzzle
+		AMAIController* const AIController = Cast<AMAIController>(Instigator->Controller);
+		if (AIController)
+		{
+			FinalAim = AIController->GetAimDirection(GetMuzzleLocation());
+		}
 	}
 
 	return FinalAim;
@@ -458,18 +550,33 @@ FVector AMWeapon::GetCameraDamageStartLocation(const FVector& AimDir) const
 		// Adjust trace so there is nothing blocking the ray between the camera and the pawn, and calculate distance from adjusted start
 		OutStartTrace = OutStartTrace + AimDir * ((Instigator->GetActorLocation() - OutStartTrace) | AimDir);
 	}
+	else if (OwnerCharacter)
+	{
+		// Bots have no camera, use the muzzle
+		OutStartTrace = GetMuzzleLocation();
+	}
 
 	return OutStartTrace;
 }
 
 FVector AMWeapon::GetMuzzleLocation() const
 {
+	if (OwnerCharacter)
+	{
+		OwnerCharacter->RefreshServerPose();
+	}
+
 	USkeletalMeshComponent* UseMesh = GetWeaponMesh();
 	return UseMesh->GetSocketLocation(MuzzleAttachPoint);
 }
 
 FVector AMWeapon::GetMuzzleDirection() const
 {
+	if (OwnerCharacter)
+	{
+		OwnerCharacter->RefreshServerPose();
+	}
+
 	USkeletalMeshComponent* UseMesh = GetWeaponMesh();
 	return UseMesh->GetSocketRotation(MuzzleAttachPoint).Vector();
 }
@@ -484,6 +591,49 @@ FHitResult AMWeapon::WeaponTrace(const FVector& TraceFrom, const FVector& TraceT
 	FHitResult Hit(ForceInit);
 	GetWorld()->LineTraceSingleByChannel(Hit, TraceFrom, TraceTo, COLLISION_WEAPON, TraceParams);
 
+	// Characters with hitboxes don't block the trace, test those near the ray up to whatever it hit
+	const FVector HitboxTraceTo = Hit.bBlockingHit ? Hit.Location : TraceTo;
+	FCollisionQueryParams BroadphaseParams(SCENE_QUERY_STAT(WeaponHitboxBroadphase), false, Instigator);
+	TArray<FHitResult> Candidates;
+	GetWorld()->SweepMultiByObjectType(Candidates, TraceFrom, HitboxTraceTo, FQuat::Identity, FCollisionObjectQueryParams(ECC_Pawn), FCollisionShape::MakeSphere(AMCharacter::HitboxCapsuleMargin), BroadphaseParams);
+
+	AMCharacter* HitCharacter = nullptr;
+	FMHitboxHit HitboxHit;
+	float HitboxDistance = BIG_NUMBER;
+	TArray<AMCharacter*, TInlineAllocator<8>> TestedCharacters;
+	for (const FHitResult& Candidate : Candidates)
+	{
+		// Capsule and mesh of the same character are both found
+		AMCharacter* Character = Cast<AMCharacter>(Candidate.GetActor());
+		if (!Character || TestedCharacters.Contains(Character))
+		{
+			continue;
+		}
+		TestedCharacters.Add(Character);
+
+		FMHitboxHit CharacterHit;
+		if (!Character->IsPendingKill() && Character->RaycastHitboxes(TraceFrom, HitboxTraceTo, CharacterHit) && CharacterHit.Distance < HitboxDistance)
+		{
+			HitCharacter = Character;
+			HitboxHit = CharacterHit;
+			HitboxDistance = CharacterHit.Distance;
+		}
+	}
+
+	if (HitCharacter)
+	{
+		const float TraceLength = FVector::Dist(TraceFrom, TraceTo);
+
+		Hit = FHitResult(HitCharacter, HitCharacter->GetMesh(), HitboxHit.Location, HitboxHit.Normal);
+		Hit.bBlockingHit = true;
+		Hit.Time = TraceLength > 0.0f ? HitboxHit.Distance / TraceLength : 0.0f;
+		Hit.Distance = HitboxHit.Distance;
+		Hit.TraceStart = TraceFrom;
+		Hit.TraceEnd = TraceTo;
+		Hit.BoneName = HitboxHit.BoneName;
+		Hit.Item = HitboxHit.Index;
+	}
+
 	return Hit;
 }
 
@@ -519,6 +669,22 @@ void AMWeapon::SetWeaponState(EMWeaponState NewState)
 	{
 		OnBurstStarted();
 	}
+
+	if (PrevState != NewState)
+	{
+		UpdateNetDormancy();
+	}
+}
+
+void AMWeapon::UpdateNetDormancy()
+{
+	if (Role < ROLE_Authority)
+	{
+		return;
+	}
+
+	// Pending changes, such as burst counter reset, are still sent before the channel goes dormant
+	SetNetDormancy(CurrentState == EMWeaponState::Idle ? DORM_DormantAll : DORM_Awake);
 }
 
 void AMWeapon::OnBurstStarted()
@@ -593,6 +759,9 @@ void AMWeapon::SetOwnerCharacter(AMCharacter* NewOwner)
 {
 	if (OwnerCharacter != NewOwner)
 	{
+		// Wake up so new owner replicates even if weapon is dormant
+		FlushNetDormancy();
+
 		Instigator = NewOwner;
 		OwnerCharacter = NewOwner;
 		SetOwner(NewOwner);
@@ -0,0 +1,14 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MGravityWell.h"
+
+AMGravityWell::AMGravityWell()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("Root"));
+
+	InfluenceRadius = 50000.0f;
+	SurfaceRadius = 20000.0f;
+	RelevancyCellSize = 10000.0f;
+}
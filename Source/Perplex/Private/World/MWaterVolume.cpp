@@ -0,0 +1,166 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#include "MWaterVolume.h"
+#include "Components/BrushComponent.h"
+#include "Components/SceneComponent.h"
+
+namespace
+{
+	/**
+	* Times at which a segment crosses a sphere, unbounded.
+	*
+	* @return False if the line misses the sphere.
+	*/
+	bool IntersectSphere(const FVector& Start, const FVector& Direction, const FVector& Center, float Radius, float& OutNear, float& OutFar)
+	{
+		const FVector Offset = Start - Center;
+		const float A = Direction.SizeSquared();
+		const float B = Offset | Direction;
+		const float C = Offset.SizeSquared() - FMath::Square(Radius);
+		const float Discriminant = B * B - A * C;
+		if (A < SMALL_NUMBER || Discriminant < 0.0f)
+		{
+			return false;
+		}
+
+		const float Root = FMath::Sqrt(Discriminant);
+		OutNear = (-B - Root) / A;
+		OutFar = (-B + Root) / A;
+		return true;
+	}
+
+	/** Fraction of a segment inside a sphere */
+	float GetFractionInSphere(const FVector& Start, const FVector& End, const FVector& Center, float Radius)
+	{
+		float Near, Far;
+		if (!IntersectSphere(Start, End - Start, Center, Radius, Near, Far))
+		{
+			// Degenerate segments are either fully inside or outside.
+			return (FVector::DistSquared(Start, Center) <= FMath::Square(Radius)) ? 1.0f : 0.0f;
+		}
+		return FMath::Clamp(FMath::Min(Far, 1.0f) - FMath::Max(Near, 0.0f), 0.0f, 1.0f);
+	}
+}
+
+FMWaterSphere::FMWaterSphere(const FVector& InCenter, float InSurfaceRadius, float InCoreRadius)
+	: Center(InCenter)
+	, SurfaceRadius(InSurfaceRadius)
+	, CoreRadius(FMath::Min(InCoreRadius, InSurfaceRadius))
+{
+}
+
+float FMWaterSphere::GetDistanceToWater(const FVector& Point) const
+{
+	const float Distance = FVector::Dist(Point, Center);
+	return FMath::Max(Distance - SurfaceRadius, CoreRadius - Distance);
+}
+
+float FMWaterSphere::GetImmersion(const FVector& Start, const FVector& End) const
+{
+	float Immersion = GetFractionInSphere(Start, End, Center, SurfaceRadius);
+	if (CoreRadius > 0.0f)
+	{
+		// The core is inside the surface sphere, its part of the segment is dry.
+		Immersion -= GetFractionInSphere(Start, End, Center, CoreRadius);
+	}
+	return FMath::Clamp(Immersion, 0.0f, 1.0f);
+}
+
+AMWaterVolume::AMWaterVolume(const FObjectInitializer& ObjectInitializer)
+	: Super(ObjectInitializer)
+{
+	bWaterVolume = true;
+	FluidFriction = 0.3f;
+
+	SurfaceShape = EMWaterSurfaceShape::Plane;
+	SurfaceRadius = 20000.0f;
+	InnerRadius = 0.0f;
+	LocalSurfaceHeight = 0.0f;
+}
+
+void AMWaterVolume::PostInitializeComponents()
+{
+	Super::PostInitializeComponents();
+
+	const UBrushComponent* Brush = GetBrushComponent();
+	if (Brush)
+	{
+		const FBoxSphereBounds LocalBounds = Brush->CalcBounds(FTransform::Identity);
+		LocalSurfaceHeight = LocalBounds.Origin.Z + LocalBounds.BoxExtent.Z;
+	}
+}
+
+bool AMWaterVolume::EncompassesPoint(FVector Point, float SphereRadius, float* OutDistanceToPoint) const
+{
+	if (!Super::EncompassesPoint(Point, SphereRadius, OutDistanceToPoint))
+	{
+		return false;
+	}
+
+	if (SurfaceShape != EMWaterSurfaceShape::Sphere && SurfaceShape != EMWaterSurfaceShape::Shell)
+	{
+		return true;
+	}
+
+	const float DistanceToWater = GetWaterSphere().GetDistanceToWater(Point);
+	if (DistanceToWater > SphereRadius)
+	{
+		if (OutDistanceToPoint)
+		{
+			*OutDistanceToPoint = DistanceToWater;
+		}
+		return false;
+	}
+	return true;
+}
+
+bool AMWaterVolume::IsOverlapInVolume(const USceneComponent& TestComponent) const
+{
+	if (!Super::IsOverlapInVolume(TestComponent))
+	{
+		return false;
+	}
+
+	if (SurfaceShape != EMWaterSurfaceShape::Sphere && SurfaceShape != EMWaterSurfaceShape::Shell)
+	{
+		return true;
+	}
+
+	return GetWaterSphere().GetDistanceToWater(TestComponent.GetComponentLocation()) <= 0.0f;
+}
+
+FMWaterSphere AMWaterVolume::GetWaterSphere() const
+{
+	return FMWaterSphere(GetActorLocation(), SurfaceRadius, SurfaceShape == EMWaterSurfaceShape::Shell ? InnerRadius : 0.0f);
+}
+
+float AMWaterVolume::GetImmersion(const FVector& Start, const FVector& End) const
+{
+	switch (SurfaceShape)
+	{
+	case EMWaterSurfaceShape::Plane:
+	{
+		const FVector Up = GetActorUpVector();
+		const FVector SurfacePoint = GetActorTransform().TransformPosition(FVector(0.0f, 0.0f, LocalSurfaceHeight));
+		const float StartHeight = (Start - SurfacePoint) | Up;
+		const float EndHeight = (End - SurfacePoint) | Up;
+		if (StartHeight <= 0.0f && EndHeight <= 0.0f)
+		{
+			return 1.0f;
+		}
+		if (StartHeight >= 0.0f && EndHeight >= 0.0f)
+		{
+			return 0.0f;
+		}
+		const float CrossingTime = StartHeight / (StartHeight - EndHeight);
+		return (StartHeight > 0.0f) ? (1.0f - CrossingTime) : CrossingTime;
+	}
+	case EMWaterSurfaceShape::Sphere:
+	case EMWaterSurfaceShape::Shell:
+	{
+		return GetWaterSphere().GetImmersion(Start, End);
+	}
+	default:
+		return 1.0f;
+	}
+}
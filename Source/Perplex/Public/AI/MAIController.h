@@ -0,0 +1,53 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "AIController.h"
+#include "MAIController.generated.h"
+
+class AMCharacter;
+
+/**
+ * Controller of bots.
+ * Targets are selected by FMAITargetingService of the game mode, the controller only faces and fires at them.
+ */
+UCLASS()
+class PERPLEX_API AMAIController : public AAIController
+{
+	GENERATED_BODY()
+
+public:
+	AMAIController(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	virtual void UnPossess() override;
+
+	/** Set the target and whether it is in line of sight */
+	void SetTarget(AMCharacter* NewTarget, bool bNewTargetVisible);
+
+	FORCEINLINE AMCharacter* GetTarget() const { return Target.Get(); }
+
+	FORCEINLINE bool IsTargetVisible() const { return bTargetVisible; }
+
+	/** Direction to fire from Origin, exactly at a visible target, aim error comes from weapon spread */
+	FVector GetAimDirection(const FVector& Origin) const;
+
+protected:
+	/** Seconds a target has to be in line of sight before firing at it */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "0"))
+	float ReactionTime;
+
+private:
+	TWeakObjectPtr<AMCharacter> Target;
+
+	bool bTargetVisible;
+
+	/** World time the target came into line of sight */
+	float TargetVisibleTime;
+};
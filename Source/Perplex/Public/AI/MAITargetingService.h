@@ -0,0 +1,108 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "GenericTeamAgentInterface.h"
+#include "MAITargetingService.generated.h"
+
+class UWorld;
+class AMCharacter;
+class AMAIController;
+struct FMTeamRegistry;
+class FMCharacterHash;
+
+/** Tuning of bot target selection */
+USTRUCT()
+struct FMAITargetingSettings
+{
+	GENERATED_BODY()
+
+	/** If false, bots don't select targets */
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	bool bEnabled;
+
+	/** Enemies closer than this are candidate targets, also the character hash cell size */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "1"))
+	float SearchRadius;
+
+	/** Closest enemies kept as candidates per bot */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "1"))
+	int32 MaxCandidates;
+
+	/** Line of sight to a candidate is traced again after this many seconds */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "0"))
+	float VisibilityRefreshInterval;
+
+	/** Microseconds per frame for line of sight traces, at least one trace runs each frame */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "0"))
+	float TraceBudgetMicroseconds;
+
+	FMAITargetingSettings();
+};
+
+/**
+ * Target selection for bots.
+ * Candidates are the closest enemies from the game mode's character hash. Line of sight traces to candidates are
+ * queued oldest first and time-sliced within a frame budget, so the cost stays flat as bots are added and results
+ * are at most a few frames old. Each bot targets the closest visible candidate.
+ */
+class PERPLEX_API FMAITargetingService
+{
+public:
+	FMAITargetingService();
+
+	void Tick(UWorld* World, const FMCharacterHash& CharacterHash, const FMAITargetingSettings& Settings);
+
+	/** Line of sight traces done in the last tick */
+	FORCEINLINE int32 GetNumTraces() const { return NumTraces; }
+
+	/** Stale candidates left for later ticks in the last tick */
+	FORCEINLINE int32 GetNumDeferredTraces() const { return NumDeferredTraces; }
+
+private:
+	struct FCandidate
+	{
+		TWeakObjectPtr<AMCharacter> Character;
+
+		float DistanceSq;
+
+		bool bVisible;
+
+		/** World time of the last line of sight trace */
+		float LastTraceTime;
+	};
+
+	struct FBot
+	{
+		/** Candidates sorted by distance */
+		TArray<FCandidate> Candidates;
+	};
+
+	struct FPendingTrace
+	{
+		AMAIController* Controller;
+
+		FCandidate* Candidate;
+	};
+
+	/** Find closest enemies of a bot, keeping line of sight results of previous candidates */
+	void UpdateCandidates(AMCharacter* Character, FBot& Bot, const FMCharacterHash& CharacterHash, const FMTeamRegistry& TeamRegistry, const FMAITargetingSettings& Settings);
+
+	/** Trace stale candidates oldest first until the budget runs out */
+	void TraceVisibility(UWorld* World, float Time, const FMAITargetingSettings& Settings);
+
+	/** Pick the closest visible candidate, or keep facing the last target while it is a candidate */
+	void SelectTarget(AMAIController* Controller, const FBot& Bot) const;
+
+	TMap<TWeakObjectPtr<AMAIController>, FBot> Bots;
+
+	/** Enemies of the bot being updated, kept to reuse the allocation */
+	TArray<AMCharacter*> Enemies;
+
+	TArray<FPendingTrace> PendingTraces;
+
+	int32 NumTraces;
+
+	int32 NumDeferredTraces;
+};
@@ -0,0 +1,102 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "MCrowdAvoidance.generated.h"
+
+class UWorld;
+class UMCharacterMovementComponent;
+
+/** Tuning of local-up crowd avoidance */
+USTRUCT()
+struct FMCrowdAvoidanceSettings
+{
+	GENERATED_BODY()
+
+	/** If false, path following requests are used as is */
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	bool bEnabled;
+
+	/** Characters closer than this are considered by avoidance, also the spatial hash cell size */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "1"))
+	float NeighborRadius;
+
+	/** Closest neighbors considered per agent */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "1"))
+	int32 MaxNeighbors;
+
+	/** Collisions further in the future than this are ignored, in seconds */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "0.1"))
+	float TimeHorizon;
+
+	/** Candidate directions sampled around the preferred velocity */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "4"))
+	int32 NumSampleDirections;
+
+	/** Candidate speeds sampled per direction */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "1"))
+	int32 NumSampleSpeeds;
+
+	/** Cost of deviating from the preferred velocity relative to collision cost */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "0"))
+	float PreferredVelocityWeight;
+
+	/** Below this many agents solving isn't worth spreading across threads */
+	UPROPERTY(EditDefaultsOnly, Category = "AI", meta = (ClampMin = "1"))
+	int32 MinAgentsForParallel;
+
+	FMCrowdAvoidanceSettings();
+};
+
+/**
+ * Velocity avoidance for characters walking on arbitrary surfaces.
+ * Neighbors come from a spatial hash and are projected into each agent's tangent plane, defined by its capsule up axis,
+ * so avoidance keeps working on planets and walls. Agents are solved in parallel and results are fed back to
+ * path following requests of UMCharacterMovementComponent.
+ */
+class PERPLEX_API FMCrowdAvoidance
+{
+public:
+	FMCrowdAvoidance();
+
+	void Tick(UWorld* World, const FMCrowdAvoidanceSettings& Settings);
+
+	/** Agents solved in the last tick */
+	FORCEINLINE int32 GetNumAgents() const { return NumSolvedAgents; }
+
+private:
+	struct FCellRange
+	{
+		int32 Start;
+
+		int32 Num;
+	};
+
+	/** Solve a single agent, reads shared agent arrays and writes only its own result */
+	void SolveAgent(int32 Agent, const FMCrowdAvoidanceSettings& Settings);
+
+	FIntVector GetCell(const FVector& Location, float CellSize) const;
+
+	/** Agents are stored as separate arrays, every character is an obstacle but only some are solved */
+	TArray<FVector> Locations;
+	TArray<FVector> Velocities;
+	TArray<FVector> Ups;
+	TArray<float> Radii;
+	TArray<FVector> PreferredVelocities;
+	TArray<float> MaxSpeeds;
+	TArray<FVector> Results;
+	TArray<FIntVector> AgentCells;
+	TArray<UMCharacterMovementComponent*> Movements;
+
+	/** Indices of agents to solve */
+	TArray<int32> SolvedAgents;
+
+	/** Agent indices sorted by cell */
+	TArray<int32> SortedAgents;
+
+	/** Range of SortedAgents per cell */
+	TMap<FIntVector, FCellRange> Cells;
+
+	int32 NumSolvedAgents;
+};
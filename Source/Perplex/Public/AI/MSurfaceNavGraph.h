@@ -0,0 +1,190 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "Engine/EngineTypes.h"
+#include "MSurfaceNavGraph.generated.h"
+
+class UWorld;
+class AMGravityWell;
+
+/** Sampling and connection settings of a surface navigation graph */
+USTRUCT()
+struct FMSurfaceNavSettings
+{
+	GENERATED_BODY()
+
+	/** Spacing of the sampling lattice, roughly the distance between nodes */
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (ClampMin = "10"))
+	float CellSize;
+
+	/** Nodes are placed this far above the surface, should match the character's half height */
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (ClampMin = "0"))
+	float NodeHeight;
+
+	/** Radius of free space required above a node */
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (ClampMin = "0"))
+	float AgentRadius;
+
+	/** Steepest walkable surface and edge relative to local gravity, in degrees */
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (ClampMin = "0", ClampMax = "90"))
+	float MaxSlopeAngle;
+
+	/** Largest angle between up vectors of connected nodes, in degrees */
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (ClampMin = "0", ClampMax = "180"))
+	float MaxEdgeAngle;
+
+	/** If true, surfaces are sampled along all axes so walls and ceilings get nodes regardless of gravity */
+	UPROPERTY(EditAnywhere, Category = "Navigation")
+	bool bSampleWalls;
+
+	/** Extra edge cost for changing surface orientation, relative to edge length */
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (ClampMin = "0"))
+	float TurnCost;
+
+	/** Channel used to sample surfaces and test edge visibility */
+	UPROPERTY(EditAnywhere, Category = "Navigation")
+	TEnumAsByte<ECollisionChannel> TraceChannel;
+
+	FMSurfaceNavSettings();
+};
+
+/** Point on a walkable surface */
+USTRUCT()
+struct FMSurfaceNavNode
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector Location;
+
+	/** Surface normal, path followers align gravity opposite to it */
+	UPROPERTY()
+	FVector Up;
+};
+
+/**
+ * Navigation graph sampled from level collision, for surfaces where world up doesn't apply, such as planets and walls.
+ * Edges are stored in flat neighbor arrays and searched with A* over a binary heap, search state is reused between queries.
+ */
+USTRUCT()
+struct PERPLEX_API FMSurfaceNavGraph
+{
+	GENERATED_BODY()
+
+public:
+	FMSurfaceNavGraph();
+
+	/** Sample collision inside bounds and connect the nodes */
+	void Build(UWorld* World, const FBox& InBounds, const FMSurfaceNavSettings& Settings);
+
+	/**
+	* Resample cells overlapping the region and reconnect them, the rest of the graph is kept.
+	* @note Node indices change, compare GetVersion() to detect it.
+	*/
+	void RebuildRegion(UWorld* World, const FBox& Region, const FMSurfaceNavSettings& Settings);
+
+	/** Rebuild the cell lookup, which isn't serialized */
+	void RebuildCellLookup();
+
+	/** Shift nodes after the world origin moved */
+	void ApplyWorldOffset(const FVector& InOffset);
+
+	/** Closest node in the cells around location, or INDEX_NONE */
+	int32 FindNearestNode(const FVector& Location) const;
+
+	/**
+	* Find the cheapest path between two nodes.
+	*
+	* @param OutPath - Node indices from start to goal.
+	* @param MaxExpandedNodes - Search gives up after expanding this many nodes, zero for no limit.
+	* @return True if goal was reached.
+	*/
+	bool FindPath(int32 StartNode, int32 GoalNode, TArray<int32>& OutPath, int32 MaxExpandedNodes = 0) const;
+
+	void Reset();
+
+	FORCEINLINE const FMSurfaceNavNode& GetNode(int32 Index) const { return Nodes[Index]; }
+
+	FORCEINLINE int32 NumNodes() const { return Nodes.Num(); }
+
+	FORCEINLINE int32 NumEdges() const { return Neighbors.Num(); }
+
+	/** Changes on every build, node indices from an older version are invalid */
+	FORCEINLINE int32 GetVersion() const { return Version; }
+
+private:
+	struct FEdge
+	{
+		int32 Node;
+
+		float Cost;
+	};
+
+	struct FSearchNode
+	{
+		float Cost;
+
+		int32 Parent;
+
+		/** Search this state belongs to, older states are treated as unvisited */
+		uint32 SearchId;
+
+		bool bClosed;
+	};
+
+	struct FOpenNode
+	{
+		float EstimatedCost;
+
+		int32 Node;
+	};
+
+	FIntVector GetCell(const FVector& Location) const;
+
+	/** Sample surfaces in cells from Min to Max inclusive and append found nodes */
+	void SampleCells(UWorld* World, const FIntVector& Min, const FIntVector& Max, const FMSurfaceNavSettings& Settings, TArray<FMSurfaceNavNode>& OutNodes) const;
+
+	/**
+	* Connect a node to nodes in neighboring cells.
+	*
+	* @param bReconnect - Nodes being reconnected, edges between two of them are added by the lower index only.
+	*/
+	void ConnectNode(UWorld* World, int32 Index, const TArray<bool>& bReconnect, const FMSurfaceNavSettings& Settings, TArray<TArray<FEdge>>& Adjacency) const;
+
+	/** Flatten adjacency lists into neighbor arrays */
+	void Pack(const TArray<TArray<FEdge>>& Adjacency);
+
+	UPROPERTY()
+	TArray<FMSurfaceNavNode> Nodes;
+
+	/** Edges of node i are in [NeighborOffsets[i], NeighborOffsets[i + 1]) */
+	UPROPERTY()
+	TArray<int32> NeighborOffsets;
+
+	UPROPERTY()
+	TArray<int32> Neighbors;
+
+	UPROPERTY()
+	TArray<float> EdgeCosts;
+
+	UPROPERTY()
+	FBox Bounds;
+
+	UPROPERTY()
+	float CellSize;
+
+	UPROPERTY()
+	int32 Version;
+
+	/** Nodes by lattice cell */
+	TMultiMap<FIntVector, int32> CellNodes;
+
+	/** Search state reused between queries */
+	mutable TArray<FSearchNode> SearchNodes;
+
+	mutable TArray<FOpenNode> OpenNodes;
+
+	mutable uint32 SearchId;
+};
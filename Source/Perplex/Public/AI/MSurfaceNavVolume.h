@@ -0,0 +1,75 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "GameFramework/Volume.h"
+#include "AI/MSurfaceNavGraph.h"
+#include "MSurfaceNavVolume.generated.h"
+
+/**
+ * Region covered by a surface navigation graph.
+ * The graph is built in the editor and saved with the level. On the server, movable obstacles inside the volume
+ * are watched and regions they leave or enter are rebuilt incrementally as deferred work.
+ */
+UCLASS()
+class PERPLEX_API AMSurfaceNavVolume : public AVolume
+{
+	GENERATED_BODY()
+
+public:
+	AMSurfaceNavVolume(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	virtual void BeginPlay() override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+
+	/** Sample level collision inside the volume and build the graph */
+	UFUNCTION(CallInEditor, Category = "Navigation")
+	void BuildGraph();
+
+	/** Queue an incremental rebuild of a region, e.g. after geometry moved */
+	void MarkDirty(const FBox& Region);
+
+	/** Volume containing the location, or null */
+	static AMSurfaceNavVolume* FindVolume(UWorld* World, const FVector& Location);
+
+	FORCEINLINE const FMSurfaceNavGraph& GetGraph() const { return Graph; }
+
+protected:
+	UPROPERTY(EditAnywhere, Category = "Navigation")
+	FMSurfaceNavSettings Settings;
+
+	/** Seconds between checks of movable obstacles */
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (ClampMin = "0"))
+	float ObstacleCheckInterval;
+
+	/** Obstacles have to move farther than this to trigger a rebuild */
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (ClampMin = "0"))
+	float ObstacleMoveTolerance;
+
+private:
+	/** Rebuild all queued regions */
+	void RebuildDirtyRegions();
+
+	UPROPERTY()
+	FMSurfaceNavGraph Graph;
+
+	struct FObstacle
+	{
+		TWeakObjectPtr<AActor> Actor;
+
+		/** Bounds the graph was last built with */
+		FBox Bounds;
+	};
+
+	TArray<FObstacle> Obstacles;
+
+	TArray<FBox> DirtyRegions;
+
+	float TimeSinceObstacleCheck;
+
+	bool bRebuildPending;
+};
@@ -0,0 +1,73 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "Components/ActorComponent.h"
+#include "MSurfacePathFollowingComponent.generated.h"
+
+class APawn;
+class AMSurfaceNavVolume;
+class UMCharacterMovementComponent;
+
+/**
+ * Moves a pawn along paths on a surface navigation graph.
+ * Can be owned by the pawn or its controller. Only ticks while following a path.
+ */
+UCLASS(ClassGroup = AI, meta = (BlueprintSpawnableComponent))
+class PERPLEX_API UMSurfacePathFollowingComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UMSurfacePathFollowingComponent();
+
+	virtual void TickComponent(float DeltaTime, enum ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+
+	/**
+	* Find a path to the goal and start following it.
+	*
+	* @return False if there is no path.
+	*/
+	UFUNCTION(BlueprintCallable, Category = "AI|Navigation")
+	bool MoveToLocation(const FVector& Goal);
+
+	UFUNCTION(BlueprintCallable, Category = "AI|Navigation")
+	void StopMovement();
+
+	UFUNCTION(BlueprintCallable, Category = "AI|Navigation")
+	bool IsFollowingPath() const;
+
+	FORCEINLINE const FVector& GetGoalLocation() const { return GoalLocation; }
+
+protected:
+	/** Distance along the surface at which a path point counts as reached */
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (ClampMin = "0"))
+	float AcceptanceRadius;
+
+	/** Nodes a single search may expand, bounds the cost of unreachable goals, zero for no limit */
+	UPROPERTY(EditAnywhere, Category = "Navigation", meta = (ClampMin = "0"))
+	int32 MaxSearchNodes;
+
+private:
+	APawn* GetPawn() const;
+
+	UMCharacterMovementComponent* GetMovement() const;
+
+	/** Search a path from the pawn to GoalLocation */
+	bool FindPath();
+
+	TWeakObjectPtr<AMSurfaceNavVolume> Volume;
+
+	/** Node indices, valid for GraphVersion */
+	TArray<int32> Path;
+
+	/** Path point being moved to, Path.Num() is the goal itself */
+	int32 PathIndex;
+
+	FVector GoalLocation;
+
+	int32 GraphVersion;
+};
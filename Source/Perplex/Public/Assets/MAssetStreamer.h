@@ -0,0 +1,75 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "Engine/StreamableManager.h"
+
+/** Order of async loads, higher priority requests are serviced first */
+enum class EMAssetStreamPriority : uint8
+{
+	/** Loadouts streamed ahead of use */
+	Preload,
+	/** Effects of spawned actors */
+	Cosmetic,
+	/** Assets gameplay is waiting for */
+	Gameplay
+};
+
+/**
+ * Async streaming of soft referenced content.
+ * Nothing is loaded synchronously, callers hold the returned handle to keep assets in memory and skip work
+ * that needs an asset until it arrives.
+ */
+class PERPLEX_API FMAssetStreamer
+{
+public:
+	/** Streamable manager of the engine's asset manager */
+	static FStreamableManager& GetStreamableManager();
+
+	/**
+	* Request async load of assets, null paths are ignored.
+	*
+	* @param Callback - Called once all assets are loaded, immediately if they already are.
+	* @return Handle keeping the assets loaded, null if there was nothing to load.
+	*/
+	static TSharedPtr<FStreamableHandle> RequestLoad(const TArray<FSoftObjectPath>& Paths, EMAssetStreamPriority Priority, FStreamableDelegate Callback = FStreamableDelegate());
+
+	/** Add path of a soft reference if it is set */
+	template<typename T>
+	static void AddPath(TArray<FSoftObjectPath>& OutPaths, const T& SoftPtr)
+	{
+		if (!SoftPtr.IsNull())
+		{
+			OutPaths.AddUnique(SoftPtr.ToSoftObjectPath());
+		}
+	}
+
+	/** Asset of a soft reference if loaded, otherwise null without blocking so callers skip it */
+	template<typename T>
+	static T* GetLoaded(const TSoftObjectPtr<T>& SoftPtr)
+	{
+		T* Asset = SoftPtr.Get();
+		if (!Asset && !SoftPtr.IsNull())
+		{
+			NoteLateAsset(SoftPtr.ToSoftObjectPath());
+		}
+		return Asset;
+	}
+
+	/** Class of a soft reference if loaded, otherwise null without blocking so callers skip it */
+	template<typename T>
+	static UClass* GetLoaded(const TSoftClassPtr<T>& SoftPtr)
+	{
+		UClass* Class = SoftPtr.Get();
+		if (!Class && !SoftPtr.IsNull())
+		{
+			NoteLateAsset(SoftPtr.ToSoftObjectPath());
+		}
+		return Class;
+	}
+
+private:
+	/** Count an asset that was needed before it was loaded */
+	static void NoteLateAsset(const FSoftObjectPath& Path);
+};
@@ -4,11 +4,27 @@
 
 #include "Perplex.h"
 #include "GameFramework/Character.h"
+#include "GenericTeamAgentInterface.h"
+#include "Engine/StreamableManager.h"
+#include "Net/MRepMovement.h"
+#include "Characters/MHitboxSet.h"
+#include "Hex/MHex.h"
 #include "MCharacter.generated.h"
 
 class UMCharacterMovementComponent;
 class AMWeapon;
 
+/** Movement input state packed into a single replicated byte for simulated proxies */
+namespace EMMovementFlags
+{
+	enum Type : uint8
+	{
+		None = 0,
+		WantsToRun = 1 << 0,
+		IsAiming = 1 << 1
+	};
+}
+
 /** Replicated information on a hit we've taken */
 USTRUCT()
 struct FMTakeHitInfo
@@ -67,7 +83,7 @@ public:
 };
 
 UCLASS()
-class PERPLEX_API AMCharacter : public ACharacter
+class PERPLEX_API AMCharacter : public ACharacter, public IGenericTeamAgentInterface
 {
 	GENERATED_BODY()
 
@@ -86,6 +102,18 @@ public:
 
 	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	virtual bool CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack) override;
+
+	virtual void ProcessEvent(UFunction* Function, void* Parameters) override;
+
+	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
+
+	virtual void PossessedBy(AController* NewController) override;
+
+	virtual void UnPossessed() override;
+
 public: // Weapon usage
 
 	/** Starts weapon fire */
@@ -103,6 +131,27 @@ public: // Weapon usage
 	/** Stops aiming */
 	void StopAim();
 
+	/**
+	* Evaluate the third person pose on a dedicated server, at most once per ServerPoseRefreshInterval.
+	* Call before reading bone or socket transforms that gameplay depends on, e.g. weapon muzzles.
+	*/
+	void RefreshServerPose();
+
+	/** Check if weapon traces test Hitboxes instead of mesh collision */
+	FORCEINLINE bool UsesHitboxes() const { return Hitboxes.Num() > 0; }
+
+	/** Find the closest hitbox hit by a segment, posing hitboxes at most once per frame */
+	bool RaycastHitboxes(const FVector& Start, const FVector& End, FMHitboxHit& OutHit);
+
+	/** Distance from a segment to a hitbox by index, posing hitboxes at most once per frame */
+	float GetHitboxDistance(int32 HitboxIndex, const FVector& Start, const FVector& End);
+
+	/** Zone of a hitbox by index, as in FMHitboxHit::Index, body if there is none */
+	EMHitZone GetHitZone(int32 HitboxIndex) const;
+
+	/** Hitboxes stay within this distance of the capsule, weapon traces find characters to test by sweeping it */
+	static const float HitboxCapsuleMargin;
+
 public: // Movement
 
 	void LaunchCharacterRotated(FVector LaunchVelocity, bool bHorizontalOverride, bool bVerticalOverride);
@@ -123,6 +172,9 @@ public: // Movement
 
 	void StopRun();
 
+	/** Applies run and aim state carried by saved move flags */
+	void ApplyMovementFlags(bool bNewWantsToRun, bool bNewIsAiming);
+
 public: // Animations
 
 	virtual float PlayAnimMontage(class UAnimMontage* AnimMontage, float InPlayRate = 1.f, FName StartSectionName = NAME_None) override;
@@ -131,8 +183,14 @@ public: // Animations
 
 	void StopAllAnimMontages();
 
+	/** Weapon spawned with, preloaded with loadouts */
+	FORCEINLINE const TSoftClassPtr<AMWeapon>& GetStartWeaponClass() const { return StartWeaponClass; }
+
 protected: // Inventory
 
+	/** Spawn and equip the starting weapon, once its class has streamed in */
+	void SpawnStartWeapon();
+
 	/** Equips weapon from inventory */
 	void EquipWeapon(class AMWeapon* Weapon);
 
@@ -173,6 +231,21 @@ protected: // Hex
 
 	virtual bool Die(float KillingDamage, struct FDamageEvent const& DamageEvent, class AController* Killer, class AActor* DamageCauser);
 
+	/** Modules equipped on spawn */
+	UPROPERTY(EditDefaultsOnly, Category = "Hex")
+	TArray<FMHexModule> DefaultHexModules;
+
+	/** Equipped modules and cached stats, modules are only known on the server */
+	FMHex Hex;
+
+	/** Derived stats of Hex, only stats that changed are sent */
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_HexStats)
+	FMHexStatArray HexStats;
+
+	/** Caches replicated hex stats */
+	UFUNCTION()
+	void OnRep_HexStats();
+
 	/** Die when we fall out of the world */
 	virtual void FellOutOfWorld(const class UDamageType& dmgType) override;
 
@@ -194,7 +267,7 @@ protected:
 
 	/** Starting weapon */
 	UPROPERTY(EditDefaultsOnly, Category = "Weapon")
-	TSubclassOf<AMWeapon> StartWeaponClass;
+	TSoftClassPtr<AMWeapon> StartWeaponClass;
 
 	/** Currently equipped weapon */
 	UPROPERTY(Transient, ReplicatedUsing = OnRep_CurrentWeapon)
@@ -206,11 +279,41 @@ protected:
 
 	/** Animation played on termination */
 	UPROPERTY(EditDefaultsOnly, Category = "Animation")
-	UAnimMontage* TerminationAnimation;
+	TSoftObjectPtr<UAnimMontage> TerminationAnimation;
+
+	/** Keeps streamed character assets loaded */
+	TSharedPtr<FStreamableHandle> StreamedAssetsHandle;
+
+	/** Keeps the starting weapon class loaded while it streams */
+	TSharedPtr<FStreamableHandle> StartWeaponHandle;
 
 	/** Time at which point the last take hit info for the actor times out and won't be replicated; Used to stop join-in-progress effects all over the screen */
 	float LastTakeHitTimeTimeout;
 
+	/** Minimum time between on-demand pose updates on dedicated servers, which don't tick poses otherwise */
+	UPROPERTY(EditDefaultsOnly, Category = "Mesh", meta = (ClampMin = "0"))
+	float ServerPoseRefreshInterval;
+
+	/** If true, third person meshes of other players update less often when small on screen */
+	UPROPERTY(EditDefaultsOnly, Category = "Mesh")
+	bool bUseMeshUpdateRateOptimizations;
+
+	/** Time of the last on-demand pose update on a dedicated server */
+	float LastServerPoseRefreshTime;
+
+	/** Shapes hit by weapons, if empty weapon traces hit mesh collision instead */
+	UPROPERTY(EditDefaultsOnly, Category = "Hitboxes")
+	TArray<FMHitboxDefinition> Hitboxes;
+
+	/** Hitboxes posed for hit registration */
+	FMHitboxSet HitboxSet;
+
+	/** Frame HitboxSet was last posed on */
+	uint64 HitboxUpdateFrame;
+
+	/** Pose HitboxSet from the current mesh pose, once per frame */
+	void UpdateHitboxes();
+
 	UMCharacterMovementComponent* CharacterMovement;
 
 	bool bWantsToRun;
@@ -239,6 +342,30 @@ protected:
 	UFUNCTION()
 	void OnRep_LastTakeHitInfo();
 
+	/** Movement replicated to simulated proxies in place of ReplicatedMovement */
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_MRepMovement)
+	FMRepMovement MRepMovement;
+
+	/** Quantization tier of replicated movement */
+	UPROPERTY(EditDefaultsOnly, Category = "Replication")
+	EMRepMovementPrecision MovementPrecision;
+
+	/** Forwards quantized movement to the engine replicated movement path */
+	UFUNCTION()
+	void OnRep_MRepMovement();
+
+	/** Run and aim state for simulated proxies, owners send it with their moves */
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_MovementFlags)
+	uint8 PackedMovementFlags;
+
+	/** Unpacks replicated movement flags */
+	UFUNCTION()
+	void OnRep_MovementFlags();
+
+	/** Team of the possessing controller, none while unpossessed */
+	UPROPERTY(Transient, Replicated)
+	FGenericTeamId TeamId;
+
 public: // Getters and setters
 	UFUNCTION(BlueprintCallable, Category = "Character")
 	bool IsMoving() const;
@@ -252,6 +379,9 @@ public: // Getters and setters
 	UFUNCTION(BlueprintCallable, Category = "Character")
 	bool IsAiming() const;
 
+	/** Returns true if run input is held, regardless of current velocity */
+	bool WantsToRun() const;
+
 	UFUNCTION(BlueprintCallable, Category = "Weapon")
 	AMWeapon* GetWeapon() const;
 
@@ -263,13 +393,31 @@ public: // Getters and setters
 
 	virtual FVector GetPawnViewLocation() const override;
 
+	/** Check if a controller is hostile to this character, a bit test against the team registry */
 	bool IsEnemyFor(AController* TestController) const;
 
+	/** Check if another character is hostile to this one */
+	bool IsEnemyOf(const AMCharacter* Other) const;
+
+	virtual FGenericTeamId GetGenericTeamId() const override { return TeamId; }
+
+	/** Copy the team of the possessing controller, pooled pawns change teams with their controller */
+	void UpdateTeam();
+
 	bool IsFirstPerson() const;
 
 	UFUNCTION(BlueprintCallable, Category = "Character")
 	float GetHealth() const;
 
+	/** Stats derived from hex modules, cached whenever modules change */
+	FORCEINLINE const FMHexStats& GetHexStats() const { return Hex.GetStats(); }
+
+	/** Equip a hex module, server only */
+	void EquipHexModule(const FMHexModule& Module);
+
+	/** Unequip a hex module by name, server only */
+	bool UnequipHexModule(FName Name);
+
 	USkeletalMeshComponent* GetFirstPersonMesh() const;
 
 	USkeletalMeshComponent* GetThirdPersonMesh() const;
@@ -278,13 +426,9 @@ public: // Getters and setters
 	USkeletalMeshComponent* GetCharacterMesh() const;
 
 private:
+	/** Sets local aim state, the server receives it through saved move flags */
 	void SetAiming(bool bNewAiming);
 
-	UFUNCTION(Reliable, Server, WithValidation)
-	void ServerSetAiming(bool bNewAiming);
-
+	/** Sets local run state, the server receives it through saved move flags */
 	void SetRunning(bool bNewRunning, bool bToggle);
-
-	UFUNCTION(Reliable, Server, WithValidation)
-	void ServerSetRunning(bool bNewRunning, bool bToggle);
 };
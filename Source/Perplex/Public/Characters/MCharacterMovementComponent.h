@@ -4,8 +4,68 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "Net/MSnapshotBuffer.h"
 #include "MCharacterMovementComponent.generated.h"
 
+/** Gravity configuration of a movement component, resolved when it changes rather than on every query */
+UENUM()
+enum class EMGravityMode : uint8
+{
+	/** World gravity along -Z with an upright capsule, uses stock character movement */
+	WorldZ,
+	/** Fixed custom gravity direction */
+	Direction,
+	/** Pulled towards GravityPoint */
+	Point,
+	/** Custom gravity direction that follows the floor */
+	Floor,
+	/** Zero or reversed gravity, checked on every query */
+	Generic
+};
+
+/** Saved move that also carries aiming and running state, so it is timestamped with the move it affects */
+class PERPLEX_API FSavedMove_MCharacter : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	enum EMCompressedFlags
+	{
+		/** Character wants to run */
+		FLAG_WantsToRun = FLAG_Custom_0,
+
+		/** Character is aiming */
+		FLAG_IsAiming = FLAG_Custom_1,
+	};
+
+	/** Was the character running during this move? */
+	uint32 bSavedWantsToRun : 1;
+
+	/** Was the character aiming during this move? */
+	uint32 bSavedIsAiming : 1;
+
+	virtual void Clear() override;
+
+	virtual uint8 GetCompressedFlags() const override;
+
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* Character, float MaxDelta) const override;
+
+	virtual void SetMoveFor(ACharacter* Character, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+
+	virtual void PrepMoveFor(ACharacter* Character) override;
+};
+
+/** Client prediction data which allocates FSavedMove_MCharacter moves */
+class PERPLEX_API FNetworkPredictionData_Client_MCharacter : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_MCharacter(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
+
 UCLASS()
 class PERPLEX_API UMCharacterMovementComponent : public UCharacterMovementComponent
 {
@@ -14,6 +74,10 @@ class PERPLEX_API UMCharacterMovementComponent : public UCharacterMovementCompon
 public:
 	UMCharacterMovementComponent();
 
+	virtual bool CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack) override;
+
+	virtual void ProcessEvent(UFunction* Function, void* Parameters) override;
+
 	/**
 	* Perform jump. Called by Character when a jump has been detected because Character->bPressedJump was true. Checks CanJump().
 	* Note that you should usually trigger a jump through Character::Jump() instead.
@@ -73,6 +137,28 @@ public:
 	/** Update controller's view rotation as pawn's base rotates */
 	virtual void UpdateBasedRotation(FRotator& FinalRotation, const FRotator& ReducedRotation) override;
 
+	/**
+	* If true, the pose on a moving base is kept in the base's local frame. While the character doesn't move on a
+	* rigidly moving base, the pose is reapplied without a sweep and replicated relative to the base.
+	*/
+	UPROPERTY(Category = "Custom Character Movement", BlueprintReadWrite, EditAnywhere)
+		uint32 bUseRelativeBasePose : 1;
+
+	/**
+	* Return the pose of the updated component in the local frame of its movement base.
+	*
+	* @param OutLocation - Location relative to the base.
+	* @param OutRotation - Rotation relative to the base.
+	* @return False if not on a base that uses relative location.
+	*/
+	bool GetRelativeBasePose(FVector& OutLocation, FQuat& OutRotation) const;
+
+	/** Update OldBaseLocation and OldBaseQuat, and capture the relative base pose */
+	virtual void SaveBaseLocation() override;
+
+	/** Shift gravity point, saved moves, snapshots and base state along with the world origin */
+	virtual void ApplyWorldOffset(const FVector& InOffset, bool bWorldShift) override;
+
 	/**
 	* Checks if new capsule size fits (no encroachment), and call CharacterOwner->OnStartCrouch() if successful.
 	* In general you should set bWantsToCrouch instead to have the crouch persist during movement, or just use the crouch functions on the owning Character.
@@ -88,6 +174,7 @@ public:
 
 	/**
 	* Determine how deep in water the character is immersed.
+	* AMWaterVolume surfaces are queried analytically, other volumes trace their brush once per frame and location.
 	* @return float in range 0.0 = not in water, 1.0 = fully immersed
 	*/
 	virtual float ImmersionDepth() const override;
@@ -95,6 +182,38 @@ public:
 	/** UNavMovementComponent Interface */
 	virtual void RequestDirectMove(const FVector& MoveVelocity, bool bForceMaxSpeed) override;
 
+	/**
+	* Path following request on a surface navigation graph.
+	* Moves in the plane of the surface and, if bAlignGravityToNavigation is set, aligns custom gravity with it.
+	*
+	* @param SurfaceUp - Normalized up vector of the followed surface.
+	* @see RequestDirectMove()
+	*/
+	virtual void RequestSurfaceMove(const FVector& MoveVelocity, const FVector& SurfaceUp, bool bForceMaxSpeed);
+
+	/**
+	* If true, surface path following sets custom gravity opposite to the up vector of the followed surface.
+	* Ignored while GravityPoint is in use, it already pulls towards the planet.
+	*/
+	UPROPERTY(Category = "Custom Character Movement", BlueprintReadWrite, EditAnywhere)
+		uint32 bAlignGravityToNavigation : 1;
+
+	/**
+	* If true, path following requests are adjusted by crowd avoidance in the character's local tangent plane.
+	* @see FMCrowdAvoidance
+	*/
+	UPROPERTY(Category = "Custom Character Movement", BlueprintReadWrite, EditAnywhere)
+		uint32 bUseSurfaceAvoidance : 1;
+
+	/** Return true if path following requested a move this or the previous frame. */
+	bool HasAvoidanceRequest() const;
+
+	/** Return velocity path following requested before avoidance. */
+	FORCEINLINE const FVector& GetAvoidancePreferredVelocity() const { return AvoidancePreferredVelocity; }
+
+	/** Set avoidance result, used by the next path following request. */
+	void SetAvoidanceVelocity(const FVector& NewAvoidanceVelocity);
+
 	/** Compute the max jump height based on the JumpZVelocity velocity and gravity. */
 	virtual float GetMaxJumpHeight() const override;
 
@@ -161,6 +280,16 @@ public:
 	/** Handle falling movement. */
 	virtual void PhysFalling(float deltaTime, int32 Iterations) override;
 
+	/**
+	* Falling without air control in open space, advanced along the analytic trajectory without sweeps.
+	*
+	* @return False if the fast path can't be used and full simulation is needed.
+	*/
+	virtual bool PhysFallingBallistic(float deltaTime, int32 Iterations);
+
+	/** Return true if nothing blocks the capsule anywhere inside the bounds of a trajectory. */
+	bool IsBallisticPathClear(const FBox& PathBounds) const;
+
 	/** @return true if there is a suitable floor SideStep from current position. */
 	virtual bool CheckLedgeDirection(const FVector& OldLocation, const FVector& SideStep, const FVector& GravDir) const override;
 
@@ -259,6 +388,68 @@ public:
 	/** Applies momentum accumulated through AddImpulse() and AddForce(). */
 	virtual void ApplyAccumulatedForces(float DeltaSeconds) override;
 
+	/** Return the maximum speed for the current state, including running and aiming speeds of the character's hex. */
+	virtual float GetMaxSpeed() const override;
+
+	/** Get prediction data for a client game, allocating FNetworkPredictionData_Client_MCharacter. */
+	virtual class FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+	/**
+	* If true, simulated proxies render buffered server snapshots with a small delay instead of snapping to each update.
+	* Allows lower NetUpdateFrequency without visible stutter.
+	*/
+	UPROPERTY(Category = "Custom Character Movement", EditAnywhere)
+		uint32 bUseSnapshotInterpolation : 1;
+
+	/** Lower bound of the snapshot interpolation delay, in seconds. */
+	UPROPERTY(Category = "Custom Character Movement", EditAnywhere, meta = (ClampMin = "0", UIMin = "0", EditCondition = "bUseSnapshotInterpolation"))
+		float MinInterpolationDelay;
+
+	/** Upper bound of the snapshot interpolation delay, in seconds. */
+	UPROPERTY(Category = "Custom Character Movement", EditAnywhere, meta = (ClampMin = "0", UIMin = "0", EditCondition = "bUseSnapshotInterpolation"))
+		float MaxInterpolationDelay;
+
+	/** How long the last snapshot can be extrapolated when packets are late, in seconds. */
+	UPROPERTY(Category = "Custom Character Movement", EditAnywhere, meta = (ClampMin = "0", UIMin = "0", EditCondition = "bUseSnapshotInterpolation"))
+		float MaxExtrapolationTime;
+
+	/**
+	* If true, falling without air control far from geometry follows the analytic trajectory under current gravity,
+	* checked by a single broadphase query instead of sweeping every substep.
+	*/
+	UPROPERTY(Category = "Custom Character Movement", EditAnywhere)
+		uint32 bUseBallisticFastPath : 1;
+
+	/**
+	* How far ahead a clear trajectory is checked under uniform gravity, in seconds.
+	* Longer windows need fewer queries but may miss objects that move into the path meanwhile.
+	*/
+	UPROPERTY(Category = "Custom Character Movement", EditAnywhere, meta = (ClampMin = "0", UIMin = "0", EditCondition = "bUseBallisticFastPath"))
+		float BallisticLookaheadTime;
+
+	/** Extra distance kept between the capsule and geometry on the fast path. */
+	UPROPERTY(Category = "Custom Character Movement", EditAnywhere, meta = (ClampMin = "0", UIMin = "0", EditCondition = "bUseBallisticFastPath"))
+		float BallisticClearanceMargin;
+
+	/** Return number of client moves processed by the server. */
+	FORCEINLINE int32 GetNumServerMoves() const { return NumServerMoves; }
+
+	/** Return number of client moves the server had to correct. */
+	FORCEINLINE int32 GetNumServerMoveCorrections() const { return NumServerMoveCorrections; }
+
+	/** Return true if snapshot interpolation drives this simulated proxy. */
+	bool IsUsingSnapshotInterpolation() const;
+
+	/** Discard buffered snapshots, e.g. when updates arrive relative to a moving base. */
+	void ResetMovementSnapshots();
+
+	/**
+	* Buffer a movement update received from the server.
+	*
+	* @param ServerTimeStamp - Wrapped server time from FMRepMovement::MakeTimeStamp.
+	*/
+	void AddMovementSnapshot(uint16 ServerTimeStamp, const FVector& NewLocation, const FQuat& NewRotation, const FVector& NewVelocity);
+
 	/**
 	* Return the current gravity.
 	* @note Could return zero gravity.
@@ -307,6 +498,17 @@ public:
 	UPROPERTY(Category = "Custom Character Movement", BlueprintReadWrite, EditAnywhere)
 		uint32 bAlignCustomGravityToFloor : 1;
 
+	/**
+	* Return the resolved gravity mode.
+	*/
+	FORCEINLINE EMGravityMode GetGravityMode() const { return GravityMode; }
+
+	/**
+	* Resolve the gravity mode from current gravity settings.
+	* @note Called on every movement update, call it directly after changing GravityPoint or GravityScale outside of movement.
+	*/
+	void ResolveGravityMode();
+
 	/**
 	* Update values related to gravity.
 	*
@@ -346,6 +548,12 @@ public:
 	*/
 	virtual void UpdateComponentRotation();
 
+	/**
+	* Update rotations of several components at once, same result as UpdateComponentRotation of each.
+	* Frame math runs over packed arrays before any component is moved.
+	*/
+	static void UpdateComponentRotations(const TArray<UMCharacterMovementComponent*>& Components);
+
 protected:
 	/** Called after MovementMode has changed. Base implementation does special handling for starting certain modes, then notifies the CharacterOwner. */
 	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
@@ -353,6 +561,92 @@ protected:
 	/** Simulate movement on a non-owning client. Called by SimulatedTick(). */
 	virtual void SimulateMovement(float DeltaSeconds) override;
 
+	/** Simulate movement on a non-owning client by sampling the snapshot buffer. */
+	virtual void SimulateMovementFromSnapshots(float DeltaSeconds);
+
+	/** Location the checked ballistic trajectory starts at. */
+	FVector BallisticStartLocation;
+
+	/** Velocity the checked ballistic trajectory starts with. */
+	FVector BallisticStartVelocity;
+
+	/** Gravity of the checked ballistic trajectory. */
+	FVector BallisticGravity;
+
+	/** Time spent on the checked ballistic trajectory. */
+	float BallisticElapsedTime;
+
+	/** Time up to which the ballistic trajectory is known to be clear, zero if not checked. */
+	float BallisticClearTime;
+
+	/** Velocity requested by path following before avoidance. */
+	FVector AvoidancePreferredVelocity;
+
+	/** Velocity computed by crowd avoidance. */
+	FVector AvoidanceVelocity;
+
+	/** Frame of the last path following request. */
+	uint64 AvoidanceRequestFrame;
+
+	/** Frame AvoidanceVelocity was computed in. */
+	uint64 AvoidanceResultFrame;
+
+	/** Location relative to the movement base when the relative base pose was captured. */
+	FVector RelativeBaseLocation;
+
+	/** Rotation relative to the movement base when the relative base pose was captured. */
+	FQuat RelativeBaseRotation;
+
+	/** World location of the updated component when the relative base pose was captured or last applied. */
+	FVector RelativeBaseWorldLocation;
+
+	/** World rotation of the updated component when the relative base pose was captured or last applied. */
+	FQuat RelativeBaseWorldRotation;
+
+	/** Scale of the movement base when the relative base pose was captured, a scaled base doesn't move rigidly. */
+	FVector RelativeBaseScale;
+
+	/** Movement base the relative base pose was captured on. */
+	TWeakObjectPtr<const UPrimitiveComponent> RelativeBaseComponent;
+
+	/** Bone of the movement base the relative base pose was captured on. */
+	FName RelativeBaseBoneName;
+
+	/**
+	* Follow a moving base by reapplying the captured relative pose without a sweep.
+	*
+	* @return False if the relative pose changed or the base doesn't move rigidly.
+	*/
+	bool FollowBaseRigidly(const UPrimitiveComponent* MovementBase, const FVector& NewBaseLocation, const FQuat& NewBaseQuat);
+
+	/** Immersion depth last traced against a water volume brush. */
+	mutable float ImmersionDepthCache;
+
+	/** Frame ImmersionDepthCache was traced in, it is only reused within the frame. */
+	mutable uint64 ImmersionDepthCacheFrame;
+
+	/** Volume ImmersionDepthCache was traced against. */
+	mutable TWeakObjectPtr<const APhysicsVolume> ImmersionDepthCacheVolume;
+
+	/** Trace start and end ImmersionDepthCache was traced with. */
+	mutable FVector ImmersionDepthCacheStart;
+	mutable FVector ImmersionDepthCacheEnd;
+
+	/** Buffered server snapshots for simulated proxies. */
+	FMSnapshotBuffer SnapshotBuffer;
+
+	/** Client moves processed by the server, used for load reports. */
+	int32 NumServerMoves;
+
+	/** Client moves corrected by the server, used for load reports. */
+	int32 NumServerMoveCorrections;
+
+	/** Unpack compressed flags from a saved move and set state accordingly, including running and aiming. */
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+
+	/** Replay saved moves after a server correction, restoring the real running and aiming state afterwards. */
+	virtual bool ClientUpdatePositionAfterServerUpdate() override;
+
 	/** Custom version of SlideAlongSurface that handles different movement modes separately; namely during walking physics we might not want to slide up slopes. */
 	virtual float SlideAlongSurface(const FVector& Delta, float Time, const FVector& Normal, FHitResult& Hit, bool bHandleImpact) override;
 
@@ -596,6 +890,16 @@ protected:
 	*/
 	uint32 bDisableGravityReplication : 1;
 
+	/**
+	* If true, gravity replication is queued in the server frame budget scheduler.
+	*/
+	uint32 bGravityReplicationPending : 1;
+
+	/**
+	* Send changed gravity direction, point and scale to clients.
+	*/
+	void ReplicateGravity();
+
 	/**
 	* Sets a custom gravity direction; use 0,0,0 to remove any custom direction.
 	* @note It can be influenced by GravityScale.
@@ -618,6 +922,25 @@ protected:
 	UFUNCTION(Client, Reliable)
 		virtual void ClientClearCustomGravityDirection();
 
+	/**
+	* Gravity mode resolved from custom gravity direction, gravity point, gravity scale and floor alignment.
+	* @see ResolveGravityMode
+	*/
+	EMGravityMode GravityMode;
+
+	/**
+	* If true, the gravity mode allows stock UCharacterMovementComponent physics and the capsule is upright.
+	*/
+	FORCEINLINE bool CanUseStockPhysics() const;
+
+	/** Gravity for a resolved mode, specialized per mode */
+	template<EMGravityMode Mode>
+	FVector GetGravityForMode() const;
+
+	/** Gravity direction for a resolved mode, specialized per mode */
+	template<EMGravityMode Mode>
+	FVector GetGravityDirectionForMode(bool bAvoidZeroGravity) const;
+
 	/**
 	* Stores last known value of GravityPoint.
 	* @see GravityPoint
@@ -0,0 +1,109 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "MHitboxSet.generated.h"
+
+class USkeletalMesh;
+class USkeletalMeshComponent;
+
+/** Body region of a hitbox, selects the damage multiplier */
+UENUM()
+enum class EMHitZone : uint8
+{
+	Body,
+	Head,
+	Limb
+};
+
+/** Capsule or sphere following a bone, in bone space */
+USTRUCT()
+struct FMHitboxDefinition
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	FName BoneName;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	EMHitZone Zone;
+
+	/** Center relative to the bone */
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox")
+	FVector Offset;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox", meta = (ClampMin = "0"))
+	float Radius;
+
+	/** Half length of the capsule segment along the bone X axis, zero for a sphere */
+	UPROPERTY(EditDefaultsOnly, Category = "Hitbox", meta = (ClampMin = "0"))
+	float HalfLength;
+
+	FMHitboxDefinition();
+};
+
+/** Closest hitbox along a ray */
+struct FMHitboxHit
+{
+	/** Index of the hitbox definition */
+	int32 Index;
+
+	FName BoneName;
+
+	EMHitZone Zone;
+
+	/** Distance from the ray start */
+	float Distance;
+
+	FVector Location;
+
+	FVector Normal;
+};
+
+/**
+ * Hitboxes of a character for hit registration, posed in world space.
+ * Shapes are stored as separate arrays of segments and radii, a sphere is a segment of zero length,
+ * so a ray is tested against all of them with a single capsule kernel and no physics bodies are needed.
+ */
+class PERPLEX_API FMHitboxSet
+{
+public:
+	FMHitboxSet();
+
+	/** Resolve bones of the definitions on the mesh, needed again if the mesh asset changes */
+	void Init(const USkeletalMeshComponent* Mesh, const TArray<FMHitboxDefinition>& Definitions);
+
+	/** Pose hitboxes from current bone transforms of the mesh */
+	void Update(const USkeletalMeshComponent* Mesh);
+
+	/** Find the closest hitbox hit by a segment */
+	bool Raycast(const FVector& Start, const FVector& End, FMHitboxHit& OutHit) const;
+
+	/** Distance from a segment to the surface of a hitbox, zero or less if it passes through */
+	float GetDistanceToSegment(int32 Index, const FVector& Start, const FVector& End) const;
+
+	bool IsInitializedFor(const USkeletalMeshComponent* Mesh) const;
+
+	FORCEINLINE int32 Num() const { return Radii.Num(); }
+
+private:
+	/** Mesh asset bones were resolved on */
+	const USkeletalMesh* InitializedMesh;
+
+	/** Hitbox shapes in bone space */
+	TArray<int32> BoneIndices;
+	TArray<FName> BoneNames;
+	TArray<EMHitZone> Zones;
+	TArray<FVector> LocalCenters;
+	TArray<float> HalfLengths;
+	TArray<float> Radii;
+
+	/** Posed segments in world space, from start along the segment vector */
+	TArray<FVector> SegmentStarts;
+	TArray<FVector> Segments;
+
+	/** Sphere around all posed hitboxes, rays missing it skip the shapes */
+	FVector BoundsCenter;
+	float BoundsRadius;
+};
@@ -4,20 +4,27 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/PlayerController.h"
+#include "GenericTeamAgentInterface.h"
 #include "MPlayerController.generated.h"
 
 class AMPlayerCharacter;
 
 UCLASS()
-class PERPLEX_API AMPlayerController : public APlayerController
+class PERPLEX_API AMPlayerController : public APlayerController, public IGenericTeamAgentInterface
 {
 	GENERATED_BODY()
 
 public:
+	AMPlayerController();
+
 	virtual void SetupInputComponent() override;
 
+	virtual void BeginPlay() override;
+
 	virtual void BeginPlayingState() override;
 
+	virtual void PlayerTick(float DeltaTime) override;
+
 	UFUNCTION()
 	void OnMoveHorizontal(float AxisValue);
 
@@ -54,6 +61,56 @@ public:
 	UFUNCTION()
 	void OnStopWeaponFire();
 
+	/** Check if this controller is driven by scripted bot input */
+	FORCEINLINE bool IsBot() const { return bIsBot; }
+
+	virtual void SetGenericTeamId(const FGenericTeamId& NewTeamId) override;
+
+	virtual FGenericTeamId GetGenericTeamId() const override { return TeamId; }
+
+protected:
+	/**
+	* World origin is moved to the viewed pawn once it gets farther than this, zero disables it.
+	* Requires world origin rebasing to be enabled in world settings.
+	*/
+	UPROPERTY(EditDefaultsOnly, Category = "World", meta = (ClampMin = "0"))
+	float WorldOriginRebaseDistance;
+
 private:
+	/** Keep the local world origin near the viewed pawn, so float precision doesn't degrade far from the map center */
+	void UpdateWorldOrigin();
+
 	AMPlayerCharacter* PlayerCharacter;
+
+	/** Assigned by the game mode, only known on the server */
+	FGenericTeamId TeamId;
+
+	/** Set on local controllers of clients launched with -PerplexBot */
+	bool bIsBot;
+
+	/** Random stream for bot decisions, seeded with -PerplexBotSeed= */
+	FRandomStream BotRandom;
+
+	/** Time until next bot decision */
+	float BotDecisionTime;
+
+	float BotMoveHorizontal;
+
+	float BotMoveVertical;
+
+	float BotLookHorizontal;
+
+	float BotLookVertical;
+
+	bool bBotFiring;
+
+	bool bBotRunning;
+
+	bool bBotJumping;
+
+	/** Feeds scripted input through the same handlers as player input */
+	void TickBot(float DeltaTime);
+
+	/** Picks new scripted input */
+	void UpdateBotDecision();
 };
@@ -13,4 +13,7 @@ class PERPLEX_API AMExplosionEffect : public AActor
 	
 public:	
 	AMExplosionEffect();
+
+	/** Purely cosmetic, so server cooks don't load it or the assets it references */
+	virtual bool NeedsLoadForServer() const override;
 };
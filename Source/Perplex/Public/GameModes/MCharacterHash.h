@@ -0,0 +1,52 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+
+class UWorld;
+class AMCharacter;
+
+/**
+ * Spatial hash of living characters, rebuilt once per server tick.
+ * Character indices are sorted by cell, so a radius query visits a few contiguous ranges instead of every character.
+ * Locations are as of the last rebuild.
+ */
+class PERPLEX_API FMCharacterHash
+{
+public:
+	FMCharacterHash();
+
+	/** Fill the hash with living characters */
+	void Rebuild(UWorld* World, float InCellSize);
+
+	/** Characters within a radius of a point */
+	void GetCharactersInRadius(const FVector& Origin, float Radius, TArray<AMCharacter*>& OutCharacters) const;
+
+	FORCEINLINE int32 Num() const { return Characters.Num(); }
+
+	FORCEINLINE const TArray<AMCharacter*>& GetCharacters() const { return Characters; }
+
+private:
+	struct FCellRange
+	{
+		int32 Start;
+
+		int32 Num;
+	};
+
+	FIntVector GetCell(const FVector& Location) const;
+
+	float CellSize;
+
+	/** Characters are stored as separate arrays */
+	TArray<FVector> Locations;
+	TArray<AMCharacter*> Characters;
+	TArray<FIntVector> CharacterCells;
+
+	/** Character indices sorted by cell */
+	TArray<int32> SortedCharacters;
+
+	/** Range of SortedCharacters per cell */
+	TMap<FIntVector, FCellRange> Cells;
+};
@@ -0,0 +1,40 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/GameStateBase.h"
+#include "Engine/StreamableManager.h"
+#include "GameModes/MTeamRegistry.h"
+#include "MGameState.generated.h"
+
+UCLASS()
+class PERPLEX_API AMGameState : public AGameStateBase
+{
+	GENERATED_BODY()
+
+public:
+	AMGameState(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	FORCEINLINE const FMTeamRegistry& GetTeamRegistry() const { return TeamRegistry; }
+
+	FORCEINLINE FMTeamRegistry& GetTeamRegistry() { return TeamRegistry; }
+
+	/** Preload loadouts of the game mode, on the server before players join and on clients while joining */
+	virtual void ReceivedGameModeClass() override;
+
+protected:
+	/** Team relations, replicated so clients can tell enemies apart */
+	UPROPERTY(Transient, Replicated)
+	FMTeamRegistry TeamRegistry;
+
+private:
+	/** Stream assets of loaded weapon classes */
+	void OnLoadoutWeaponsLoaded();
+
+	/** Keeps loadout weapon classes loaded for the match */
+	TSharedPtr<FStreamableHandle> LoadoutWeaponsHandle;
+
+	/** Keeps assets of loadout weapons loaded for the match */
+	TSharedPtr<FStreamableHandle> LoadoutAssetsHandle;
+};
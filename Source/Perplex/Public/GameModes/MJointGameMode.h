@@ -4,10 +4,134 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "Net/MNetUpdateRateController.h"
+#include "Net/MRelevancyGrid.h"
+#include "Net/MNetBandwidthProfiler.h"
+#include "Server/MServerLoadReport.h"
+#include "Server/MFrameBudgetScheduler.h"
+#include "AI/MCrowdAvoidance.h"
+#include "AI/MAITargetingService.h"
+#include "GameModes/MCharacterHash.h"
 #include "MJointGameMode.generated.h"
 
+class AMWeapon;
+class UMCharacterMovementComponent;
+class UDamageType;
+
 UCLASS()
 class PERPLEX_API AMJointGameMode : public AGameModeBase
 {
 	GENERATED_BODY()
+
+public:
+	AMJointGameMode(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+
+	virtual void InitGameState() override;
+
+	virtual void PostLogin(APlayerController* NewPlayer) override;
+
+	virtual void Logout(AController* Exiting) override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	FORCEINLINE FMNetUpdateRateController& GetNetUpdateRateController() { return NetUpdateRateController; }
+
+	FORCEINLINE const FMRelevancyGrid& GetRelevancyGrid() const { return RelevancyGrid; }
+
+	FORCEINLINE FMServerLoadReport& GetServerLoadReport() { return ServerLoadReport; }
+
+	FORCEINLINE FMNetBandwidthProfiler& GetNetBandwidthProfiler() { return NetBandwidthProfiler; }
+
+	FORCEINLINE FMFrameBudgetScheduler& GetFrameBudgetScheduler() { return FrameBudgetScheduler; }
+
+	FORCEINLINE const FMCrowdAvoidance& GetCrowdAvoidance() const { return CrowdAvoidance; }
+
+	FORCEINLINE const FMAITargetingService& GetAITargetingService() const { return AITargetingService; }
+
+	FORCEINLINE const FMCharacterHash& GetCharacterHash() const { return CharacterHash; }
+
+	/** Logs load summary and writes samples to CSV */
+	void ExportServerLoadReport();
+
+	/** Logs bandwidth per property and RPC and writes samples to CSV */
+	void ExportNetBandwidthProfile();
+
+	/** Put a controller on the least populated team, spectators get no team */
+	void AssignTeam(AController* Controller);
+
+	/** Take a controller off its team */
+	void ReleaseTeam(AController* Controller);
+
+	/**
+	* Damage enemies of the instigator's team around a point, with falloff, unless blocked by world geometry.
+	*
+	* @return True if any character was damaged.
+	*/
+	bool ApplyRadialDamage(float BaseDamage, float MinimumDamage, const FVector& Origin, float InnerRadius, float OuterRadius, float DamageFalloff,
+		TSubclassOf<UDamageType> DamageTypeClass, AActor* DamageCauser, AController* InstigatedBy);
+
+	/** Collect weapon classes to preload, the default pawn's starting weapon and LoadoutWeapons */
+	void GetLoadoutWeapons(TArray<FSoftObjectPath>& OutPaths) const;
+
+protected:
+	/** Tuning of adaptive character update rates */
+	UPROPERTY(EditDefaultsOnly, Category = "Net")
+	FMNetUpdateRateSettings NetUpdateRateSettings;
+
+	/** Tuning of gravity well aware character relevancy */
+	UPROPERTY(EditDefaultsOnly, Category = "Net")
+	FMRelevancyGridSettings RelevancyGridSettings;
+
+	/** Teams hostile to each other, free for all if fewer than two */
+	UPROPERTY(EditDefaultsOnly, Category = "Teams", meta = (ClampMin = "1", ClampMax = "32"))
+	int32 NumTeams;
+
+	/** Weapons streamed in before players join, in addition to the default pawn's starting weapon */
+	UPROPERTY(EditDefaultsOnly, Category = "Loadout")
+	TArray<TSoftClassPtr<AMWeapon>> LoadoutWeapons;
+
+	/** Microseconds per frame for deferred gameplay work */
+	UPROPERTY(EditDefaultsOnly, Category = "Server", meta = (ClampMin = "0"))
+	float DeferredWorkBudgetMicroseconds;
+
+	/** Tuning of AI crowd avoidance */
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	FMCrowdAvoidanceSettings CrowdAvoidanceSettings;
+
+	/** Tuning of bot target selection */
+	UPROPERTY(EditDefaultsOnly, Category = "AI")
+	FMAITargetingSettings AITargetingSettings;
+
+private:
+	/**
+	* Turn every character to its gravity in one batch.
+	* Server pawns only move when their moves arrive, so without this their capsules and hitboxes lag gravity changes.
+	*/
+	void UpdateCharacterRotations();
+
+	FMNetUpdateRateController NetUpdateRateController;
+
+	FMRelevancyGrid RelevancyGrid;
+
+	/** Recorded when launched with -PerplexLoadReport */
+	FMServerLoadReport ServerLoadReport;
+
+	/** Recorded when launched with -PerplexNetProfile */
+	FMNetBandwidthProfiler NetBandwidthProfiler;
+
+	FMFrameBudgetScheduler FrameBudgetScheduler;
+
+	FMCrowdAvoidance CrowdAvoidance;
+
+	FMAITargetingService AITargetingService;
+
+	/** Living characters, rebuilt every tick for AI and radial damage queries */
+	FMCharacterHash CharacterHash;
+
+	/** Movement components of living characters, kept to reuse the allocation */
+	TArray<UMCharacterMovementComponent*> MovementComponents;
 };
@@ -0,0 +1,72 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "GenericTeamAgentInterface.h"
+#include "MTeamRegistry.generated.h"
+
+class AMCharacter;
+class FMCharacterHash;
+
+/**
+ * Teams and hostility between them.
+ * Relations are a bit mask of enemy teams per team, so enemy tests are a shift and a mask. Free for all is a single
+ * team hostile to itself. Controllers carry their team through IGenericTeamAgentInterface, characters copy it from
+ * the possessing controller, and anything without a team is nobody's enemy.
+ */
+USTRUCT()
+struct FMTeamRegistry
+{
+	GENERATED_BODY()
+
+	/** Teams a mask can hold */
+	static const int32 MaxTeams = 32;
+
+	FMTeamRegistry();
+
+	/** Set up teams hostile to each other, or free for all if fewer than two */
+	void Init(int32 InNumTeams);
+
+	/** Make two teams enemies or friends, both ways */
+	void SetEnemies(FGenericTeamId TeamA, FGenericTeamId TeamB, bool bEnemies);
+
+	FORCEINLINE bool AreEnemies(FGenericTeamId TeamA, FGenericTeamId TeamB) const
+	{
+		return IsInMask(GetEnemyMask(TeamA), TeamB);
+	}
+
+	/** Teams hostile to a team as bits */
+	FORCEINLINE uint32 GetEnemyMask(FGenericTeamId Team) const
+	{
+		return Team.GetId() < EnemyMasks.Num() ? EnemyMasks[Team.GetId()] : 0;
+	}
+
+	FORCEINLINE static bool IsInMask(uint32 Mask, FGenericTeamId Team)
+	{
+		return Team.GetId() < MaxTeams && (Mask & (1u << Team.GetId())) != 0;
+	}
+
+	FORCEINLINE int32 GetNumTeams() const { return EnemyMasks.Num(); }
+
+	/** Least populated team for a new member, server only */
+	FGenericTeamId PickTeam() const;
+
+	void AddMember(FGenericTeamId Team);
+
+	void RemoveMember(FGenericTeamId Team);
+
+	/** Living characters hostile to a team within a radius, e.g. for radial damage and AI queries */
+	void GetEnemiesInRadius(const FMCharacterHash& CharacterHash, FGenericTeamId Team, const FVector& Origin, float Radius, TArray<AMCharacter*>& OutEnemies) const;
+
+	/** Characters hostile to a team out of a set */
+	void FilterEnemies(FGenericTeamId Team, const TArray<AMCharacter*>& Characters, TArray<AMCharacter*>& OutEnemies) const;
+
+private:
+	/** Enemy teams per team */
+	UPROPERTY()
+	TArray<uint32> EnemyMasks;
+
+	/** Members per team, only tracked on the server */
+	TArray<int32> NumMembers;
+};
@@ -3,8 +3,114 @@
 #pragma once
 
 #include "Perplex.h"
+#include "Engine/NetSerialization.h"
 #include "MHex.generated.h"
 
+/** Values derived from equipped hex modules */
+UENUM()
+enum class EMHexStat : uint8
+{
+	/** Multiplier of walking speed while running */
+	RunSpeed,
+	/** Multiplier of walking speed while aiming */
+	AimSpeed,
+	/** Multiplier of weapon spread */
+	Spread,
+	/** Hex stops functioning below zero */
+	Stability,
+	Count UMETA(Hidden)
+};
+
+/** Change of a single stat, added to the base value before multiplying */
+USTRUCT()
+struct FMHexModifier
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hex")
+	EMHexStat Stat;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hex")
+	float Add;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hex")
+	float Multiply;
+
+	FMHexModifier();
+};
+
+/** Module equipped into a hex */
+USTRUCT()
+struct FMHexModule
+{
+	GENERATED_BODY()
+
+	/** Identifies the module when unequipping */
+	UPROPERTY(EditDefaultsOnly, Category = "Hex")
+	FName Name;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Hex")
+	TArray<FMHexModifier> Modifiers;
+};
+
+/** Flat cache of derived stats, read by movement and weapons */
+struct FMHexStats
+{
+	float Values[(int32)EMHexStat::Count];
+
+	FMHexStats();
+
+	FORCEINLINE float Get(EMHexStat Stat) const { return Values[(int32)Stat]; }
+};
+
+/** Replicated value of a single stat */
+USTRUCT()
+struct FMHexStatItem : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	EMHexStat Stat;
+
+	UPROPERTY()
+	float Value;
+};
+
+/** Derived stats replicated as a fast array, so only stats that changed are sent */
+USTRUCT()
+struct FMHexStatArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FMHexStatItem> Items;
+
+	/** Copy stats into items, marking only changed ones dirty */
+	void Write(const FMHexStats& Stats);
+
+	/** Copy replicated items into stats */
+	void Read(FMHexStats& OutStats) const;
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParams)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FMHexStatItem, FMHexStatArray>(Items, DeltaParams, *this);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FMHexStatArray> : public TStructOpsTypeTraitsBase2<FMHexStatArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+/**
+ * Hex of a character, a set of modules modifying its stats.
+ * Stats are recomputed only when modules change and cached in a flat struct, so hot paths read a float
+ * instead of walking modifier chains.
+ */
 USTRUCT()
 struct FMHex
 {
@@ -19,7 +125,32 @@ public:
 
 	float GetRunningSpeed() const;
 
+	float GetSpreadModifier() const;
+
+	FORCEINLINE const FMHexStats& GetStats() const { return Stats; }
+
+	/** Add a module and recompute stats */
+	void EquipModule(const FMHexModule& Module);
+
+	/**
+	* Remove a module by name and recompute stats.
+	*
+	* @return False if no module has the name.
+	*/
+	bool UnequipModule(FName Name);
+
+	/** Use stats replicated from the server, modules are only known there */
+	void SetReplicatedStats(const FMHexStatArray& StatArray);
+
 private:
+	/** Fold modifiers of all modules over base values */
+	void Recompute();
+
 	UPROPERTY()
-	float Stability;
+	TArray<FMHexModule> Modules;
+
+	/** Stats without any modules */
+	FMHexStats BaseStats;
+
+	FMHexStats Stats;
 };
@@ -0,0 +1,77 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Vector register kernels for capsule frame and gravity math of character movement.
+ * Results match the scalar FQuat and FRotationMatrix versions within float precision.
+ * @see Perplex.BenchVectorMath
+ */
+namespace MVectorMath
+{
+	namespace Constants
+	{
+		static const VectorRegister AxisX = MakeVectorRegister(1.0f, 0.0f, 0.0f, 0.0f);
+		static const VectorRegister AxisZ = MakeVectorRegister(0.0f, 0.0f, 1.0f, 0.0f);
+		static const VectorRegister SmallLengthSquared = MakeVectorRegister(SMALL_NUMBER, SMALL_NUMBER, SMALL_NUMBER, SMALL_NUMBER);
+	}
+
+	/** Normalize XYZ of a register with W zero, zero if too small */
+	FORCEINLINE VectorRegister SafeNormalize3(const VectorRegister& Vector)
+	{
+		const VectorRegister LengthSquared = VectorDot3(Vector, Vector);
+		const VectorRegister Normalized = VectorMultiply(Vector, VectorReciprocalSqrtAccurate(LengthSquared));
+		return VectorSelect(VectorCompareGT(LengthSquared, Constants::SmallLengthSquared), Normalized, GlobalVectorConstants::FloatZero);
+	}
+
+	/** X axis of a rotation */
+	FORCEINLINE FVector GetAxisX(const FQuat& Quat)
+	{
+		FVector Result;
+		VectorStoreFloat3(VectorQuaternionRotateVector(VectorLoadAligned(&Quat), Constants::AxisX), &Result);
+		return Result;
+	}
+
+	/** Z axis of a rotation */
+	FORCEINLINE FVector GetAxisZ(const FQuat& Quat)
+	{
+		FVector Result;
+		VectorStoreFloat3(VectorQuaternionRotateVector(VectorLoadAligned(&Quat), Constants::AxisZ), &Result);
+		return Result;
+	}
+
+	/** Direction from a location to a point, zero if they coincide */
+	FORCEINLINE FVector GetSafeDirection(const FVector& From, const FVector& To)
+	{
+		FVector Result;
+		VectorStoreFloat3(SafeNormalize3(VectorSubtract(VectorLoadFloat3_W0(&To), VectorLoadFloat3_W0(&From))), &Result);
+		return Result;
+	}
+
+	/**
+	* Rotation with the given Z axis that keeps X as close to the given X as possible.
+	* Same as FRotationMatrix::MakeFromZX(Z, X).ToQuat() without going through a rotator.
+	*/
+	FORCEINLINE FQuat MakeQuatFromZX(const FVector& Z, const FVector& X)
+	{
+		const VectorRegister ZAxis = SafeNormalize3(VectorLoadFloat3_W0(&Z));
+		const VectorRegister YAxis = SafeNormalize3(VectorCross(ZAxis, VectorLoadFloat3_W0(&X)));
+
+		// Parallel axes have no unique frame, let the scalar version pick one
+		if (!VectorAnyGreaterThan(VectorDot3(YAxis, YAxis), Constants::SmallLengthSquared))
+		{
+			return FRotationMatrix::MakeFromZX(Z, X).ToQuat();
+		}
+
+		const VectorRegister XAxis = VectorCross(YAxis, ZAxis);
+
+		FMatrix Matrix;
+		VectorStoreAligned(XAxis, &Matrix.M[0][0]);
+		VectorStoreAligned(YAxis, &Matrix.M[1][0]);
+		VectorStoreAligned(ZAxis, &Matrix.M[2][0]);
+		VectorStoreAligned(GlobalVectorConstants::Float0001, &Matrix.M[3][0]);
+		return FQuat(Matrix);
+	}
+}
@@ -0,0 +1,224 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "UObject/ObjectKey.h"
+
+class UWorld;
+class AActor;
+class UFunction;
+class UNetConnection;
+class UNetDriver;
+class UProperty;
+class FNetBitWriter;
+struct FReplicationFlags;
+
+/** What a profiled entry counts */
+enum class EMNetBandwidthKind : uint8
+{
+	/** Replicated property, or all properties of an actor or its components */
+	Property,
+	RPC
+};
+
+/** How the bits of a profiled entry are obtained */
+enum class EMNetBandwidthMeasure : uint8
+{
+	/** Measured on the connection, including headers */
+	Wire,
+	/** Values serialized the way replication writes them, without headers */
+	Payload,
+	/** Upper bound, structs and arrays are serialized whole while replication sends changed members only */
+	Estimate
+};
+
+/** Bits of one entry over one sample interval */
+struct FMNetBandwidthSample
+{
+	/** World time at the end of the interval */
+	float Time;
+
+	/** Index into profiled entries */
+	int32 Entry;
+
+	float BitsPerSecond;
+
+	float CountPerSecond;
+};
+
+/**
+ * Records bits sent and received per replicated property and RPC per connection on the server.
+ * Sent RPCs and per-actor property totals are measured on the wire. Properties that changed since the last update
+ * to a connection and pass their replication condition, and parameters of received RPCs, are serialized with the
+ * connection's package map, since bunches aren't visible to game code.
+ */
+class PERPLEX_API FMNetBandwidthProfiler
+{
+public:
+	FMNetBandwidthProfiler();
+
+	/** Profiler of world's game mode, null if there is none or it isn't recording */
+	static FMNetBandwidthProfiler* Find(const UWorld* World);
+
+	void Tick(UWorld* World, float DeltaSeconds);
+
+	/** Drops recorded entries and samples */
+	void Reset();
+
+	/**
+	* Record properties an actor wrote into a bunch, call from ReplicateSubobjects.
+	*
+	* @param RepFlags - Flags the actor was replicated with, for replication conditions.
+	* @param ActorBits - Bits of the actor's own properties, including spawn info of initial bunches.
+	* @param ComponentBits - Bits of replicated components and subobjects.
+	*/
+	void RecordReplicatedProperties(const AActor* Actor, UNetConnection* Connection, const FReplicationFlags& RepFlags, int64 ActorBits, int64 ComponentBits);
+
+	/** Record an RPC received from a connection, call from ProcessEvent */
+	void RecordReceivedRPC(const UObject* Object, const UFunction* Function, void* Parameters, UNetConnection* Connection);
+
+	/** Logs bits per connection per second of each entry, most expensive first */
+	void DumpSummary() const;
+
+	/** Writes all samples into a CSV file, returns false on failure */
+	bool WriteCsv(const FString& Filename) const;
+
+	/** Default CSV location under the profiling directory */
+	static FString GetDefaultCsvFilename();
+
+	/** Seconds per sample */
+	float SampleInterval;
+
+	/** If false, nothing is recorded */
+	bool bEnabled;
+
+	/** Measures bits written to each connection while an RPC is sent */
+	class PERPLEX_API FScopedSentRPC
+	{
+	public:
+		FScopedSentRPC(const UObject* Object, const UFunction* Function);
+
+		~FScopedSentRPC();
+
+	private:
+		FMNetBandwidthProfiler* Profiler;
+
+		const UObject* Object;
+
+		const UFunction* Function;
+
+		UNetDriver* NetDriver;
+
+		/** Bits written to each connection before the call */
+		TArray<TPair<UNetConnection*, int64>> StartBits;
+	};
+
+private:
+	enum class EDirection : uint8
+	{
+		Sent,
+		Received
+	};
+
+	struct FEntryKey
+	{
+		FString Connection;
+
+		FName Class;
+
+		FName Name;
+
+		EMNetBandwidthKind Kind;
+
+		EDirection Direction;
+
+		bool operator==(const FEntryKey& Other) const
+		{
+			return Connection == Other.Connection && Class == Other.Class && Name == Other.Name && Kind == Other.Kind && Direction == Other.Direction;
+		}
+
+		friend uint32 GetTypeHash(const FEntryKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.Connection), GetTypeHash(Key.Class)), HashCombine(GetTypeHash(Key.Name), (uint32)Key.Kind << 1 | (uint32)Key.Direction));
+		}
+	};
+
+	struct FEntry
+	{
+		FEntryKey Key;
+
+		EMNetBandwidthMeasure Measure;
+
+		int64 IntervalBits;
+
+		int32 IntervalCount;
+
+		int64 TotalBits;
+
+		int32 TotalCount;
+	};
+
+	/** Property values of an actor, hashed once per frame */
+	struct FActorState
+	{
+		uint64 Frame;
+
+		TArray<uint32> Hashes;
+
+		/** Hashes last written to each connection */
+		TMap<TWeakObjectPtr<UNetConnection>, TArray<uint32>> SentHashes;
+	};
+
+	/** Replicated property and its replication condition */
+	struct FNetProperty
+	{
+		UProperty* Property;
+
+		/** ELifetimeCondition */
+		uint8 Condition;
+	};
+
+	void Record(UNetConnection* Connection, const UObject* Object, FName Name, EMNetBandwidthKind Kind, EDirection Direction, EMNetBandwidthMeasure Measure, int64 Bits);
+
+	/** Replicated properties of a class */
+	const TArray<FNetProperty>& GetNetProperties(const UClass* Class);
+
+	/** Hashes property values of an object for change detection */
+	static void HashProperties(const UObject* Object, const TArray<FNetProperty>& Properties, TArray<uint32>& OutHashes);
+
+	/** Bits written to a connection so far, including the unsent packet */
+	static int64 GetConnectionOutBits(const UNetConnection* Connection);
+
+	/** Check if replication sends a property with a condition to a connection */
+	static bool IsConditionMet(uint8 Condition, const FReplicationFlags& RepFlags);
+
+	/**
+	* Writes a value the way replication does.
+	*
+	* @return False if the value was written whole while replication would send only its changed parts.
+	*/
+	static bool SerializeValue(const UProperty* Property, void* Value, FNetBitWriter& Writer);
+
+	TArray<FEntry> Entries;
+
+	TMap<FEntryKey, int32> EntryIndices;
+
+	/** Ring buffer of samples, oldest are overwritten once full */
+	TArray<FMNetBandwidthSample> Samples;
+
+	/** Index of the oldest sample */
+	int32 FirstSample;
+
+	TMap<FObjectKey, FActorState> ActorStates;
+
+	TMap<const UClass*, TArray<FNetProperty>> NetProperties;
+
+	/** Cached remote address of each connection */
+	TMap<TWeakObjectPtr<UNetConnection>, FString> ConnectionNames;
+
+	float IntervalTime;
+
+	/** Seconds recorded since reset */
+	float Duration;
+};
@@ -0,0 +1,130 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "MNetUpdateRateController.generated.h"
+
+class AMCharacter;
+class UWorld;
+
+/** Tuning of adaptive character update rates */
+USTRUCT()
+struct FMNetUpdateRateSettings
+{
+	GENERATED_BODY()
+
+	/** If false, characters keep their default NetUpdateFrequency */
+	UPROPERTY(EditDefaultsOnly, Category = "Net")
+	bool bEnabled;
+
+	/** Lowest update frequency for idle or distant characters */
+	UPROPERTY(EditDefaultsOnly, Category = "Net", meta = (ClampMin = "1"))
+	float MinNetUpdateFrequency;
+
+	/** Highest update frequency for active characters close to viewers */
+	UPROPERTY(EditDefaultsOnly, Category = "Net", meta = (ClampMin = "1"))
+	float MaxNetUpdateFrequency;
+
+	/** Seconds between re-evaluations */
+	UPROPERTY(EditDefaultsOnly, Category = "Net", meta = (ClampMin = "0"))
+	float EvaluationInterval;
+
+	/** Viewers closer than this count as nearby */
+	UPROPERTY(EditDefaultsOnly, Category = "Net")
+	float NearViewerDistance;
+
+	/** Characters this far from every viewer get the lowest rate */
+	UPROPERTY(EditDefaultsOnly, Category = "Net")
+	float FarViewerDistance;
+
+	/** Number of nearby viewers at which crowd score saturates */
+	UPROPERTY(EditDefaultsOnly, Category = "Net", meta = (ClampMin = "1"))
+	int32 CrowdViewerCount;
+
+	/** Acceleration at which activity score saturates */
+	UPROPERTY(EditDefaultsOnly, Category = "Net")
+	float SaturatingAcceleration;
+
+	/** Per second decay of update frequency towards a lower target */
+	UPROPERTY(EditDefaultsOnly, Category = "Net", meta = (ClampMin = "0"))
+	float FrequencyDecayRate;
+
+	/** Estimated size of a single character movement update in bits */
+	UPROPERTY(EditDefaultsOnly, Category = "Net", meta = (ClampMin = "1"))
+	int32 BitsPerUpdate;
+
+	/** Fraction of each connection's net speed character movement may use */
+	UPROPERTY(EditDefaultsOnly, Category = "Net", meta = (ClampMin = "0", ClampMax = "1"))
+	float ConnectionBudgetFraction;
+
+	FMNetUpdateRateSettings();
+};
+
+/** Update rate state of a single character */
+struct FMNetUpdateRateStats
+{
+	/** Combined activity, proximity and crowd score in [0, 1] */
+	float Score;
+
+	/** Frequency chosen before bandwidth budget */
+	float DesiredFrequency;
+
+	/** Frequency applied to the character */
+	float Frequency;
+
+	/** Viewers within NearViewerDistance */
+	int32 ViewerCount;
+
+	/** Distance to the closest viewer */
+	float NearestViewerDistance;
+
+	/** Velocity at the previous evaluation */
+	FVector LastVelocity;
+
+	/** Gravity direction at the previous evaluation */
+	FVector LastGravityDirection;
+
+	/** Times frequency was limited by a connection budget */
+	int32 BudgetLimitedCount;
+
+	FMNetUpdateRateStats();
+};
+
+/**
+ * Tunes NetUpdateFrequency of characters on the server.
+ * Characters that accelerate, change gravity, fire or have many viewers nearby update more often, idle and
+ * distant ones less often. Rates are then scaled down so estimated movement traffic fits each connection's budget.
+ */
+class PERPLEX_API FMNetUpdateRateController
+{
+public:
+	FMNetUpdateRateController();
+
+	void Tick(UWorld* World, float DeltaSeconds, const FMNetUpdateRateSettings& Settings);
+
+	/** Stops tracking a character and restores its default update frequency */
+	void RemoveCharacter(AMCharacter* Character);
+
+	/** Stats of a tracked character, or null */
+	const FMNetUpdateRateStats* GetStats(const AMCharacter* Character) const;
+
+	/** Logs per-character rates */
+	void DumpStats() const;
+
+private:
+	struct FViewer
+	{
+		FVector Location;
+
+		/** Bits per second available for character movement */
+		float BudgetBits;
+
+		/** Bits per second requested by characters relevant to this viewer */
+		float RequestedBits;
+	};
+
+	TMap<TWeakObjectPtr<AMCharacter>, FMNetUpdateRateStats> Stats;
+
+	float TimeSinceEvaluation;
+};
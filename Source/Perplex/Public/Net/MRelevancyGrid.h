@@ -0,0 +1,128 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "MRelevancyGrid.generated.h"
+
+class UWorld;
+class AActor;
+
+/** Tuning of the character relevancy grid */
+USTRUCT()
+struct FMRelevancyGridSettings
+{
+	GENERATED_BODY()
+
+	/** If false, characters use default distance based relevancy */
+	UPROPERTY(EditDefaultsOnly, Category = "Net")
+	bool bEnabled;
+
+	/** Cell size outside of any gravity well */
+	UPROPERTY(EditDefaultsOnly, Category = "Net", meta = (ClampMin = "1"))
+	float OpenSpaceCellSize;
+
+	/** Characters in different spaces are still relevant when closer than this, e.g. near a well boundary */
+	UPROPERTY(EditDefaultsOnly, Category = "Net", meta = (ClampMin = "0"))
+	float CrossSpaceRelevancyDistance;
+
+	/** If true, characters hidden behind a planet from the viewer are not relevant */
+	UPROPERTY(EditDefaultsOnly, Category = "Net")
+	bool bOcclusionCulling;
+
+	/** Fraction of the planet surface radius that blocks sight, below one so terrain near the horizon doesn't cull */
+	UPROPERTY(EditDefaultsOnly, Category = "Net", meta = (ClampMin = "0", ClampMax = "1"))
+	float OcclusionRadiusScale;
+
+	/** Line of sight has to pass this much deeper inside the occluder to start culling than to stop culling */
+	UPROPERTY(EditDefaultsOnly, Category = "Net", meta = (ClampMin = "0"))
+	float OcclusionHysteresis;
+
+	FMRelevancyGridSettings();
+};
+
+/**
+ * Coarse relevancy for characters.
+ * Space is split into gravity wells and open space, each with its own uniform grid. Two locations are
+ * relevant to each other if they are in the same space and in the same or a neighboring cell.
+ * Planets of the wells also occlude, the segment between viewer and target is tested against their spheres.
+ * Cells and occlusion of every connection's viewer and every character are resolved once per tick in Rebuild,
+ * per actor and connection queries only look the result up.
+ */
+class PERPLEX_API FMRelevancyGrid
+{
+public:
+	FMRelevancyGrid();
+
+	/** Gathers gravity wells, connection viewers and characters, and resolves relevancy between them, called once per server tick */
+	void Rebuild(UWorld* World, const FMRelevancyGridSettings& InSettings);
+
+	/**
+	* Check if a character is relevant to a connection's viewer.
+	* Pairs not gathered in the last rebuild, e.g. characters spawned since, are tested directly.
+	*/
+	bool IsRelevant(const AActor* Viewer, const AActor* Target, const FVector& ViewLocation, const FVector& TargetLocation) const;
+
+	FORCEINLINE bool IsEnabled() const { return Settings.bEnabled; }
+
+	/** Target and viewer pairs culled by occlusion in the last tick */
+	FORCEINLINE int32 GetNumOccludedPairs() const { return NumOccludedPairs; }
+
+private:
+	struct FWell
+	{
+		FVector Center;
+
+		float RadiusSquared;
+
+		float CellSize;
+
+		/** Radius of the sphere blocking sight, zero if the well doesn't occlude */
+		float OccluderRadius;
+	};
+
+	struct FCell
+	{
+		/** Index of the well, or INDEX_NONE for open space */
+		int32 Space;
+
+		FIntVector Coordinates;
+	};
+
+	struct FViewer
+	{
+		/** Characters in visible cells and not hidden behind a planet */
+		TSet<const AActor*> RelevantActors;
+	};
+
+	FCell GetCell(const FVector& Location) const;
+
+	/** Check if two cells are the same or neighbors, or if locations in different spaces are close */
+	bool AreCellsRelevant(const FVector& ViewLocation, const FCell& ViewCell, const FVector& TargetLocation, const FCell& TargetCell) const;
+
+	/** Check if a planet hides the target from the viewer, with an occluder radius shrunk by Hysteresis */
+	bool IsSegmentOccluded(const FVector& ViewLocation, const FVector& TargetLocation, float Hysteresis) const;
+
+	/**
+	* Test occlusion of a pair and record the result for the next rebuild.
+	* Pairs occluded in the previous rebuild stay culled until clearly visible again.
+	*/
+	bool UpdateOcclusion(const AActor* Viewer, const AActor* Target, const FVector& ViewLocation, const FVector& TargetLocation);
+
+	/** Wells ordered by radius, so nested wells take precedence */
+	TArray<FWell> Wells;
+
+	FMRelevancyGridSettings Settings;
+
+	/** Resolved relevancy per connection, keyed by the connection's viewer */
+	TMap<const AActor*, FViewer> Viewers;
+
+	/** Characters gathered in the last rebuild */
+	TSet<const AActor*> Targets;
+
+	/** Pairs occluded in the current and previous rebuild, keyed by target and viewer IDs */
+	TSet<uint64> OccludedPairs;
+	TSet<uint64> PreviousOccludedPairs;
+
+	int32 NumOccludedPairs;
+};
@@ -0,0 +1,105 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "MRepMovement.generated.h"
+
+struct FRepMovement;
+
+/** Quantization tier used when serializing replicated movement */
+UENUM()
+enum class EMRepMovementPrecision : uint8
+{
+	/** 1 unit location, 7 bits per quaternion component, 4 unit velocity */
+	Low,
+	/** 1 unit location, 9 bits per quaternion component, 1 unit velocity */
+	Default,
+	/** 0.1 unit location, 11 bits per quaternion component, 0.1 unit velocity */
+	High
+};
+
+/**
+ * Replicated movement with full 3D orientation.
+ * Rotation is sent as a smallest-three quantized quaternion, so it has no gimbal poles
+ * and stays accurate for characters standing on walls and ceilings.
+ *
+ * Replaces both FRepMovement and ACharacter's 32 bit float server timestamp for simulated proxies.
+ * Measured for a character 10000 units from the origin moving at 500 units per second, the pair takes
+ * 144 bits with a tilted rotation and 128 with yaw only. The Default tier takes 129 and 111 bits, header included,
+ * with a quarter of the rotation error.
+ */
+USTRUCT()
+struct PERPLEX_API FMRepMovement
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FVector Location;
+
+	UPROPERTY()
+	FQuat Rotation;
+
+	UPROPERTY()
+	FVector LinearVelocity;
+
+	/** Not serialized, sender and receiver both take it from the owning class */
+	UPROPERTY()
+	EMRepMovementPrecision Precision;
+
+	/** If true, location, rotation and velocity were sent in the local frame of the character's movement base */
+	UPROPERTY()
+	bool bRelativeToBase;
+
+	/** Server time when this was gathered, see MakeTimeStamp */
+	UPROPERTY()
+	uint16 ServerTimeStamp;
+
+	FMRepMovement();
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	/** Returns the smallest representable location step for current precision */
+	float GetLocationQuantum() const;
+
+	/** Copies location, rotation and velocity into engine replicated movement */
+	void CopyTo(FRepMovement& RepMovement) const;
+
+	/** Transforms a pose relative to a movement base into world space, bRelativeToBase still tells how it was sent */
+	void MakeWorldSpace(const FVector& BaseLocation, const FQuat& BaseRotation);
+
+	/** Relative locations further from the base than this are sent in world space */
+	static const float MaxRelativeLocation;
+
+	/** Converts world time into a wrapped 12 bit timestamp with 4 millisecond resolution */
+	static uint16 MakeTimeStamp(float TimeSeconds);
+
+	/** Returns seconds from one timestamp to another, only meaningful within half a period */
+	static float GetTimeStampDelta(uint16 FromTimeStamp, uint16 ToTimeStamp);
+
+	/** Timestamp alone is not a reason to replicate */
+	bool operator==(const FMRepMovement& Other) const
+	{
+		return Location == Other.Location
+			&& Rotation == Other.Rotation
+			&& LinearVelocity == Other.LinearVelocity
+			&& Precision == Other.Precision
+			&& bRelativeToBase == Other.bRelativeToBase;
+	}
+
+	bool operator!=(const FMRepMovement& Other) const
+	{
+		return !(*this == Other);
+	}
+};
+
+template<>
+struct TStructOpsTypeTraits<FMRepMovement> : public TStructOpsTypeTraitsBase2<FMRepMovement>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true
+	};
+};
@@ -0,0 +1,96 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Movement state received from the server at a given server time */
+struct FMMovementSnapshot
+{
+	/** Unwrapped server time in seconds */
+	double ServerTime;
+
+	FVector Location;
+
+	FQuat Rotation;
+
+	FVector Velocity;
+};
+
+/**
+ * Jitter buffer for simulated proxies.
+ * Snapshots are rendered a small adaptive delay behind the estimated server clock, so late packets
+ * are absorbed by interpolation instead of showing up as stutter. When the buffer runs dry the last
+ * snapshot is extrapolated ballistically for a limited time.
+ */
+class PERPLEX_API FMSnapshotBuffer
+{
+public:
+	FMSnapshotBuffer();
+
+	/**
+	* Add a snapshot received from the server.
+	*
+	* @param ServerTimeStamp - Wrapped server time from FMRepMovement::MakeTimeStamp.
+	* @param LocalTime - Local time at which the snapshot was received.
+	*/
+	void AddSnapshot(uint16 ServerTimeStamp, double LocalTime, const FVector& Location, const FQuat& Rotation, const FVector& Velocity);
+
+	/**
+	* Sample buffered movement at the current render time.
+	*
+	* @param LocalTime - Current local time.
+	* @param Gravity - Acceleration applied while extrapolating, zero if the character is supported.
+	* @return True if there was anything to sample.
+	*/
+	bool Sample(double LocalTime, const FVector& Gravity, FVector& OutLocation, FQuat& OutRotation, FVector& OutVelocity);
+
+	/** Drop all snapshots and timing estimates, e.g. after a teleport */
+	void Reset();
+
+	/** Shift buffered locations after the world origin moved */
+	void ApplyWorldOffset(const FVector& InOffset);
+
+	FORCEINLINE int32 Num() const { return Snapshots.Num(); }
+
+	FORCEINLINE float GetInterpolationDelay() const { return InterpolationDelay; }
+
+	FORCEINLINE float GetJitter() const { return Jitter; }
+
+	/** Lower bound of the interpolation delay in seconds */
+	float MinInterpolationDelay;
+
+	/** Upper bound of the interpolation delay in seconds */
+	float MaxInterpolationDelay;
+
+	/** How many jitter deviations the delay should cover */
+	float JitterMultiplier;
+
+	/** Longest time the last snapshot is extrapolated for, in seconds */
+	float MaxExtrapolationTime;
+
+private:
+	/** Snapshots ordered by server time */
+	TArray<FMMovementSnapshot> Snapshots;
+
+	/** Last received wrapped timestamp */
+	uint16 LastTimeStamp;
+
+	/** Unwrapped server time of LastTimeStamp */
+	double LastServerTime;
+
+	/** Local time LastTimeStamp was received at */
+	double LastLocalTime;
+
+	/** Estimated local time minus server time */
+	double ClockOffset;
+
+	/** Smoothed deviation of arrival time from the estimated clock */
+	float Jitter;
+
+	/** Smoothed server time between snapshots */
+	float SnapshotInterval;
+
+	/** Current render delay behind the estimated server clock */
+	float InterpolationDelay;
+};
@@ -0,0 +1,101 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+
+class UWorld;
+
+/** Kind of deferred work, used for budget accounting */
+enum class EMDeferredWorkCategory : uint8
+{
+	GravityReplication,
+	Ragdoll,
+	Inventory,
+	Navigation,
+	Misc,
+	Count
+};
+
+/** Higher priority work runs first within a frame */
+enum class EMDeferredWorkPriority : uint8
+{
+	Low,
+	Normal,
+	High,
+	Count
+};
+
+/** Budget usage of a single category */
+struct FMDeferredWorkStats
+{
+	/** Work items waiting in queues */
+	int32 NumQueued;
+
+	/** Work items executed since start */
+	int32 NumExecuted;
+
+	/** Work items promoted because they waited too long */
+	int32 NumStarved;
+
+	/** Microseconds used in the last frame */
+	float LastFrameMicroseconds;
+
+	/** Smoothed microseconds per frame */
+	float AverageMicroseconds;
+
+	/** Longest time a work item waited before executing */
+	float MaxWaitSeconds;
+
+	FMDeferredWorkStats();
+};
+
+/**
+ * Time-sliced queue of non latency critical server work.
+ * Each frame work is executed by priority until the microsecond budget runs out, so bursts such as mass deaths
+ * are spread across frames. Work waiting longer than StarvationSeconds is promoted to the next priority.
+ */
+class PERPLEX_API FMFrameBudgetScheduler
+{
+public:
+	FMFrameBudgetScheduler();
+
+	/**
+	* Defer work to the scheduler of world's game mode, or run it immediately if there is none.
+	*
+	* @param Context - Work is dropped if this object is destroyed before it runs.
+	*/
+	static void Schedule(UWorld* World, EMDeferredWorkCategory Category, EMDeferredWorkPriority Priority, const UObject* Context, TFunction<void()>&& Work);
+
+	void Enqueue(EMDeferredWorkCategory Category, EMDeferredWorkPriority Priority, const UObject* Context, TFunction<void()>&& Work);
+
+	void Tick(float DeltaSeconds);
+
+	FORCEINLINE const FMDeferredWorkStats& GetStats(EMDeferredWorkCategory Category) const { return Stats[(int32)Category]; }
+
+	/** Logs per category budget usage */
+	void DumpStats() const;
+
+	/** Microseconds available each frame */
+	float BudgetMicroseconds;
+
+	/** Seconds after which waiting work is promoted */
+	float StarvationSeconds;
+
+private:
+	struct FWork
+	{
+		TFunction<void()> Function;
+
+		TWeakObjectPtr<const UObject> Context;
+
+		double EnqueueTime;
+
+		EMDeferredWorkCategory Category;
+	};
+
+	/** FIFO queue per priority */
+	TArray<FWork> Queues[(int32)EMDeferredWorkPriority::Count];
+
+	FMDeferredWorkStats Stats[(int32)EMDeferredWorkCategory::Count];
+};
@@ -0,0 +1,81 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+
+class UWorld;
+
+/** Server load aggregated over one sample interval */
+struct FMServerLoadSample
+{
+	/** World time at the end of the interval */
+	float Time;
+
+	int32 NumConnections;
+
+	/** Average and worst frame time, including idle time waiting for the next tick */
+	float AvgFrameMs;
+	float MaxFrameMs;
+
+	/** Average game thread time */
+	float AvgGameThreadMs;
+
+	/** Outgoing bytes per second per connection */
+	float AvgOutBytesPerConnection;
+	float MaxOutBytesPerConnection;
+
+	/** Incoming bytes per second per connection */
+	float AvgInBytesPerConnection;
+
+	/** Client moves processed and corrected during the interval */
+	int32 ServerMoves;
+	int32 ServerMoveCorrections;
+};
+
+/**
+ * Records server tick time, per-connection bandwidth and movement correction rate.
+ * Used for capacity testing with bot clients, see Scripts/LoadTest.sh.
+ */
+class PERPLEX_API FMServerLoadReport
+{
+public:
+	FMServerLoadReport();
+
+	void Tick(UWorld* World, float DeltaSeconds);
+
+	/** Drops recorded samples */
+	void Reset();
+
+	/** Logs averages grouped by connection count */
+	void DumpSummary() const;
+
+	/** Writes all samples into a CSV file, returns false on failure */
+	bool WriteCsv(const FString& Filename) const;
+
+	/** Default CSV location under the profiling directory */
+	static FString GetDefaultCsvFilename();
+
+	/** Seconds per sample */
+	float SampleInterval;
+
+	/** If false, Tick does nothing */
+	bool bEnabled;
+
+private:
+	TArray<FMServerLoadSample> Samples;
+
+	float IntervalTime;
+
+	int32 IntervalFrames;
+
+	float FrameMsSum;
+
+	float FrameMsMax;
+
+	float GameThreadMsSum;
+
+	/** Movement counters at the start of the interval */
+	int32 LastServerMoves;
+	int32 LastServerMoveCorrections;
+};
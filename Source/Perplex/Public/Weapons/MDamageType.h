@@ -4,10 +4,26 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/DamageType.h"
+#include "Characters/MHitboxSet.h"
 #include "MDamageType.generated.h"
 
 UCLASS()
 class PERPLEX_API UMDamageType : public UDamageType
 {
 	GENERATED_BODY()
+
+public:
+	UMDamageType(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	/** Scale of point damage dealt to a hitbox zone */
+	float GetDamageMultiplier(EMHitZone Zone) const;
+
+protected:
+	/** Scale of point damage dealt to head hitboxes */
+	UPROPERTY(EditDefaultsOnly, Category = "Damage", meta = (ClampMin = "0"))
+	float HeadDamageMultiplier;
+
+	/** Scale of point damage dealt to limb hitboxes */
+	UPROPERTY(EditDefaultsOnly, Category = "Damage", meta = (ClampMin = "0"))
+	float LimbDamageMultiplier;
 };
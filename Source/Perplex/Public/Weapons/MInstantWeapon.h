@@ -36,6 +36,10 @@ struct FMInstantWeaponData
 	UPROPERTY(EditDefaultsOnly, Category = "Data")
 	float AimSpreadModifier;
 
+	/** Spread modifier of bots, models their aim error */
+	UPROPERTY(EditDefaultsOnly, Category = "Data")
+	float AISpreadModifier;
+
 	/** Continuous firing: spread increment */
 	UPROPERTY(EditDefaultsOnly, Category = "Data")
 	float FiringSpreadIncrement;
@@ -60,6 +64,10 @@ struct FMInstantWeaponData
 	UPROPERTY(EditDefaultsOnly, Category = "Data")
 	float ClientSideHitLeeway;
 
+	/** Hit verification: a hitbox reported by the client is kept if the shot passes this close to it on the server */
+	UPROPERTY(EditDefaultsOnly, Category = "Data")
+	float ClientSideHitboxLeeway;
+
 	/** Hit verification: threshold for dot product between view direction and hit direction */
 	UPROPERTY(EditDefaultsOnly, Category = "Data")
 	float AllowedViewDotHitDir;
@@ -75,6 +83,8 @@ class PERPLEX_API AMInstantWeapon : public AMWeapon
 public:
 	AMInstantWeapon();
 
+	virtual void GetCosmeticAssets(TArray<FSoftObjectPath>& OutPaths) const override;
+
 protected:
 	/** Weapon config */
 	UPROPERTY(EditDefaultsOnly, Category = "Data")
@@ -82,11 +92,11 @@ protected:
 
 	/** Impact effects */
 	UPROPERTY(EditDefaultsOnly, Category = "Effects")
-	TSubclassOf<AMImpactEffect> ImpactTemplate;
+	TSoftClassPtr<AMImpactEffect> ImpactTemplate;
 
 	/** Smoke trail */
 	UPROPERTY(EditDefaultsOnly, Category = "Effects")
-	UParticleSystem* TrailFX;
+	TSoftObjectPtr<UParticleSystem> TrailFX;
 
 	/** Param name for beam target in smoke trail */
 	UPROPERTY(EditDefaultsOnly, Category = "Effects")
@@ -120,6 +130,13 @@ protected:
 	/** Continue processing the instant hit, as if it has been confirmed by the server */
 	void ProcessInstantHit_Confirmed(const FHitResult& Impact, const FVector& Origin, const FVector& ShootDir, int32 RandomSeed, float ReticleSpread);
 
+	/**
+	* Verify the hitbox of a client reported hit.
+	* The client's hitbox is kept if the shot passes within ClientSideHitboxLeeway of it, the server pose lags
+	* the client's view by interpolation and pose throttling. Otherwise it's replaced with one traced by the server.
+	*/
+	FHitResult ResolveServerHitbox(const FHitResult& Impact, const FVector& ShootDir);
+
 	/** Check if weapon should deal damage to actor */
 	bool ShouldDealDamage(AActor* TestActor) const;
 
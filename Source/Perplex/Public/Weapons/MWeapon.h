@@ -4,6 +4,7 @@
 
 #include "Perplex.h"
 #include "GameFramework/Actor.h"
+#include "Engine/StreamableManager.h"
 #include "MWeapon.generated.h"
 
 class AMCharacter;
@@ -18,10 +19,10 @@ struct FMWeaponAnimation
 	GENERATED_BODY()
 
 	UPROPERTY(EditDefaultsOnly, Category = "Animation")
-	UAnimMontage* FirstPerson;
+	TSoftObjectPtr<UAnimMontage> FirstPerson;
 
 	UPROPERTY(EditDefaultsOnly, Category = "Animation")
-	UAnimMontage* ThirdPerson;
+	TSoftObjectPtr<UAnimMontage> ThirdPerson;
 };
 
 UENUM()
@@ -55,6 +56,20 @@ class PERPLEX_API AMWeapon : public AActor
 public:	
 	AMWeapon();
 
+	virtual void PostInitializeComponents() override;
+
+	virtual bool CallRemoteFunction(UFunction* Function, void* Parameters, FOutParmRec* OutParms, FFrame* Stack) override;
+
+	virtual void ProcessEvent(UFunction* Function, void* Parameters) override;
+
+	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
+
+	/** Collect soft referenced assets gameplay timing depends on, such as montage durations */
+	virtual void GetGameplayAssets(TArray<FSoftObjectPath>& OutPaths) const;
+
+	/** Collect soft referenced effects, empty in server builds */
+	virtual void GetCosmeticAssets(TArray<FSoftObjectPath>& OutPaths) const;
+
 	/** Return FP or TP weapon mesh */
 	USkeletalMeshComponent* GetWeaponMesh() const;
 
@@ -167,7 +182,7 @@ protected:
 
 	/** Effect for muzzle flash */
 	UPROPERTY(EditDefaultsOnly, Category = "Effects")
-	UParticleSystem* MuzzleEffect;
+	TSoftObjectPtr<UParticleSystem> MuzzleEffect;
 
 	/** Is muzzle effect looped? */
 	UPROPERTY(EditDefaultsOnly, Category = "Effects")
@@ -183,7 +198,7 @@ protected:
 
 	/** Camera shake on firing */
 	UPROPERTY(EditDefaultsOnly, Category = "Effects")
-	TSubclassOf<UCameraShake> FireCameraShake;
+	TSoftClassPtr<UCameraShake> FireCameraShake;
 
 	/** Is fire animation playing? */
 	bool bPlayingFireAnimation;
@@ -192,6 +207,7 @@ protected:
 	bool bPendingEquip;
 
 	/** Character owner */
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_OwnerCharacter)
 	AMCharacter* OwnerCharacter;
 
 	/** Current weapon state */
@@ -219,8 +235,15 @@ protected:
 	float EquipDuration;
 
 	/** Burst counter, used for replicating fire events to remote clients */
+	UPROPERTY(Transient, ReplicatedUsing = OnRep_BurstCounter)
 	int32 BurstCounter;
 
+	/** Keeps streamed gameplay assets loaded */
+	TSharedPtr<FStreamableHandle> GameplayAssetsHandle;
+
+	/** Keeps streamed effects loaded */
+	TSharedPtr<FStreamableHandle> CosmeticAssetsHandle;
+
 	/** Handle for efficient management of OnEquipFinished timer */
 	FTimerHandle TimerHandle_OnEquipFinished;
 
@@ -263,6 +286,9 @@ protected:
 	/** Set weapon state */
 	void SetWeaponState(EMWeaponState NewState);
 
+	/** Idle weapons go dormant, anything else keeps them awake */
+	void UpdateNetDormancy();
+
 	/** Firing started */
 	virtual void OnBurstStarted();
 
@@ -0,0 +1,43 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "GameFramework/Actor.h"
+#include "MGravityWell.generated.h"
+
+/**
+ * Spherical region around a planet.
+ * Characters inside the well share a relevancy space with its own grid, so players on one planet
+ * don't pay for players on another.
+ */
+UCLASS()
+class PERPLEX_API AMGravityWell : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AMGravityWell();
+
+	/** Check if location is inside the well */
+	FORCEINLINE bool Contains(const FVector& Location) const { return FVector::DistSquared(Location, GetActorLocation()) <= FMath::Square(InfluenceRadius); }
+
+	FORCEINLINE float GetInfluenceRadius() const { return InfluenceRadius; }
+
+	FORCEINLINE float GetSurfaceRadius() const { return SurfaceRadius; }
+
+	FORCEINLINE float GetRelevancyCellSize() const { return RelevancyCellSize; }
+
+protected:
+	/** Radius of the region the well affects */
+	UPROPERTY(EditAnywhere, Category = "Gravity Well", meta = (ClampMin = "0"))
+	float InfluenceRadius;
+
+	/** Radius of the planet surface */
+	UPROPERTY(EditAnywhere, Category = "Gravity Well", meta = (ClampMin = "0"))
+	float SurfaceRadius;
+
+	/** Size of relevancy grid cells inside the well, characters in neighboring cells are relevant */
+	UPROPERTY(EditAnywhere, Category = "Gravity Well", meta = (ClampMin = "1"))
+	float RelevancyCellSize;
+};
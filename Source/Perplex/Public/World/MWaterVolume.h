@@ -0,0 +1,90 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+#pragma once
+
+#include "Perplex.h"
+#include "GameFramework/PhysicsVolume.h"
+#include "MWaterVolume.generated.h"
+
+/** How the water surface of a volume is described */
+UENUM()
+enum class EMWaterSurfaceShape : uint8
+{
+	/** Surface is found by tracing the volume brush */
+	Brush,
+	/** Flat surface at the top of the volume, along its up axis */
+	Plane,
+	/** Ocean filling a sphere around the volume origin */
+	Sphere,
+	/** Ocean between two spheres around the volume origin, such as water above a planet core */
+	Shell
+};
+
+/** Water filling a sphere, optionally around a dry core */
+struct PERPLEX_API FMWaterSphere
+{
+	FVector Center;
+
+	float SurfaceRadius;
+
+	/** Radius of the dry core, zero for a filled sphere */
+	float CoreRadius;
+
+	FMWaterSphere(const FVector& InCenter, float InSurfaceRadius, float InCoreRadius);
+
+	/** Distance from a point to the water, zero or less if it's in the water */
+	float GetDistanceToWater(const FVector& Point) const;
+
+	/** Fraction of a segment in the water */
+	float GetImmersion(const FVector& Start, const FVector& End) const;
+};
+
+/**
+ * Water volume with an analytic surface.
+ * Immersion depth of swimming characters is a closed-form query against a plane or spheres instead of a brush trace.
+ */
+UCLASS()
+class PERPLEX_API AMWaterVolume : public APhysicsVolume
+{
+	GENERATED_BODY()
+
+public:
+	AMWaterVolume(const FObjectInitializer& ObjectInitializer = FObjectInitializer::Get());
+
+	virtual void PostInitializeComponents() override;
+
+	/** Excludes the dry core of shell oceans and the brush outside spherical oceans */
+	virtual bool EncompassesPoint(FVector Point, float SphereRadius = 0.0f, float* OutDistanceToPoint = nullptr) const override;
+
+	/** Physics volume assignment of movement components, same exclusions as EncompassesPoint */
+	virtual bool IsOverlapInVolume(const USceneComponent& TestComponent) const override;
+
+	/** Check if immersion can be computed without tracing the brush */
+	FORCEINLINE bool HasAnalyticSurface() const { return SurfaceShape != EMWaterSurfaceShape::Brush; }
+
+	/**
+	* Find how much of a segment is under water.
+	*
+	* @return Fraction of the segment in [0, 1], zero if it's not in the water and one if it's fully immersed.
+	*/
+	float GetImmersion(const FVector& Start, const FVector& End) const;
+
+protected:
+	UPROPERTY(EditAnywhere, Category = "Water")
+	EMWaterSurfaceShape SurfaceShape;
+
+	/** Radius of the water surface of spherical oceans */
+	UPROPERTY(EditAnywhere, Category = "Water", meta = (ClampMin = "0"))
+	float SurfaceRadius;
+
+	/** Radius below which there is no water in shell oceans */
+	UPROPERTY(EditAnywhere, Category = "Water", meta = (ClampMin = "0"))
+	float InnerRadius;
+
+private:
+	/** Water of spherical and shell oceans */
+	FMWaterSphere GetWaterSphere() const;
+
+	/** Height of the plane surface above the origin in local space, from brush bounds */
+	float LocalSurfaceHeight;
+};
@@ -0,0 +1,14 @@
+// Copyright 2018 Tin Rabzelj. All Rights Reserved.
+
+using UnrealBuildTool;
+using System.Collections.Generic;
+
+public class PerplexServerTarget : TargetRules
+{
+	public PerplexServerTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Server;
+
+		ExtraModuleNames.AddRange( new string[] { "Perplex" } );
+	}
+}